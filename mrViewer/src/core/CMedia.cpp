@@ -48,6 +48,7 @@ extern "C" {
 
 #include <iostream>
 #include <algorithm>  // for std::min, std::abs
+#include <vector>
 #include <limits>
 
 #include <thread>
@@ -95,7 +96,12 @@ namespace fs = boost::filesystem;
 #include "core/mrvColorBarsImage.h"
 #include "core/mrvBlackImage.h"
 #include "core/Sequence.h"
+#include "core/mrvDirectoryIndex.h"
 #include "core/mrvFrameFunctors.h"
+#include "core/mrvDecodeBudget.h"
+#include "core/mrvFrameCache.h"
+#include "core/mrvDiskCache.h"
+#include "core/mrvReadAhead.h"
 #include "core/mrvPlayback.h"
 #include "core/mrvColorProfile.h"
 #include "core/mrvException.h"
@@ -112,6 +118,9 @@ namespace {
 
 const char* kModule = "img";
 
+// Packed frames kept whole too, for the frames around the one shown.
+const size_t kExpandedFrames = 4;
+
 }
 
 
@@ -158,6 +167,7 @@ std::string CMedia::icc_profile_float;
 
 std::atomic<int64_t> CMedia::memory_used( 0 );
 double CMedia::thumbnail_percent = 0.0f;
+std::atomic<bool> CMedia::cache_stats( false );
 
 int CMedia::_audio_cache_size = 0;
 int CMedia::_video_cache_size = 0;
@@ -171,6 +181,7 @@ bool CMedia::_all_layers = false;
 bool CMedia::_cache_active = true;
 bool CMedia::_preload_cache = true;
 bool CMedia::_8bit_cache = false;
+bool CMedia::_packed_cache = false;
 int  CMedia::_cache_scale = 0;
 
 static const char* const kDecodeStatus[] = {
@@ -452,6 +463,8 @@ _frame_offset( 0 ),
 _playback( kStopped ),
 _sequence( NULL ),
 _right( NULL ),
+_packed( NULL ),
+_packed_right( NULL ),
 _actual_frame_rate( 0 ),
 _context(NULL),
 _video_ctx( NULL ),
@@ -571,6 +584,8 @@ _profile( NULL ),
 _playback( kStopped ),
 _sequence( NULL ),
 _right( NULL ),
+_packed( NULL ),
+_packed_right( NULL ),
 _actual_frame_rate( 0 ),
 _context(NULL),
 _video_ctx( NULL ),
@@ -698,6 +713,8 @@ _profile( NULL ),
 _playback( kStopped ),
 _sequence( NULL ),
 _right( NULL ),
+_packed( NULL ),
+_packed_right( NULL ),
 _actual_frame_rate( 0 ),
 _context(NULL),
 _video_ctx( NULL ),
@@ -785,6 +802,8 @@ void CMedia::clear_cache()
 
     _cache_full = 0;
 
+    FrameCache::instance().erase( this );
+
     boost::uint64_t num = _frame_end - _frame_start + 1;
     for ( boost::uint64_t i = 0; i < num; ++i )
     {
@@ -796,8 +815,17 @@ void CMedia::clear_cache()
         {
             _right[i].reset();
         }
+        if ( _packed )
+        {
+            _packed[i].reset();
+            _packed_right[i].reset();
+        }
     }
 
+    _left_cached.clear();
+    _right_cached.clear();
+    _expanded.clear();
+
     if ( _stereo[0] )
     {
         _stereo[0].reset();
@@ -825,6 +853,16 @@ void CMedia::update_frame( const int64_t& f )
     boost::uint64_t i = f - _frame_start;
     if ( _sequence[i] )        _sequence[i].reset();
     if ( _right && _right[i] )    _right[i].reset();
+    if ( _packed )
+    {
+        _packed[i].reset();
+        _packed_right[i].reset();
+    }
+    _left_cached.erase( i );
+    _right_cached.erase( i );
+
+    FrameCache::instance().erase( this, f, FrameCache::kLeftEye );
+    FrameCache::instance().erase( this, f, FrameCache::kRightEye );
 
     _hires.reset();
     _stereo[0].reset();
@@ -872,6 +910,7 @@ void CMedia::wait_for_threads()
  */
 CMedia::~CMedia()
 {
+    ReadAhead::instance().forget( this );
 
     SCOPED_LOCK( _mutex );
     SCOPED_LOCK( _audio_mutex );
@@ -929,6 +968,8 @@ CMedia::~CMedia()
 
 
     clear_cache();
+    FrameCache::instance().erase( this );
+    FrameCache::instance().priority( this, FrameCache::kNormalPriority );
 
     delete [] _sequence;
     _sequence = NULL;
@@ -936,6 +977,16 @@ CMedia::~CMedia()
     delete [] _right;
     _right = NULL;
 
+    delete [] _packed;
+    _packed = NULL;
+
+    delete [] _packed_right;
+    _packed_right = NULL;
+
+    _left_cached.clear();
+    _right_cached.clear();
+    _expanded.clear();
+
 
 
 
@@ -1704,11 +1755,23 @@ void CMedia::sequence( const char* fileroot,
     _frameEnd = _frameOut = _frame_end = end;
 
 
+    FrameCache::instance().erase( this );
+
     delete [] _sequence;
     _sequence = NULL;
     delete [] _right;
     _right = NULL;
 
+    delete [] _packed;
+    _packed = NULL;
+
+    delete [] _packed_right;
+    _packed_right = NULL;
+
+    _left_cached.clear();
+    _right_cached.clear();
+    _expanded.clear();
+
     uint64_t num = _frame_end - _frame_start + 1;
 
 
@@ -1722,6 +1785,8 @@ void CMedia::sequence( const char* fileroot,
     {
         _sequence = new mrv::image_type_ptr[ (unsigned) num ];
         _right    = new mrv::image_type_ptr[ (unsigned) num ];
+        _packed       = new mrv::PackedFrame_ptr[ (unsigned) num ];
+        _packed_right = new mrv::PackedFrame_ptr[ (unsigned) num ];
     }
 
 
@@ -1913,12 +1978,25 @@ bool CMedia::has_changed()
         if ( idx >= num )   idx = num - 1;
         else if ( idx < 0 ) idx = 0;
 
-        if ( !_sequence[idx] ||
-             _sequence[idx]->mtime() != sbuf.st_mtime ||
-             _sequence[idx]->ctime() != sbuf.st_ctime )
+        // Frames kept packed have not changed if their file has not.
+        bool changed;
+        if ( _sequence[idx] )
+            changed = ( _sequence[idx]->mtime() != sbuf.st_mtime ||
+                        _sequence[idx]->ctime() != sbuf.st_ctime );
+        else if ( _packed[idx] )
+            changed = ( _packed[idx]->mtime() != sbuf.st_mtime ||
+                        _packed[idx]->ctime() != sbuf.st_ctime );
+        else
+            changed = true;
+
+        if ( changed )
         {
             // update frame...
             _sequence[idx].reset();
+            _packed[idx].reset();
+            _left_cached.erase( idx );
+            FrameCache::instance().erase( this, _frame_start + idx,
+                                          FrameCache::kLeftEye );
 
             _is_thumbnail = true;  // to avoid printing errors
             image_type_ptr canvas;
@@ -1965,6 +2043,53 @@ bool CMedia::has_changed()
 }
 
 
+void CMedia::view_region( const mrv::Recti& r )
+{
+    SCOPED_LOCK( _data_mutex );
+    _view_region = r;
+}
+
+mrv::Recti CMedia::view_region() const
+{
+    Mutex& mtx = const_cast< Mutex& >( _data_mutex );
+    SCOPED_LOCK( mtx );
+    return _view_region;
+}
+
+bool CMedia::update_view_region()
+{
+    if ( has_video() ) return false;
+
+    mrv::image_type_ptr pic = left();
+    if ( !pic || pic->has_region( view_region() ) ) return false;
+
+    SCOPED_LOCK( _mutex );
+
+    int64_t f = _frame;
+    if ( is_sequence() && _sequence )
+    {
+        int64_t idx = f - _frame_start;
+        int64_t num = _frame_end - _frame_start + 1;
+        if ( idx >= num )   idx = num - 1;
+        else if ( idx < 0 ) idx = 0;
+
+        _sequence[idx].reset();
+        _packed[idx].reset();
+        _left_cached.erase( idx );
+        FrameCache::instance().erase( this, _frame_start + idx,
+                                      FrameCache::kLeftEye );
+    }
+
+    image_type_ptr canvas;
+    if ( !fetch( canvas, f ) ) return false;
+
+    if ( !is_sequence() ) _hires = canvas;
+    cache( canvas );
+    refresh();
+    return true;
+}
+
+
 /**
  * Change the image size.
  * This function may also set the pixel ratio for some common video
@@ -2343,16 +2468,16 @@ void CMedia::timestamp()
  *
  * @param idx index of cached image in sequence list
  */
-void CMedia::timestamp(const boost::uint64_t idx,
-                       mrv::image_type_ptr*& seq )
+size_t CMedia::timestamp(const boost::uint64_t idx,
+                         mrv::image_type_ptr*& seq )
 {
-    if ( !seq ) return;
+    if ( !seq ) return 0;
 
     mrv::image_type_ptr pic = seq[idx];
 
     struct stat sbuf;
     int result = stat( sequence_filename( pic->frame() ).c_str(), &sbuf );
-    if ( result < 0 ) return;
+    if ( result < 0 ) return 0;
 
     DBG3;
     _ctime = sbuf.st_ctime;
@@ -2364,6 +2489,7 @@ void CMedia::timestamp(const boost::uint64_t idx,
     _disk_space += sbuf.st_size;
     DBG3;
     image_damage( image_damage() | kDamageData );
+    return sbuf.st_size;
 }
 
 
@@ -2730,6 +2856,9 @@ void CMedia::play(const CMedia::Playback dir,
     TRACE( name() << " frame " << frame() );
     _playback = dir;
 
+    // Takes effect on the seek below, which flushes the decoder.
+    DecodeBudget::instance().start( this, max_decode_threads() );
+
     assert( uiMain != NULL );
     assert( _threads.empty() );
 
@@ -2911,6 +3040,8 @@ void CMedia::stop( const bool fg )
 
     _playback = kStopped;
 
+    DecodeBudget::instance().stop( this );
+
     //
     //
     //
@@ -3084,12 +3215,12 @@ bool CMedia::frame( const int64_t f )
     pkt->data = NULL;
 
 
-    if ( ! is_cache_filled( _dts ) )
+    if ( ! is_cache_filled( _dts ) && ! restore_spilled( _dts ) )
     {
         image_type_ptr canvas;
         std::string file = sequence_filename( _dts );
 
-        if ( fs::exists( file ) )
+        if ( DirectoryIndex::instance().exists( file ) )
         {
             timeval now;
             gettimeofday (&now, 0);
@@ -3189,17 +3320,33 @@ void CMedia::update_cache_pic( mrv::image_type_ptr*& seq,
     unsigned w = pic->width();
     unsigned h = pic->height();
 
+    if ( _cache_scale > 0 )
+    {
+        w = std::max( w >> _cache_scale, 1U );
+        h = std::max( h >> _cache_scale, 1U );
+    }
+
     if ( _8bit_cache && pic->pixel_type() != image_type::kByte )
     {
+        // Shrink first, so fewer pixels are converted, and in float.
+        mrv::image_type_ptr src = pic;
+        if ( _cache_scale > 0 ) src.reset( pic->resize( w, h ) );
+
         np.reset( new image_type( pic->frame(), w, h, pic->channels(),
                                   pic->format(), image_type::kByte,
                                   pic->repeat(), pic->pts() ) );
+        np->region( pic->region() );
 
+        const float one_gamma = 1.0f / gamma();
+        mrv::RowReader read( src.get() );
+        mrv::RowWriter write( np.get() );
+        std::vector< ImagePixel > row( w );
         for ( unsigned y = 0; y < h; ++y )
         {
+            read( y, 0, w, &row[0] );
             for ( unsigned x = 0; x < w; ++x )
             {
-                ImagePixel p = pic->pixel( x, y );
+                ImagePixel& p = row[x];
 
                 if ( p.r > 1.0f ) p.r = 1.0f;
                 else if ( p.r < 0.0f ) p.r = 0.f;
@@ -3214,21 +3361,13 @@ void CMedia::update_cache_pic( mrv::image_type_ptr*& seq,
                 else if ( p.a < 0.0f ) p.a = 0.f;
 
                 if ( p.r > 0.f )
-                    p.r = powf( p.r, 1.0f / gamma() );
+                    p.r = powf( p.r, one_gamma );
                 if ( p.g > 0.f )
-                    p.g = powf( p.g, 1.0f / gamma() );
+                    p.g = powf( p.g, one_gamma );
                 if ( p.b > 0.f )
-                    p.b = powf( p.b, 1.0f / gamma() );
-
-                np->pixel( x, y, p );
+                    p.b = powf( p.b, one_gamma );
             }
-        }
-
-        if ( _cache_scale > 0 )
-        {
-            w /= (1 << _cache_scale);
-            h /= (1 << _cache_scale);
-            np.reset( np->resize( w, h ) );
+            write( y, 0, w, &row[0] );
         }
 
         seq[idx] = np;
@@ -3237,8 +3376,6 @@ void CMedia::update_cache_pic( mrv::image_type_ptr*& seq,
     {
         if ( _cache_scale > 0 )
         {
-            w /= (1 << _cache_scale);
-            h /= (1 << _cache_scale);
             np.reset( pic->resize( w, h ) );
             seq[idx] = np;
         }
@@ -3255,7 +3392,94 @@ void CMedia::update_cache_pic( mrv::image_type_ptr*& seq,
     _w = w;
     _h = h;
 
-    timestamp(idx, seq);
+    // Keep the frame compressed, and whole only while it is near the one
+    // shown.
+    const short eye = ( seq == _right ) ? FrameCache::kRightEye :
+                      FrameCache::kLeftEye;
+    mrv::PackedFrame_ptr* packed = ( seq == _right ) ? _packed_right :
+                                   _packed;
+    size_t disk_bytes = timestamp(idx, seq);
+    size_t bytes = seq[idx]->data_size();
+    if ( packed )
+    {
+        packed[idx].reset();
+        if ( _packed_cache )
+        {
+            mrv::PackedFrame* p = mrv::PackedFrame::pack( *seq[idx] );
+            if ( p )
+            {
+                packed[idx].reset( p );
+                bytes = p->data_size();
+                keep_expanded( idx, eye );
+            }
+        }
+    }
+
+    // Runs hold the frames drawn as cached: those valid and decoded
+    // whole.  A frame decoded for a smaller view may not cover a later
+    // one, so is_cache_filled() may load it again.
+    CacheRuns& runs = ( seq == _right ) ? _right_cached : _left_cached;
+    if ( seq[idx]->valid() && seq[idx]->region().empty() )
+        runs.insert( idx );
+    else
+        runs.erase( idx );
+
+    FrameCache::instance().insert( this, _frame_start + idx, eye,
+                                   bytes, disk_bytes );
+}
+
+/**
+ * Keep a packed frame whole, releasing the whole copy of the packed frame
+ * expanded longest ago past kExpandedFrames.
+ *
+ * @param idx  index of the frame in the sequence
+ * @param eye  FrameCache::kLeftEye or FrameCache::kRightEye
+ */
+void CMedia::keep_expanded( const int64_t idx, const short eye )
+{
+    SCOPED_LOCK( _mutex );
+
+    const std::pair< int64_t, short > k( idx, eye );
+    std::deque< std::pair< int64_t, short > >::iterator i =
+        std::find( _expanded.begin(), _expanded.end(), k );
+    if ( i != _expanded.end() ) _expanded.erase( i );
+    _expanded.push_back( k );
+
+    while ( _expanded.size() > kExpandedFrames )
+    {
+        const std::pair< int64_t, short > old = _expanded.front();
+        _expanded.pop_front();
+
+        mrv::image_type_ptr* seq = ( old.second == FrameCache::kRightEye ) ?
+                                   _right : _sequence;
+        mrv::PackedFrame_ptr* packed =
+            ( old.second == FrameCache::kRightEye ) ? _packed_right : _packed;
+        if ( packed[old.first] ) seq[old.first].reset();
+    }
+}
+
+/**
+ * Make whole again the packed frames of a sequence index.
+ *
+ * @param idx  index of the frame in the sequence
+ */
+void CMedia::expand( const int64_t idx )
+{
+    if ( !_packed ) return;
+
+    SCOPED_LOCK( _mutex );
+
+    if ( !_sequence[idx] && _packed[idx] )
+    {
+        _sequence[idx] = _packed[idx]->unpack();
+        keep_expanded( idx, FrameCache::kLeftEye );
+    }
+
+    if ( !_right[idx] && _packed_right[idx] )
+    {
+        _right[idx] = _packed_right[idx]->unpack();
+        keep_expanded( idx, FrameCache::kRightEye );
+    }
 }
 
 /**
@@ -3287,6 +3511,10 @@ mrv::image_type_ptr CMedia::cache( int64_t frame ) const
         else if ( idx >= num ) idx = num - 1;
     }
 
+    // A packed frame is expanded for the caller, not kept whole.
+    if ( !_sequence[idx] && _packed && _packed[idx] )
+        return _packed[idx]->unpack();
+
     return _sequence[idx];
 }
 /**
@@ -3294,6 +3522,28 @@ mrv::image_type_ptr CMedia::cache( int64_t frame ) const
  *
  * @param pic       picture to cache
  */
+void CMedia::cached_frames_stats()
+{
+    std::vector< mrv::image_type_ptr > pics;
+    {
+        SCOPED_LOCK( _mutex );
+        if ( !_sequence ) return;
+
+        const int64_t num = _frame_end - _frame_start + 1;
+        for ( int64_t i = 0; i < num; ++i )
+        {
+            if ( _sequence[i] ) pics.push_back( _sequence[i] );
+            if ( _right && _right[i] ) pics.push_back( _right[i] );
+        }
+    }
+
+    // Pictures are kept alive by pics if evicted meanwhile.
+    std::vector< mrv::image_type_ptr >::const_iterator i = pics.begin();
+    std::vector< mrv::image_type_ptr >::const_iterator e = pics.end();
+    for ( ; i != e && cache_stats; ++i )
+        (*i)->stats();
+}
+
 void CMedia::cache( mrv::image_type_ptr& pic )
 {
     if ( dynamic_cast< const aviImage* >( this )  != NULL
@@ -3309,6 +3559,7 @@ void CMedia::cache( mrv::image_type_ptr& pic )
     if ( !is_sequence() || !_cache_active || !pic )
         return;
 
+    if ( cache_stats ) pic->stats();
 
     _depth = pic->pixel_type();
 
@@ -3351,17 +3602,32 @@ CMedia::Cache CMedia::is_cache_filled(int64_t frame)
     boost::int64_t i = frame - _frame_start;
 
     CMedia::Cache cache = kNoCache;
-    mrv::image_type_ptr pic = _sequence[i];
-    if ( !pic ) return cache;
 
-    if ( !pic->valid() ) return kInvalidFrame;
+    // Frames decoded for a smaller view than the current one are
+    // loaded again.
+    const mrv::Recti view = view_region();
+
+    mrv::image_type_ptr pic = _sequence[i];
+    if ( pic )
+    {
+        if ( !pic->valid() ) return kInvalidFrame;
+        if ( !pic->has_region( view ) ) return cache;
+    }
+    else
+    {
+        if ( !_packed || !_packed[i] ) return cache;
+        if ( !_packed[i]->valid() ) return kInvalidFrame;
+        if ( !_packed[i]->has_region( view ) ) return cache;
+    }
 
     cache = kLeftCache;
 
     if ( _stereo_output != kNoStereo )
     {
         if ( _stereo_input  == kSeparateLayersInput &&
-             _right && _right[i] ) cache = kStereoCache;
+             ( ( _right && _right[i] ) ||
+               ( _packed_right && _packed_right[i] ) ) )
+            cache = kStereoCache;
         else if ( _stereo_input != kSeparateLayersInput && cache == kLeftCache )
             cache = kStereoCache;
     }
@@ -3369,6 +3635,36 @@ CMedia::Cache CMedia::is_cache_filled(int64_t frame)
     return cache;
 }
 
+bool CMedia::cached_runs( const int64_t first, const int64_t last,
+                          const Cache c, CacheRuns::RunList& runs )
+{
+    runs.clear();
+    if ( !_sequence ) return false;
+
+    // Same levels as is_cache_filled(), but for frames decoded only in
+    // part, which are not in the runs.
+    if ( c == kStereoCache && _stereo_output == kNoStereo ) return true;
+
+    _left_cached.runs( first - _frame_start, last - _frame_start, runs );
+
+    if ( c == kStereoCache && _stereo_input == kSeparateLayersInput )
+    {
+        CacheRuns::RunList left, right;
+        left.swap( runs );
+        _right_cached.runs( first - _frame_start, last - _frame_start,
+                            right );
+        CacheRuns::intersect( left, right, runs );
+    }
+
+    CacheRuns::RunList::iterator i = runs.begin();
+    for ( ; i != runs.end(); ++i )
+    {
+        i->first  += _frame_start;
+        i->second += _frame_start;
+    }
+    return true;
+}
+
 
 bool CMedia::is_cache_full()
 {
@@ -3439,6 +3735,7 @@ size_t CMedia::memory() const
         for ( boost::uint64_t i = 0; i < frames; ++i )
         {
             mrv::image_type_ptr s = _sequence[i];
+            if ( _packed && _packed[i] ) r += _packed[i]->data_size();
             if ( !s ) continue;
 
             r += s->data_size();
@@ -3973,80 +4270,150 @@ void CMedia::loop_at_end( const int64_t frame )
 
 void CMedia::limit_video_store( const int64_t f )
 {
-    SCOPED_LOCK( _mutex );
-
     if ( !_sequence ) return;
 
-    uint64_t max_frames = 1; //max_image_frames();
+    // Eviction is global: the least recently used frame of the lowest
+    // priority clip goes first, whichever clip it belongs to.
+    FrameCache::instance().limit( Preferences::max_memory, this, f );
+}
 
-#undef timercmp
-# define timercmp(a, b, CMP)                                                  \
-  (((a).tv_sec == (b).tv_sec) ?					\
-   ((a).tv_usec CMP (b).tv_usec) :                                          \
-   ((a).tv_sec CMP (b).tv_sec))
+/**
+ * Release a cached frame.  Called by the frame cache when evicting.
+ *
+ * @param f          frame to release
+ * @param eye        FrameCache::kLeftEye or FrameCache::kRightEye
+ * @param disk_bytes size of the frame on disk
+ */
+void CMedia::evict_frame( const int64_t f, const short eye,
+                          const size_t disk_bytes )
+{
+    if ( !_sequence || f < _frame_start || f > _frame_end ) return;
 
-    struct customMore {
-        inline bool operator()( const timeval& a,
-                                const timeval& b ) const
+    uint64_t idx = f - _frame_start;
+
+    mrv::image_type_ptr* seq = ( eye == FrameCache::kRightEye ) ?
+                               _right : _sequence;
+    mrv::PackedFrame_ptr* packed = ( eye == FrameCache::kRightEye ) ?
+                                   _packed_right : _packed;
+    if ( !seq || !( seq[idx] || ( packed && packed[idx] ) ) ) return;
+
+    // Frames decoded only in part are not spilled, as their key does not
+    // tell which part.
+    DiskCache& spill = DiskCache::instance();
+    if ( spill.active() )
+    {
+        if ( seq[idx] )
         {
-            return timercmp( a, b, < );
+            if ( seq[idx]->valid() && seq[idx]->region().empty() )
+                spill.store( spill_key( f, eye, seq[idx]->mtime() ),
+                             seq[idx] );
         }
-    };
+        else if ( packed[idx]->valid() &&
+                  packed[idx]->has_region( mrv::Recti() ) )
+        {
+            spill.store( spill_key( f, eye, packed[idx]->mtime() ),
+                         packed[idx] );
+        }
+    }
 
+    seq[idx].reset();
+    if ( packed ) packed[idx].reset();
+    if ( seq == _right ) _right_cached.erase( idx );
+    else                 _left_cached.erase( idx );
+    _disk_space -= disk_bytes;
+    _cache_full = 0;
+}
 
-    uint64_t num  = _frame_end - _frame_start + 1;
+/**
+ * Key of a frame in the disk cache.  Made of the source file, its
+ * modification time and the settings the cached frames depend on.
+ *
+ * @param f      frame
+ * @param eye    FrameCache::kLeftEye or FrameCache::kRightEye
+ * @param mtime  modification time of the source file
+ */
+std::string CMedia::spill_key( const int64_t f, const short eye,
+                               const time_t mtime ) const
+{
+    std::ostringstream key;
+    key << sequence_filename( f ) << '|' << mtime << '|' << f << '|'
+        << eye << '|' << _cache_scale << '|' << _8bit_cache << '|'
+        << ( _channel ? _channel : "" );
+    return key.str();
+}
 
-    typedef std::map< timeval, uint64_t, customMore > TimedSeqMap;
+/**
+ * Put back in the sequence cache a frame spilled to the disk cache.  Its
+ * pixels are mapped from the cache file, not copied.
+ *
+ * @param f  frame to restore
+ *
+ * @return true if the frame was restored
+ */
+bool CMedia::restore_spilled( const int64_t f )
+{
+    DiskCache& spill = DiskCache::instance();
+    if ( !spill.active() ) return false;
 
-    TimedSeqMap tmp;
-    for ( uint64_t i = 0; i < num; ++i )
-    {
-        if ( !_sequence[i] || _sequence[i]->data_size() == 0 )
-            continue;
+    SCOPED_LOCK( _mutex );
 
-        tmp.insert( std::make_pair( _sequence[i]->ptime(), i ) );
-    }
+    if ( !_sequence || f < _frame_start || f > _frame_end ) return false;
 
+    const int64_t idx = f - _frame_start;
+    if ( _sequence[idx] || ( _packed && _packed[idx] ) ) return false;
 
-    uint64_t image_count = tmp.size();
-    TimedSeqMap::iterator it = tmp.begin();
+    // The windows of a frame are known once decoded.  Frames spilled by
+    // a previous session are not used before that.
+    if ( ( _dataWindow && _dataWindow[idx].w() == 0 ) ||
+         ( _displayWindow && _displayWindow[idx].w() == 0 ) )
+        return false;
+
+    // Most frames missed were never spilled.  Look them up before the
+    // source, as the key needs its modification time.
+    if ( !spill.may_hold( spill_key( f, FrameCache::kLeftEye, 0 ) ) )
+        return false;
 
-    // std::cerr << "mem used: " << (memory_used / 1024 / 1024) << " max mem "
-    //           << (Preferences::max_memory / 1024 / 1024) << std::endl;
-    // std::cerr << "image_count: " << image_count << " max frames "
-    //           << max_frames << std::endl;
+    struct stat sbuf;
+    if ( stat( sequence_filename( f ).c_str(), &sbuf ) < 0 ) return false;
+
+    mrv::image_type_ptr left = spill.fetch( spill_key( f, FrameCache::kLeftEye,
+                                                       sbuf.st_mtime ) );
+    if ( !left ) return false;
 
-    // Erase enough frames to make sure memory used is less than max memory
-    for ( ; it != tmp.end() && memory_used >= Preferences::max_memory; ++it )
+    // Only separate layers cache a right eye.  Other stereo inputs split
+    // the left frame when drawn, so no right spill is ever written.
+    mrv::image_type_ptr right;
+    if ( _stereo_output != kNoStereo &&
+         _stereo_input == kSeparateLayersInput && _right && !_right[idx] )
     {
-        uint64_t idx = it->second;
+        right = spill.fetch( spill_key( f, FrameCache::kRightEye,
+                                        sbuf.st_mtime ) );
+        if ( !right ) return false;
+    }
 
-        if ( image_count <= max_frames ) break;
+    _ctime = sbuf.st_ctime;
+    _mtime = sbuf.st_mtime;
+    _depth = left->pixel_type();
+    _w = left->width();
+    _h = left->height();
 
-        if ( _sequence[idx] )
-        {
-            std::string file = sequence_filename( _sequence[idx]->frame() );
-            struct stat sbuf;
-            int result = stat( file.c_str(), &sbuf );
-            if ( result == 0 ) {
-                _disk_space -= sbuf.st_size;
-            }
-            _sequence[ idx ].reset();
-            --image_count;
-        }
+    _sequence[idx] = left;
+    _left_cached.insert( idx );
+    _disk_space += sbuf.st_size;
+    FrameCache::instance().insert( this, f, FrameCache::kLeftEye,
+                                   left->data_size(), sbuf.st_size );
 
-        if ( _right && _right[idx] ) {
-            std::string file = sequence_filename( _right[idx]->frame() );
-            struct stat sbuf;
-            int result = stat( file.c_str(), &sbuf );
-            if ( result == 0 ) {
-                _disk_space -= sbuf.st_size;
-            }
-            _right[ idx ].reset();
-        }
+    if ( right )
+    {
+        _right[idx] = right;
+        _right_cached.insert( idx );
+        _disk_space += sbuf.st_size;
+        FrameCache::instance().insert( this, f, FrameCache::kRightEye,
+                                       right->data_size(), sbuf.st_size );
     }
 
-
+    image_damage( image_damage() | kDamageData );
+    return true;
 }
 
 void CMedia::preroll( const int64_t f )
@@ -4327,8 +4694,20 @@ bool CMedia::find_image( const int64_t frame )
     // the cache.
     bool limit = false;
 
-    if ( _sequence && _sequence[idx] && _sequence[idx]->valid() )
+    expand( idx );
+    restore_spilled( _frame_start + idx );
+
+    // A frame decoded for a smaller view is loaded again.
+    const bool partial = ( _sequence && _sequence[idx] &&
+                           !_sequence[idx]->has_region( view_region() ) );
+
+    if ( _sequence && _sequence[idx] && _sequence[idx]->valid() && !partial )
     {
+        FrameCache::instance().touch( this, _frame_start + idx );
+        if ( _right && _right[idx] )
+            FrameCache::instance().touch( this, _frame_start + idx,
+                                          FrameCache::kRightEye );
+
         SCOPED_LOCK( _mutex );
 
         if ( _frame != frame )
@@ -4355,7 +4734,7 @@ bool CMedia::find_image( const int64_t frame )
     std::string file = sequence_filename(f);
     std::string old  = sequence_filename(_frame);
 
-    if ( !internal() && file != old  )
+    if ( !internal() && ( file != old || partial ) )
     {
         should_load = true;
         av_free( _filename );
@@ -4371,7 +4750,8 @@ bool CMedia::find_image( const int64_t frame )
     if ( should_load )
     {
         image_type_ptr canvas;
-        if ( fs::exists(file) )
+        if ( _sequence ) FrameCache::instance().miss();
+        if ( DirectoryIndex::instance().exists( file ) )
         {
             SCOPED_LOCK( _mutex );
             SCOPED_LOCK( _audio_mutex );
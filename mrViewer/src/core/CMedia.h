@@ -64,6 +64,9 @@
 #include "core/mrvImagePixel.h"
 #include "core/mrvRectangle.h"
 #include "core/mrvAudioEngine.h"
+#include "core/mrvAudioStore.h"
+#include "core/mrvCacheRuns.h"
+#include "core/mrvPackedFrame.h"
 #include "core/mrvOS.h"
 #include "core/mrvBarrier.h"
 #include "core/mrvACES.h"
@@ -266,7 +269,7 @@ public:
     typedef std::vector< subtitle_info_t >   subtitle_info_list_t;
 
 
-    typedef std::deque< mrv::audio_type_ptr > audio_cache_t;
+    typedef mrv::AudioStore audio_cache_t;
 
     struct TransformId
     {
@@ -422,6 +425,10 @@ public:
     bool refetch( const int64_t frame );
     bool refetch();
 
+    /// Put back in the sequence cache a frame spilled to the disk cache
+    /// when evicted.  Returns false if it is not there.
+    bool restore_spilled( const int64_t frame );
+
     inline void actual_frame_rate( double fps ) { _actual_frame_rate = fps; }
     inline double actual_frame_rate() const { return _actual_frame_rate; }
 
@@ -563,6 +570,16 @@ public:
     ////////////////// Check if image has changed on disk or network
     virtual bool has_changed();
 
+    // Part of the picture in view, in pixels of the picture.  Readers
+    // that can decode part of a picture may decode only this.  An empty
+    // region means all of it.
+    void view_region( const mrv::Recti& r );
+    mrv::Recti view_region() const;
+
+    // Fetch the current frame again if its picture lacks part of the
+    // view region.  Returns true if it did.
+    bool update_view_region();
+
     // Clear the sequence 8-bit cache
     virtual void clear_cache();
 
@@ -579,6 +596,12 @@ public:
     // Returns true if cache for the frame is already filled, false if not
     virtual Cache is_cache_filled(int64_t frame);
 
+    // Runs of frames within [first, last] for which is_cache_filled()
+    // returns c or more.  Returns false if the image keeps no record of
+    // its cached frames, and is_cache_filled() has to be asked instead.
+    virtual bool cached_runs( const int64_t first, const int64_t last,
+                              const Cache c, CacheRuns::RunList& runs );
+
     // For sequences, returns true if cache is all filled, false if not
     // For videos, returns false always
     bool is_cache_full();
@@ -590,6 +613,15 @@ public:
     // Store a frame in sequence cache
     void cache( mrv::image_type_ptr& pic );
 
+    // Compute the statistics of the frames cached before cache_stats was
+    // turned on.  Slow, meant to run in the background.
+    void cached_frames_stats();
+
+    // Release a frame of the sequence cache (called by mrv::FrameCache
+    // with the video mutex held).
+    void evict_frame( const int64_t frame, const short eye,
+                      const size_t disk_bytes );
+
     // Return a frame from cache
     mrv::image_type_ptr cache( int64_t frame ) const;
 
@@ -1678,6 +1710,13 @@ public:
         return _8bit_cache;
     }
 
+    static void packed_caches( bool x ) {
+        _packed_cache = x;
+    }
+    static bool packed_caches() {
+        return _packed_cache;
+    }
+
     static void preload_cache( bool x ) {
         _preload_cache = x;
     }
@@ -1737,6 +1776,9 @@ public:
     static LoadLib load_library;
     static std::atomic<int64_t> memory_used;
     static double thumbnail_percent;
+    // Compute the statistics of frames as they are cached, so that
+    // normalizing them needs no pass over their pixels.
+    static std::atomic<bool> cache_stats;
 
 protected:
 
@@ -1800,6 +1842,18 @@ protected:
     void update_cache_pic( mrv::image_type_ptr*& seq,
                            const mrv::image_type_ptr& pic );
 
+    // Keep packed frame idx of an eye whole, releasing the whole copy of
+    // the one expanded longest ago.
+    void keep_expanded( const int64_t idx, const short eye );
+
+    // Make whole the packed frames of sequence index idx.
+    void expand( const int64_t idx );
+
+    // Key of a frame of an eye in the disk cache, for a source file
+    // modified at mtime.
+    std::string spill_key( const int64_t frame, const short eye,
+                           const time_t mtime ) const;
+
     /**
      * Given a frame number, returns whether audio for that frame is already
      * in packet queue.
@@ -1862,8 +1916,9 @@ protected:
         return true;
     };
 
-    /// Get and store the timestamp for a frame in sequence
-    void timestamp( boost::uint64_t idx,
+    /// Get and store the timestamp for a frame in sequence.
+    /// Returns the size of the frame on disk.
+    size_t timestamp( boost::uint64_t idx,
                     mrv::image_type_ptr*& seq );
 
     /// Get time stamp of file on disk
@@ -1928,6 +1983,9 @@ protected:
     virtual void flush_video() {};
     void flush_audio();
 
+    // Most threads the video decoder can use (0 if none)
+    virtual unsigned max_decode_threads() const { return 0; }
+
     void dump_metadata( AVDictionary* m, const std::string prefix = "" );
 
     // Auxiliary function to handle decoding audio in messy new api.
@@ -2060,6 +2118,7 @@ protected:
 
     std::atomic<Damage> _image_damage;     //!< flag specifying image damage
     mrv::Recti  _damageRectangle;  //!< rectangle that changed
+    mrv::Recti  _view_region;      //!< part of picture in view
 
     double      _x, _y;             //!< x,y coordinates in canvas
     double      _scale_x, _scale_y; //!< x,y scale in canvas
@@ -2111,6 +2170,12 @@ protected:
     mrv::image_type_ptr* _sequence; //!< For sequences, holds each float frame
     mrv::image_type_ptr* _right;    //!< For stereo sequences, holds each
     //!  right float frame
+    mrv::PackedFrame_ptr* _packed;        //!< _sequence frames, compressed
+    mrv::PackedFrame_ptr* _packed_right;  //!< _right frames, compressed
+    std::deque< std::pair< int64_t, short > > _expanded; //!< packed frames
+                                                         //!  also kept whole
+    mrv::CacheRuns _left_cached;    //!< whole valid frames of _sequence
+    mrv::CacheRuns _right_cached;   //!< whole valid frames of _right
     ACES::ASC_CDL _sops;            //!< Slope,Offset,Pivot,Saturation
     ACES::ACESclipReader::GradeRefs _grade_refs; //!< SOPS Nodes in ASCII
 
@@ -2183,6 +2248,7 @@ protected:
     static bool _ocio_color_space;
     static bool _all_layers;
     static bool _8bit_cache;
+    static bool _packed_cache;
     static bool _cache_active;
     static bool _preload_cache;
     static int  _cache_scale;
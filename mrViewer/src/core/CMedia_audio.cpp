@@ -962,47 +962,18 @@ void CMedia::timed_limit_audio_store(const int64_t frame)
     if ( max_audio_frames() > max_frames )
         max_frames = max_audio_frames();
 
-#undef timercmp
-# define timercmp(a, b, CMP)					\
-    (((a).tv_sec == (b).tv_sec) ?				\
-     ((a).tv_usec CMP (b).tv_usec) :				\
-     ((a).tv_sec CMP (b).tv_sec))
-
-    struct customMore {
-        inline bool operator()( const timeval& a,
-                                const timeval& b ) const
-        {
-            return timercmp( a, b, < );
-        }
-    };
+    SCOPED_LOCK( _audio_mutex );
 
-    typedef std::multimap< timeval, int64_t, customMore > TimedSeqMap;
-    TimedSeqMap tmp;
-    {
-        SCOPED_LOCK( _audio_mutex );
-        {
-            audio_cache_t::iterator  it = _audio.begin();
-            audio_cache_t::iterator end = _audio.end();
-            for ( ; it != end; ++it )
-            {
-                if ( (*it)->frame() + max_frames < frame )
-                {
-                    tmp.insert( std::make_pair( (*it)->ptime(),
-                                                (*it)->frame() ) );
-                }
-            }
-        }
+    // Erase frames behind us, oldest decoded first.
+    audio_cache_t::FrameList old;
+    _audio.oldest_before( frame - max_frames, old );
 
-        TimedSeqMap::iterator it = tmp.begin();
-        for ( ; it != tmp.end() &&
-                  ( memory_used >= Preferences::max_memory ||
-                    _audio.size() > max_frames ); ++it )
-        {
-            // Remove and erase this audio frame
-            _audio.erase( std::remove_if( _audio.begin(), _audio.end(),
-                                          EqualFunctor( it->second ) ),
-                          _audio.end() );
-        }
+    audio_cache_t::FrameList::const_iterator it = old.begin();
+    for ( ; it != old.end() &&
+              ( memory_used >= Preferences::max_memory ||
+                _audio.size() > max_frames ); ++it )
+    {
+        _audio.erase( *it );
     }
 
 }
@@ -1059,9 +1030,7 @@ void CMedia::limit_audio_store(const int64_t frame)
     }
 #endif
 
-    _audio.erase( std::remove_if( _audio.begin(), _audio.end(),
-                                  NotInRangeFunctor( first, last ) ),
-                  _audio.end() );
+    _audio.keep( first, last );
 
 }
 
@@ -1693,44 +1662,18 @@ CMedia::store_audio( const int64_t audio_frame,
     // Get the audio info from the codec context
     unsigned short channels = _audio_channels;
 
-    audio_type_ptr aud = audio_type_ptr( new audio_type( audio_frame,
-                                         frequency,
-                                         channels,
-                                         buf, size ) );
-    if ( aud.get() == NULL )
-    {
-        IMG_ERROR( _("No memory for audio frame") );
-        IMG_ERROR( _("Audios #") << _audio.size() );
-        return 0;
-    }
-
-    if ( _audio.empty() || _audio.back()->frame() < f )
-    {
-        _audio.push_back( aud );
-    }
-    else
-    {
-        audio_cache_t::iterator end = _audio.end();
-        audio_cache_t::iterator at = std::lower_bound( _audio.begin(),
-                                     end,
-                                     f,
-                                     LessThanFunctor() );
-        // Avoid storing duplicate frames, replace old frame with this one
-        if ( at != end )
-        {
-            if ( (*at)->frame() == f )
-            {
-                at = _audio.erase(at);
-            }
-        }
-
-        _audio.insert( at, aud );
-    }
-
+    // Room for frames on both sides of the playhead, as kept by
+    // limit_audio_store().
+    unsigned max_frames = max_video_frames();
+    if ( max_audio_frames() > max_frames )
+        max_frames = max_audio_frames();
+    _audio.reserve( 2 * max_frames + 2 );
 
-    assert( aud->size() == size );
+    // Replaces any frame decoded twice.
+    unsigned stored = _audio.store( f, frequency, channels, buf, size );
+    assert( stored == size );
 
-    return aud->size();
+    return stored;
 }
 
 
@@ -1932,12 +1875,9 @@ bool CMedia::find_audio( const int64_t frame )
         if ( frame < in_frame() )
             return true;
 
-        audio_cache_t::iterator end = _audio.end();
-        audio_cache_t::iterator i = std::lower_bound( _audio.begin(), end,
-                                                      frame,
-                                                      LessThanFunctor() );
+        result = _audio.lower_bound( frame );
 
-        if ( i == end )
+        if ( !result )
         {
             if ( _audio_offset == 0 && frame <= _frameOut)
             {
@@ -1946,8 +1886,6 @@ bool CMedia::find_audio( const int64_t frame )
             return false;
         }
 
-        result = *i;
-
     }
 
 
@@ -2134,12 +2072,7 @@ bool CMedia::in_audio_store( const int64_t frame )
 {
     SCOPED_LOCK( _audio_mutex );
     // Check if audio is already in audio store
-    audio_cache_t::iterator end = _audio.end();
-    audio_cache_t::iterator i = std::find_if( _audio.begin(), end,
-                                EqualFunctor(frame) );
-    if ( i != end ) return true;
-
-    return false;
+    return _audio.contains( frame );
 }
 
 CMedia::DecodeStatus CMedia::decode_audio( int64_t& f )
@@ -2341,26 +2274,23 @@ void CMedia::debug_audio_stores(const int64_t frame,
 {
     SCOPED_LOCK( _audio_mutex );
 
-    audio_cache_t::const_iterator iter = _audio.begin();
-    audio_cache_t::const_iterator last = _audio.end();
-
     std::cerr << this << std::dec << " " << name()
               << " S:" << _frame << " D:" << _adts
               << " A:" << frame << " " << routine << " audio stores #"
               << _audio.size() << ": ";
 
-    if ( iter != last )
+    if ( !_audio.empty() )
     {
-        std::cerr << (*iter)->frame() << "-" << (*(last-1))->frame();
+        std::cerr << _audio.first() << "-" << _audio.last();
     }
 
     std::cerr << std::endl;
 
-    if (detail )
+    if (detail && !_audio.empty() )
     {
-        for ( ; iter != last; ++iter )
+        for ( int64_t f = _audio.first(); f <= _audio.last(); ++f )
         {
-            int64_t f = (*iter)->frame();
+            if ( !_audio.contains( f ) ) continue;
             if ( f == frame )  std::cerr << "P";
             if ( f == _adts )   std::cerr << "D";
             if ( f == _frame ) std::cerr << "F";
@@ -84,6 +84,7 @@ namespace otime = opentime::OPENTIME_VERSION;
 #include "gui/mrvImageView.h"
 #include "video/mrvGLShape.h"
 #include "core/Sequence.h"
+#include "core/mrvDirectoryIndex.h"
 #include "core/mrvString.h"
 #include "core/mrvTransition.h"
 #include "mrvI8N.h"
@@ -779,41 +780,23 @@ bool get_sequence_limits( boost::int64_t& frameStart,
     }
 
 
-    std::string croot, cview, cframe, cext;
     unsigned pad = 0;
     if ( is_valid_frame_spec( frame ) )
     {
         pad = padded_digits( frame );
     }
 
-
-    fs::directory_iterator e; // default constructor yields path iter. end
-    for ( fs::directory_iterator i( dir ) ; i != e; ++i )
+    boost::int64_t first, last;
+    unsigned fpad;
+    if ( DirectoryIndex::instance().limits( dir.string(), root, view, ext,
+                                            first, last, fpad ) )
     {
-        if ( !fs::exists( *i ) || fs::is_directory( *i ) ) continue;
-
-        std::string tmp = (*i).path().leaf().generic_string();
-
-
-        // Do not continue on false return of split_sequence
-        if ( ! split_sequence( croot, cframe, cview, cext, tmp ) )
-        {
-            continue;
-        }
-
-        if ( cext != ext || croot != root || cview != view )
-        {
-            continue;  // not this sequence
-        }
-
-        if ( cframe[0] == '0' && cframe.size() > 1 && pad == 0 )
-            pad = (unsigned) cframe.size();
-
-
-        boost::int64_t f = atoi( cframe.c_str() );
+        if ( pad == 0 ) pad = fpad;
 
-        if ( f < frameStart || frameStart == AV_NOPTS_VALUE ) frameStart = f;
-        if ( f > frameEnd || frameEnd == AV_NOPTS_VALUE  )   frameEnd   = f;
+        if ( first < frameStart || frameStart == AV_NOPTS_VALUE )
+            frameStart = first;
+        if ( last > frameEnd || frameEnd == AV_NOPTS_VALUE )
+            frameEnd = last;
     }
 
     const char* prdigits = PRId64;
@@ -81,6 +81,8 @@ namespace fs = boost::filesystem;
 #include "core/mrvFrameFunctors.h"
 #include "core/mrvThread.h"
 #include "core/mrvCPU.h"
+#include "core/mrvDecodeBudget.h"
+#include "core/mrvFramePool.h"
 #include "core/mrvColorSpaces.h"
 #include "gui/mrvPreferences.h"
 #include "gui/mrvImageView.h"
@@ -92,6 +94,20 @@ namespace fs = boost::filesystem;
 namespace
 {
     const char* kModule = "avi";
+
+    // Releases the decoded frame a VideoFrame was wrapped around.
+    struct FrameReleaser
+    {
+        AVFrame* frame;
+        FrameReleaser( AVFrame* f ) : frame( f ) {}
+        void operator()( mrv::aligned16_uint8_t* ) { av_frame_free( &frame ); }
+    };
+
+    // Returns a buffer of the decoder to the frame pool.
+    void free_video_buffer( void* opaque, uint8_t* data )
+    {
+        delete (mrv::FramePool::PixelData*) opaque;
+    }
 }
 
 
@@ -127,6 +143,9 @@ namespace
 
 namespace {
 const unsigned int  kMaxCacheImages = 70;
+
+// Same limit FFmpeg uses for "auto" threads.
+const unsigned int  kMaxDecodeThreads = 16;
 }
 
 namespace mrv {
@@ -232,6 +251,13 @@ aviImage::aviImage() :
     _last_cached( false ),
     _max_images( kMaxCacheImages ),
     _inv_table( NULL ),
+    _video_threads( 0 ),
+    _budget_generation( 0 ),
+    _decode_fps( 0.0 ),
+    _decode_start( 0 ),
+    _decode_count( 0 ),
+    _wrapped_frames( 0 ),
+    _copied_frames( 0 ),
     buffersink_ctx( NULL ),
     buffersrc_ctx( NULL ),
     filter_graph( NULL )
@@ -892,12 +918,48 @@ void aviImage::open_video_codec()
 
     avcodec_parameters_from_context( stream->codecpar, _video_ctx );
 
+    // Intra-only codecs (ProRes, DNxHD, ...) slice thread with no added
+    // latency.  Long GOP codecs scale better with frame threads.
+    int thread_type = 0;
+    if ( video_codec )
+    {
+        const AVCodecDescriptor* desc =
+            avcodec_descriptor_get( video_codec->id );
+        bool intra = desc && ( desc->props & AV_CODEC_PROP_INTRA_ONLY );
+        int caps = video_codec->capabilities;
+        if ( intra && ( caps & AV_CODEC_CAP_SLICE_THREADS ) )
+            thread_type = FF_THREAD_SLICE;
+        else if ( caps & AV_CODEC_CAP_FRAME_THREADS )
+            thread_type = FF_THREAD_FRAME;
+        else if ( caps & AV_CODEC_CAP_SLICE_THREADS )
+            thread_type = FF_THREAD_SLICE;
+    }
+
+    // A non-zero preference forces the thread count for all clips.
+    _budget_generation = DecodeBudget::instance().generation();
+    unsigned threads = atoi( Preferences::video_threads.c_str() );
+    if ( threads == 0 )
+        threads = DecodeBudget::instance().threads( this,
+                                                    max_decode_threads() );
+    if ( thread_type == 0 ) threads = 1;
+
+    _video_ctx->thread_count = threads;
+    _video_ctx->thread_type  = thread_type;
+
+    // Let the decoder write frames in the layout of a VideoFrame, so they
+    // need not be copied.
+    if ( video_codec && ( video_codec->capabilities & AV_CODEC_CAP_DR1 ) )
+    {
+        _video_ctx->opaque      = this;
+        _video_ctx->get_buffer2 = get_video_buffer;
+#if FF_API_THREAD_SAFE_CALLBACKS
+        _video_ctx->thread_safe_callbacks = 1;
+#endif
+    }
+
     AVDictionary* info = NULL;
-    std::string threads = Preferences::video_threads;
-    if ( threads == "0" ) threads = "auto";
 
     // refcounted frames needed for subtitles
-    av_dict_set(&info, "threads", threads.c_str(), 0 );
     av_dict_set(&info, "refcounted_frames", "1", 0);
     av_dict_set(&info, "noautorotate", NULL, 0);
 
@@ -905,6 +967,34 @@ void aviImage::open_video_codec()
          avcodec_open2( _video_ctx, video_codec, &info ) < 0 )
         _video_index = -1;
 
+    _video_threads = _video_ctx->thread_count;
+}
+
+unsigned aviImage::max_decode_threads() const
+{
+    AVStream* stream = get_video_stream();
+    if ( stream == NULL ) return 0;
+
+    const AVCodec* codec = avcodec_find_decoder( stream->codecpar->codec_id );
+    if ( !codec ) return 0;
+    if ( !( codec->capabilities & ( AV_CODEC_CAP_FRAME_THREADS |
+                                     AV_CODEC_CAP_SLICE_THREADS ) ) )
+        return 1;
+    return kMaxDecodeThreads;
+}
+
+const char* aviImage::video_thread_type() const
+{
+    if ( !_video_ctx ) return "";
+    switch( _video_ctx->active_thread_type )
+    {
+    case FF_THREAD_FRAME:
+        return _("Frame");
+    case FF_THREAD_SLICE:
+        return _("Slice");
+    default:
+        return _("None");
+    }
 }
 
 void aviImage::close_video_codec()
@@ -928,6 +1018,19 @@ void aviImage::flush_video()
     if ( _video_ctx && _video_index >= 0 )
     {
         SCOPED_LOCK( _mutex );
+
+        // The decoder holds no frames after a flush, so this is where the
+        // thread count can change without losing frames still in flight
+        // in frame threads.  Reopen the codec if our share changed.
+        if ( !stopped() && Preferences::video_threads == "0" &&
+             _video_threads != DecodeBudget::instance().threads(
+                 this, max_decode_threads() ) )
+        {
+            close_video_codec();
+            open_video_codec();
+            if ( _video_index < 0 ) return;
+        }
+
         avcodec_flush_buffers( _video_ctx );
     }
 }
@@ -953,6 +1056,40 @@ CMedia::Cache aviImage::is_cache_filled( int64_t frame )
     return (CMedia::Cache) ok;
 }
 
+bool aviImage::cached_runs( const int64_t first, const int64_t last,
+                            const Cache c, CacheRuns::RunList& runs )
+{
+    runs.clear();
+
+    // Same levels as is_cache_filled().
+    if ( _stereo_input == kSeparateLayersInput && c > kInvalidFrame )
+        return true;
+
+    SCOPED_LOCK( _mutex );
+
+    // The video store is sorted by frame and holds few frames.
+    video_cache_t::const_iterator i = _images.begin();
+    video_cache_t::const_iterator e = _images.end();
+    for ( ; i != e; ++i )
+    {
+        int64_t f = (*i)->frame() + _start_number;
+        int64_t l = f + (*i)->repeat();
+        if ( l < first || f > last ) continue;
+        if ( f < first ) f = first;
+        if ( l > last )  l = last;
+
+        if ( !runs.empty() && f <= runs.back().second + 1 )
+        {
+            if ( l > runs.back().second ) runs.back().second = l;
+        }
+        else
+        {
+            runs.push_back( CacheRuns::Run( f, l ) );
+        }
+    }
+    return true;
+}
+
 // Seek to the requested frame
 bool aviImage::seek_to_position( const int64_t frame )
 {
@@ -1201,10 +1338,103 @@ mrv::image_type_ptr aviImage::allocate_image( const int64_t& frame,
 }
 
 
-void aviImage::store_image( const int64_t frame,
-                            const int64_t pts )
+/**
+ * Allocate the buffer the decoder writes a frame into.  If the frame is
+ * in the pixel format we display and needs no padding, its planes are
+ * packed back to back in a single buffer from the frame pool, which
+ * wrap_image() can then use as is.  Otherwise, ffmpeg's default buffers
+ * are used.
+ *
+ * @param ctx   video codec context
+ * @param frame frame to allocate buffer of
+ * @param flags AV_GET_BUFFER_FLAG_*
+ *
+ * @return 0 on success, a negative AVERROR on failure
+ */
+int aviImage::get_video_buffer( AVCodecContext* ctx, AVFrame* frame,
+                                int flags )
+{
+    const aviImage* img = (const aviImage*) ctx->opaque;
+    const AVPixelFormat fmt = (AVPixelFormat) frame->format;
+    if ( !img || fmt != img->_av_dst_pix_fmt )
+        return avcodec_default_get_buffer2( ctx, frame, flags );
+
+    int w = frame->width;
+    int h = frame->height;
+    int align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2( ctx, &w, &h, align );
+    if ( w != frame->width || h != frame->height )
+        return avcodec_default_get_buffer2( ctx, frame, flags );
+
+    int linesize[4];
+    if ( av_image_fill_linesizes( linesize, fmt, w ) < 0 )
+        return avcodec_default_get_buffer2( ctx, frame, flags );
+
+    for ( int i = 0; i < 4; ++i )
+    {
+        if ( linesize[i] && align[i] && linesize[i] % align[i] )
+            return avcodec_default_get_buffer2( ctx, frame, flags );
+    }
+
+    int size = av_image_get_buffer_size( fmt, w, h, 1 );
+    if ( size <= 0 )
+        return avcodec_default_get_buffer2( ctx, frame, flags );
+
+    FramePool::PixelData* pixels;
+    try {
+        pixels = new FramePool::PixelData( FramePool::instance().acquire(
+                                               size +
+                                               AV_INPUT_BUFFER_PADDING_SIZE ) );
+    }
+    catch( const std::bad_alloc& )
+    {
+        return AVERROR(ENOMEM);
+    }
+
+    frame->buf[0] = av_buffer_create( (uint8_t*) pixels->get(), size,
+                                      free_video_buffer, pixels, 0 );
+    if ( !frame->buf[0] )
+    {
+        delete pixels;
+        return AVERROR(ENOMEM);
+    }
+
+    av_image_fill_arrays( frame->data, frame->linesize, frame->buf[0]->data,
+                          fmt, w, h, 1 );
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+/**
+ * Count a decoded frame, to measure the decoder's frame rate.
+ *
+ */
+void aviImage::count_decoded_frame()
 {
+    int64_t now = av_gettime_relative();
+    if ( _decode_start == 0 ) _decode_start = now;
+    ++_decode_count;
 
+    int64_t elapsed = now - _decode_start;
+    if ( elapsed >= 1000000 )
+    {
+        _decode_fps = double(_decode_count) * 1000000.0 / double(elapsed);
+        _decode_count = 0;
+        _decode_start = now;
+    }
+}
+
+/**
+ * Convert the decoded frame with swscale into a newly allocated video frame.
+ *
+ * @param frame frame number
+ * @param pts   presentation timestamp of frame
+ *
+ * @return the video frame or an empty pointer on error
+ */
+mrv::image_type_ptr aviImage::convert_image( const int64_t frame,
+                                             const int64_t pts )
+{
     mrv::image_type_ptr image;
     try {
         image = allocate_image( frame, pts );
@@ -1212,12 +1442,12 @@ void aviImage::store_image( const int64_t frame,
     catch ( const std::bad_alloc& )
     {
         LOG_ERROR( _("Not enough memory for image") );
-        return;
+        return mrv::image_type_ptr();
     }
     catch ( const std::exception& e )
     {
         LOG_ERROR( _("Problem allocating image ") << e.what() );
-        return;
+        return mrv::image_type_ptr();
     }
 
 
@@ -1226,7 +1456,7 @@ void aviImage::store_image( const int64_t frame,
         IMG_ERROR( "No memory for video frame" );
         IMG_ERROR( "Audios #" << _audio.size() );
         IMG_ERROR( "Videos #" << _images.size() );
-        return;
+        return mrv::image_type_ptr();
     }
 
     AVFrame output = { 0 };
@@ -1281,7 +1511,7 @@ void aviImage::store_image( const int64_t frame,
     if ( _convert_ctx == NULL )
     {
         IMG_ERROR( _("Could not get image conversion context.") );
-        return;
+        return mrv::image_type_ptr();
     }
 
     int in_full, out_full, brightness, contrast, saturation;
@@ -1338,10 +1568,106 @@ void aviImage::store_image( const int64_t frame,
     sws_scale(_convert_ctx, _av_frame->data, _av_frame->linesize,
               0, _av_frame->height, output.data, output.linesize);
 
+    return image;
+}
+
+/**
+ * Use the decoded frame as a video frame without copying its pixels.
+ * This is only possible if the decoder output the pixel format we
+ * display, with its planes packed one after the other in a single buffer,
+ * as VideoFrame expects them.  See get_video_buffer().
+ *
+ * @param frame frame number
+ * @param pts   presentation timestamp of frame
+ *
+ * @return the video frame or an empty pointer if it needs converting
+ */
+mrv::image_type_ptr aviImage::wrap_image( const int64_t frame,
+                                          const int64_t pts )
+{
+    mrv::image_type_ptr image;
+
+    // Colorspace and range changes need swscale.
+    if ( _av_frame->format != _av_dst_pix_fmt || _inv_table ) return image;
+    if ( !_av_frame->buf[0] || _av_frame->buf[1] ) return image;
+
+    const int w = _av_frame->width;
+    const int h = _av_frame->height;
+    if ( w != (int)width() || h != (int)height() ) return image;
+    if ( ( w > mrv::GLEngine::maxTexWidth() &&
+           mrv::GLEngine::maxTexWidth() > 0 ) ||
+         ( h > mrv::GLEngine::maxTexHeight() &&
+           mrv::GLEngine::maxTexHeight() > 0 ) )
+        return image;
+
+    uint8_t* data[4];
+    int linesize[4];
+    int size = av_image_fill_arrays( data, linesize, _av_frame->data[0],
+                                     _av_dst_pix_fmt, w, h, 1 );
+    if ( size <= 0 ) return image;
+
+    for ( int i = 0; i < 4; ++i )
+    {
+        if ( data[i] != _av_frame->data[i] ||
+             linesize[i] != _av_frame->linesize[i] )
+            return image;
+    }
+
+    const AVBufferRef* buf = _av_frame->buf[0];
+    if ( _av_frame->data[0] + size > buf->data + buf->size ) return image;
+
+    AVFrame* ref = av_frame_clone( _av_frame );
+    if ( !ref ) return image;
+
+    image_type::PixelData pixels( (mrv::aligned16_uint8_t*) ref->data[0],
+                                  FrameReleaser( ref ) );
+    image.reset( new image_type( frame, w, h,
+                                 (unsigned short) _num_channels,
+                                 _pix_fmt, _ptype,
+                                 _av_frame->repeat_pict, pts,
+                                 pixels ) );
+    if ( image->data_size() != size_t(size) ) image.reset();
+    return image;
+}
+
+void aviImage::store_image( const int64_t frame,
+                            const int64_t pts )
+{
+    mrv::image_type_ptr image = wrap_image( frame, pts );
+    if ( image )
+    {
+        // The pixels keep the range of the source.  Unspecified is
+        // limited range, as swscale takes it.
+        switch( _av_frame->format )
+        {
+        case AV_PIX_FMT_YUVJ420P:
+        case AV_PIX_FMT_YUVJ422P:
+        case AV_PIX_FMT_YUVJ440P:
+        case AV_PIX_FMT_YUVJ444P:
+            _av_frame->color_range = AVCOL_RANGE_JPEG;
+            break;
+        default:
+            if ( _av_frame->color_range != AVCOL_RANGE_JPEG )
+                _av_frame->color_range = AVCOL_RANGE_MPEG;
+            break;
+        }
+        ++_wrapped_frames;
+    }
+    else
+    {
+        image = convert_image( frame, pts );
+        if ( !image ) return;
+        ++_copied_frames;
+    }
+
+    count_decoded_frame();
+
     if ( _av_frame->interlaced_frame )
         _interlaced = ( _av_frame->top_field_first ?
                         kTopFieldFirst : kBottomFieldFirst );
 
+    if ( cache_stats ) image->stats();
+
     SCOPED_LOCK( _mutex );
 
     if ( _images.empty() || _images.back()->frame() < frame )
@@ -1593,6 +1919,52 @@ aviImage::decode_video_packet( int64_t& ptsframe,
     return err;
 }
 
+/**
+ * Reopen the video codec with our share of the decode budget, if clips
+ * started or stopped since it was opened.  Called before decoding a
+ * keyframe, so the new codec can start from it.  Frames still in flight
+ * in the decoder's threads are drained and stored first.
+ *
+ * @param frame frame being decoded
+ */
+void aviImage::rebalance_video_threads( const int64_t frame )
+{
+    DecodeBudget& budget = DecodeBudget::instance();
+    if ( _budget_generation == budget.generation() ) return;
+    _budget_generation = budget.generation();
+
+    if ( stopped() || Preferences::video_threads != "0" ||
+         _video_threads == budget.threads( this, max_decode_threads() ) )
+        return;
+
+    // A NULL packet puts the decoder in draining mode: it then returns
+    // all frames it holds, and AVERROR_EOF once done.
+    int ret = avcodec_send_packet( _video_ctx, NULL );
+    if ( ret < 0 && ret != AVERROR_EOF )
+    {
+        char buf[128];
+        av_strerror( ret, buf, 128 );
+        IMG_ERROR( _("send_packet error: ") << buf );
+    }
+    else
+    {
+        Mutex& mtx = _video_packets.mutex();
+        SCOPED_LOCK( mtx );
+
+        aviData data;
+        data.avi = this;
+        data.pkt = NULL;
+        data.frame = frame;
+        while ( avcodec_receive_frame( _video_ctx, _av_frame ) == 0 )
+            process_video_frame_cb( data );
+    }
+    av_frame_unref( _av_frame );
+
+    SCOPED_LOCK( _mutex );
+    close_video_codec();
+    open_video_codec();
+}
+
 
 
 // Decode the image
@@ -3667,18 +4039,11 @@ aviImage::audio_video_display( const int64_t& frame )
     else if ( frame < _frameIn ) return kDecodeLoopStart;
 
     SCOPED_LOCK( _audio_mutex );
-    audio_type_ptr result;
-
-    audio_cache_t::iterator end = _audio.end();
-    audio_cache_t::iterator it = std::lower_bound( _audio.begin(), end,
-                                                   frame,
-                                                   LessThanFunctor() );
-    if ( it == end ) {
+    audio_type_ptr result = _audio.lower_bound( frame );
+    if ( !result ) {
         return kDecodeMissingFrame;
     }
 
-    result = *it;
-
 
     SCOPED_LOCK( _mutex );
 
@@ -3912,6 +4277,12 @@ CMedia::DecodeStatus aviImage::decode_video( int64_t& f )
             }
 
 
+            if ( pkt.flags & AV_PKT_FLAG_KEY )
+            {
+                rebalance_video_threads( pktframe );
+                if ( _video_index < 0 ) return kDecodeError;
+            }
+
             got_video = decode_image( pktframe, pkt );
             _video_packets.pop_front();
             continue;
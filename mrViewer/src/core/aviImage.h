@@ -95,6 +95,9 @@ public:
 
     virtual Cache is_cache_filled( int64_t frame );
 
+    virtual bool cached_runs( const int64_t first, const int64_t last,
+                              const Cache c, CacheRuns::RunList& runs );
+
     virtual int64_t wait_subtitle();
 
     virtual void wait_image();
@@ -141,6 +144,19 @@ public:
 
     virtual void flush_video();
     virtual DecodeStatus decode_video( int64_t& frame );
+
+    virtual unsigned max_decode_threads() const;
+
+    // Threads used by the video decoder and how (Frame or Slice)
+    inline unsigned video_threads() const { return _video_threads; }
+    const char* video_thread_type() const;
+
+    // Frames decoded per second, over the last second of decoding
+    inline double decode_fps() const { return _decode_fps; }
+
+    // Decoded frames used without a copy and frames converted by swscale
+    inline uint64_t wrapped_frames() const { return _wrapped_frames; }
+    inline uint64_t copied_frames() const { return _copied_frames; }
     virtual DecodeStatus decode_subtitle( const int64_t frame );
 
     virtual void subtitle_stream( int idx );
@@ -208,6 +224,11 @@ protected:
     void open_video_codec();
     void close_video_codec();
 
+    // Reopen the video codec if our share of the decode budget changed.
+    void rebalance_video_threads( const int64_t frame );
+
+    void count_decoded_frame();
+
     DecodeStatus handle_video_packet_seek( int64_t& frame,
                                            const bool is_seek );
 
@@ -285,6 +306,13 @@ protected:
     int video_stream_index() const;
     mrv::image_type_ptr allocate_image(const int64_t& frame,
                                        const int64_t& pts);
+    mrv::image_type_ptr convert_image( const int64_t frame,
+                                       const int64_t pts );
+    mrv::image_type_ptr wrap_image( const int64_t frame,
+                                    const int64_t pts );
+
+    static int get_video_buffer( AVCodecContext* ctx, AVFrame* frame,
+                                 int flags );
 
 
     AVStream* get_subtitle_stream() const;
@@ -330,6 +358,14 @@ protected:
     unsigned int          _max_images;
     const int*            _inv_table;
 
+    unsigned              _video_threads;  //!< threads of video decoder
+    unsigned              _budget_generation; //!< of _video_threads
+    std::atomic<double>   _decode_fps;
+    int64_t               _decode_start;   //!< start of fps measure
+    unsigned              _decode_count;   //!< frames decoded since then
+    std::atomic<uint64_t> _wrapped_frames; //!< frames stored without a copy
+    std::atomic<uint64_t> _copied_frames;  //!< frames converted by swscale
+
     std::string           _right_filename;
     std::string           _subtitle_dir;
     std::string           _subtitle_file;
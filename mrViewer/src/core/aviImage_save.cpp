@@ -1271,21 +1271,12 @@ audio_type_ptr CMedia::get_audio_frame(const int64_t f )
                                                audio_channels(), data, size) );
     }
 
-    audio_cache_t::iterator end = _audio.end();
-    audio_cache_t::iterator i = end;
 #if 1  // less correct
-    {
-        i = std::lower_bound( _audio.begin(), end, x, LessThanFunctor() );
-        if ( i != end ) {
-            return *i;
-        }
-    }
+    audio_type_ptr r = _audio.lower_bound( x );
 #else
-    {
-        i = std::find_if( _audio.begin(), end, EqualFunctor(x) );
-        if ( i != end ) return *i;
-    }
+    audio_type_ptr r = _audio.find( x );
 #endif
+    if ( r ) return r;
 
     IMG_ERROR( _("Missing audio frame ") << x );
     return audio_type_ptr( new audio_type( AV_NOPTS_VALUE, audio_frequency(),
@@ -59,6 +59,8 @@
 #include <ImfTimeCodeAttribute.h>
 #include <ImfFramesPerSecond.h>
 #include <ImfRgbaYca.h>
+#include <ImfIO.h>
+#include <ImfInt64.h>
 
 #include "core/mrvACES.h"
 #include "core/mrvThread.h"
@@ -80,6 +82,93 @@ using namespace std;
 namespace
 {
 const char* kModule = "exr";
+
+//
+// Output stream that only hashes what is written to it (64-bit FNV-1a),
+// to compare headers of frames without copying their attributes.
+//
+class HashStream : public Imf::OStream
+{
+public:
+    HashStream() : Imf::OStream( "hash" ), _hash( 14695981039346656037ULL ),
+                   _pos( 0 )
+    {
+    }
+
+    virtual void write( const char c[], int n )
+    {
+        for ( int i = 0; i < n; ++i )
+        {
+            _hash ^= (unsigned char) c[i];
+            _hash *= 1099511628211ULL;
+        }
+        _pos += n;
+    }
+
+    virtual Imf::Int64 tellp() { return _pos; }
+    virtual void seekp( Imf::Int64 pos ) { _pos = pos; }
+
+    void add( const std::string& s )
+    {
+        write( s.c_str(), int( s.size() ) + 1 );
+    }
+
+    boost::uint64_t hash() const { return _hash; }
+
+protected:
+    boost::uint64_t _hash;
+    Imf::Int64      _pos;
+};
+
+void hash_attribute( HashStream& s, const std::string& name,
+                     const Imf::Attribute& attr )
+{
+    s.add( name );
+    s.add( attr.typeName() );
+    attr.writeValueTo( s, EXR_VERSION );
+}
+
+// Hash of the attributes of a header that lay out its pixels
+boost::uint64_t layout_hash( const Imf::Header& h )
+{
+    static const char* names[] = {
+        "channels", "dataWindow", "displayWindow", "tiles", "type",
+        "name", "view", NULL
+    };
+
+    HashStream s;
+    for ( const char** n = names; *n; ++n )
+    {
+        Imf::Header::ConstIterator i = h.find( *n );
+        if ( i != h.end() ) hash_attribute( s, *n, i.attribute() );
+    }
+    return s.hash();
+}
+
+// Attributes that may change with each frame of a sequence, by their
+// name in the header and the one they are shown with.
+struct FrameAttribute
+{
+    const char* name;
+    const char* shown;
+    bool        translated;
+};
+
+const FrameAttribute kFrameAttributes[] = {
+    { "timeCode",      "timecode",          false },
+    { "keyCode",       "keyCode",           false },
+    { "capDate",       "capDate",           false },
+    { "utcOffset",     N_("UTC Offset"),    true },
+    { "expTime",       N_("Exposure Time"), true },
+    { "aperture",      N_("Aperture"),      true },
+    { "isoSpeed",      N_("ISO Speed"),     true },
+    { "focus",         N_("Focus"),         true },
+    { "comments",      N_("Comments"),      true },
+    { "worldToCamera", "worldToCamera",     false },
+    { "worldToNDC",    "worldToNDC",        false },
+    { NULL,            NULL,                false }
+};
+
 }
 
 
@@ -192,9 +281,13 @@ exrImage::exrImage() :
     _numparts( -1 ),
     _lineOrder( (Imf::LineOrder) 0 ),
     _compression( (Imf::Compression) 0 ),
-    _aces( false )
+    _aces( false ),
+    _header_frame( AV_NOPTS_VALUE ),
+    _header_layout( 0 )
 {
     st[0] = st[1] = -1;
+    _layout.hash = 0;
+    _layout.slices = false;
 
     if ( ignore.empty() ) fill_ignore_attr();
 }
@@ -273,7 +366,34 @@ bool exrImage::channels_order(
     }
     if ( ext == "Z" ) Zchannel = true;
 
-    for (Imf::ChannelList::ConstIterator i = s; i != e; ++i, ++idx )
+    // Frames of a sequence share their layout, so the channels chosen for
+    // the last frame are reused if its header lays out the same pixels.
+    const boost::uint64_t hash = layout_hash( h );
+    std::string key = c;
+    if ( s != e )
+    {
+        key += '\n';
+        key += s.name();
+        key += '\n';
+        key += ( e == channels.end() ? "" : e.name() );
+    }
+
+    bool cached = ( _layout.hash == hash && _layout.key == key );
+    if ( cached )
+    {
+        channelList = _layout.names;
+        imfPixelType = _layout.type;
+        for ( int k = 0; k < 4; ++k )
+        {
+            order[k] = _layout.order[k];
+            xsampling[k] = _layout.xsampling[k];
+            ysampling[k] = _layout.ysampling[k];
+        }
+        if ( _layout.alpha ) _has_alpha = true;
+    }
+
+    for (Imf::ChannelList::ConstIterator i = s; !cached && i != e;
+         ++i, ++idx )
     {
         const std::string& layerName = i.name();
         const Imf::Channel& ch = i.channel();
@@ -360,6 +480,22 @@ bool exrImage::channels_order(
     }
 
 
+    if ( !cached )
+    {
+        _layout.hash = hash;
+        _layout.key = key;
+        _layout.names = channelList;
+        _layout.type = imfPixelType;
+        for ( int k = 0; k < 4; ++k )
+        {
+            _layout.order[k] = order[k];
+            _layout.xsampling[k] = xsampling[k];
+            _layout.ysampling[k] = ysampling[k];
+        }
+        _layout.alpha = ( order[3] != -1 );
+        _layout.slices = false;
+    }
+
     size_t numChannels = channelList.size();
 
     if ( numChannels == 0 )
@@ -377,64 +513,84 @@ bool exrImage::channels_order(
     }
 
 
-    // Prepare format
+    // Prepare format, or take it and the slices from the last frame of
+    // this layout.
     image_type::Format format = VideoFrame::kLumma;
-    int offsets[4];
-    if (order[0] != -1 ) offsets[order[0]] = 0;
-
+    int offsets[4] = { 0, 0, 0, 0 };
+    size_t xs[4] = { 0, 0, 0, 0 }, ys[4] = { 0, 0, 0, 0 };
     unsigned sx = 1, sy = 1;
 
-    if ( _has_yca )
+    const bool reuse = ( cached && _layout.slices &&
+                         _layout.yca == _has_yca );
+    if ( reuse )
     {
-        unsigned size  = dw * dh;
-        unsigned size2 = dw * dh / 4;
-
-        unsigned off = 0;
-        sx = 0;
-        unsigned short idx = 0;
-        for ( int i = 0; i < 4; ++i )
+        format = _layout.format;
+        numChannels = _layout.channels;
+        sx = _layout.sx;
+        sy = _layout.sy;
+        for ( int k = 0; k < 4; ++k )
         {
-            int k = order[i];
-            if ( k == -1 ) continue;
-
-            if ( idx == 0 ) off = 0;
-            else if ( idx == 1 ) off = size;
-            else if ( idx == 2 ) off = size + size2;
-            else if ( idx == 3 ) off = size + size2 * 2;
-            if ( sx == 0 ) {
-                sx = xsampling[k];
-                sy = ysampling[k];
-            }
-            offsets[k] = off;
-            ++idx;
-        }
-        if ( numChannels >= 3 && has_alpha() )
-        {
-            format = VideoFrame::kYByRy420A;
-            numChannels = 4;
-            offsets[order[3]]  = size + size2 * 2;
-        }
-        else if ( numChannels >= 2 )
-        {
-            numChannels = 3;
-            format = VideoFrame::kYByRy420;
+            offsets[k] = _layout.offsets[k];
+            xs[k] = _layout.xs[k];
+            ys[k] = _layout.ys[k];
         }
     }
     else
     {
-        if ( order[1] != -1 ) offsets[order[1]]  = 1;
-        if ( order[2] != -1 ) offsets[order[2]]  = 2;
-        if ( order[3] != -1 ) offsets[order[3]]  = 3;
+        if (order[0] != -1 ) offsets[order[0]] = 0;
 
-        if ( numChannels >= 3 && has_alpha() )
+        if ( _has_yca )
         {
-            format = VideoFrame::kRGBA;
-            numChannels = 4;
+            unsigned size  = dw * dh;
+            unsigned size2 = dw * dh / 4;
+
+            unsigned off = 0;
+            sx = 0;
+            unsigned short idx = 0;
+            for ( int i = 0; i < 4; ++i )
+            {
+                int k = order[i];
+                if ( k == -1 ) continue;
+
+                if ( idx == 0 ) off = 0;
+                else if ( idx == 1 ) off = size;
+                else if ( idx == 2 ) off = size + size2;
+                else if ( idx == 3 ) off = size + size2 * 2;
+                if ( sx == 0 ) {
+                    sx = xsampling[k];
+                    sy = ysampling[k];
+                }
+                offsets[k] = off;
+                ++idx;
+            }
+            if ( numChannels >= 3 && has_alpha() )
+            {
+                format = VideoFrame::kYByRy420A;
+                numChannels = 4;
+                offsets[order[3]]  = size + size2 * 2;
+            }
+            else if ( numChannels >= 2 )
+            {
+                numChannels = 3;
+                format = VideoFrame::kYByRy420;
+            }
         }
-        else if ( numChannels >= 2 )
+        else
         {
-            format = VideoFrame::kRGB;
-            numChannels = 3;
+            if ( order[1] != -1 ) offsets[order[1]]  = 1;
+            if ( order[2] != -1 ) offsets[order[2]]  = 2;
+            if ( order[3] != -1 ) offsets[order[3]]  = 3;
+
+            if ( numChannels >= 3 && has_alpha() )
+            {
+                format = VideoFrame::kRGBA;
+                numChannels = 4;
+            }
+            else if ( numChannels >= 2 )
+            {
+                format = VideoFrame::kRGB;
+                numChannels = 3;
+            }
         }
     }
 
@@ -443,33 +599,47 @@ bool exrImage::channels_order(
                             dw / sx, dh / sy ) )
         return false;
 
-    size_t xs[4], ys[4];
-
-    if ( _has_yca )
+    if ( !reuse )
     {
-        size_t t = canvas->pixel_size();
-
-        for ( unsigned j = 0; j < 4; ++j )
+        if ( _has_yca )
         {
-            xs[j] = t;
+            size_t t = canvas->pixel_size();
+
+            for ( unsigned j = 0; j < 4; ++j )
+            {
+                xs[j] = t;
+            }
+
+            size_t dw2 = dw / 2;
+            if ( order[0] != -1 ) ys[order[0]] = t * dw;
+            if ( order[1] != -1 ) ys[order[1]] = t * dw2;
+            if ( order[2] != -1 ) ys[order[2]] = t * dw2;
+            if ( order[3] != -1 ) ys[order[3]] = t * dw;
         }
+        else
+        {
+            unsigned pixels = (unsigned) (canvas->pixel_size() * numChannels);
 
-        size_t dw2 = dw / 2;
-        if ( order[0] != -1 ) ys[order[0]] = t * dw;
-        if ( order[1] != -1 ) ys[order[1]] = t * dw2;
-        if ( order[2] != -1 ) ys[order[2]] = t * dw2;
-        if ( order[3] != -1 ) ys[order[3]] = t * dw;
-    }
-    else
-    {
-        unsigned pixels = (unsigned) (canvas->pixel_size() * numChannels);
+            for ( unsigned j = 0; j < 4; ++j )
+            {
+                int k = order[j];
+                if ( k == -1 ) continue;
+                xs[k] = pixels;
+                ys[k] = pixels * dw;
+            }
+        }
 
-        for ( unsigned j = 0; j < 4; ++j )
+        _layout.slices = true;
+        _layout.yca = _has_yca;
+        _layout.format = format;
+        _layout.channels = unsigned( numChannels );
+        _layout.sx = sx;
+        _layout.sy = sy;
+        for ( int k = 0; k < 4; ++k )
         {
-            int k = order[j];
-            if ( k == -1 ) continue;
-            xs[k] = pixels;
-            ys[k] = pixels * dw;
+            _layout.offsets[k] = offsets[k];
+            _layout.xs[k] = xs[k];
+            _layout.ys[k] = ys[k];
         }
     }
 
@@ -541,9 +711,89 @@ void exrImage::ycc2rgba( const Imf::Header& hdr, const boost::int64_t& frame,
         }
     }
 
+    rgba->region( canvas->region() );
     canvas = rgba;
 }
 
+/**
+ * Read the pixels of a part into a frame buffer.  When the viewer shows
+ * only part of the picture, only the scanlines or tiles in view are
+ * read and the picture remembers the region it holds.  Tiled parts
+ * are read at the mipmap level chosen.
+ *
+ * @param canvas   picture the frame buffer points into
+ * @param inmaster multipart file
+ * @param part     part to read
+ * @param h        header of part
+ * @param fb       frame buffer to read into
+ */
+void exrImage::read_pixels( mrv::image_type_ptr& canvas,
+                            MultiPartInputFile& inmaster,
+                            const int part, const Header& h,
+                            FrameBuffer& fb )
+{
+    bool tiled = h.hasType() ? isTiled( h.type() ) : h.hasTileDescription();
+
+    // Tiled parts are read at the mipmap level chosen.
+    Box2i dataWindow = h.dataWindow();
+    if ( tiled )
+    {
+        TiledInputPart in( inmaster, part );
+        dataWindow = in.dataWindowForLevel( _levelX, _levelY );
+    }
+
+    Box2i roi = dataWindow;
+
+    // Region is in picture pixels, which are scaled if cache is.
+    const mrv::Recti r = view_region();
+    if ( !r.empty() && cache_scale() == 0 )
+    {
+        roi.min.x = std::max( dataWindow.min.x, dataWindow.min.x + r.x() );
+        roi.min.y = std::max( dataWindow.min.y, dataWindow.min.y + r.y() );
+        roi.max.x = std::min( dataWindow.max.x,
+                              dataWindow.min.x + r.r() - 1 );
+        roi.max.y = std::min( dataWindow.max.y,
+                              dataWindow.min.y + r.b() - 1 );
+        if ( roi.isEmpty() ) roi = dataWindow;
+    }
+
+    if ( tiled && ( roi != dataWindow || _levelX > 0 || _levelY > 0 ) )
+    {
+        const TileDescription& td = h.tileDescription();
+        int tx0 = ( roi.min.x - dataWindow.min.x ) / int(td.xSize);
+        int tx1 = ( roi.max.x - dataWindow.min.x ) / int(td.xSize);
+        int ty0 = ( roi.min.y - dataWindow.min.y ) / int(td.ySize);
+        int ty1 = ( roi.max.y - dataWindow.min.y ) / int(td.ySize);
+
+        TiledInputPart in( inmaster, part );
+        in.setFrameBuffer( fb );
+        in.readTiles( tx0, tx1, ty0, ty1, _levelX, _levelY );
+
+        // Whole tiles were read
+        roi.min.x = dataWindow.min.x + tx0 * int(td.xSize);
+        roi.min.y = dataWindow.min.y + ty0 * int(td.ySize);
+        roi.max.x = std::min( dataWindow.max.x, dataWindow.min.x +
+                              ( tx1 + 1 ) * int(td.xSize) - 1 );
+        roi.max.y = std::min( dataWindow.max.y, dataWindow.min.y +
+                              ( ty1 + 1 ) * int(td.ySize) - 1 );
+    }
+    else
+    {
+        InputPart in( inmaster, part );
+        in.setFrameBuffer( fb );
+        in.readPixels( roi.min.y, roi.max.y );
+
+        roi.min.x = dataWindow.min.x;
+        roi.max.x = dataWindow.max.x;
+    }
+
+    if ( roi != dataWindow )
+        canvas->region( mrv::Recti( roi.min.x - dataWindow.min.x,
+                                    roi.min.y - dataWindow.min.y,
+                                    roi.max.x - roi.min.x + 1,
+                                    roi.max.y - roi.min.y + 1 ) );
+}
+
 /**
  * Fetch the current EXR image
  *
@@ -558,7 +808,8 @@ bool exrImage::fetch_mipmap(  mrv::image_type_ptr& canvas,
 
         std::string fileName = sequence_filename(frame);
 
-        TiledInputFile in( fileName.c_str() );
+        MultiPartInputFile inmaster( fileName.c_str() );
+        TiledInputPart in( inmaster, 0 );
 
         int numXLevels = in.numXLevels();
         int numYLevels = in.numYLevels();
@@ -572,7 +823,7 @@ bool exrImage::fetch_mipmap(  mrv::image_type_ptr& canvas,
                    "not exist in file " << fileName << ".");
         }
 
-        Imf::Header h = in.header();
+        Imf::Header h = inmaster.header(0);
         h.dataWindow() = in.dataWindowForLevel(_levelX, _levelY);
         h.displayWindow() = h.dataWindow();
 
@@ -596,29 +847,7 @@ bool exrImage::fetch_mipmap(  mrv::image_type_ptr& canvas,
         _lineOrder   = h.lineOrder();
         _compression = h.compression();
 
-        in.setFrameBuffer(fb);
-
-
-        int tx = in.numXTiles( _levelX );
-        int ty = in.numYTiles( _levelY );
-
-        //
-        // For maximum speed, try to read the tiles in
-        // the same order as they are stored in the file.
-        //
-
-        if ( _lineOrder == INCREASING_Y )
-        {
-            for (int y = 0; y < ty; ++y)
-                for (int x = 0; x < tx; ++x)
-                    in.readTile (x, y, _levelX, _levelY);
-        }
-        else
-        {
-            for (int y = ty - 1; y >= 0; --y)
-                for (int x = 0; x < tx; ++x)
-                    in.readTile (x, y, _levelX, _levelY);
-        }
+        read_pixels( canvas, inmaster, 0, h, fb );
 
         return true;
 
@@ -1136,6 +1365,60 @@ bool exrImage::find_channels( mrv::image_type_ptr& canvas,
 void exrImage::read_header_attr( const Imf::Header& h,
                                  const boost::int64_t& frame )
 {
+    // Frames of a sequence usually share their header but for a few
+    // attributes.  If this one lays out its pixels like the last one
+    // read, the attributes of that frame are taken and only those that
+    // change with each frame are read again.
+    const boost::uint64_t hash = layout_hash( h );
+    AttributesFrame::const_iterator last = _attrs.end();
+    if ( hash == _header_layout )
+        last = _attrs.find( _header_frame );
+
+    _header_layout = hash;
+    _header_frame = frame;
+
+    if ( last != _attrs.end() )
+    {
+        Attributes& dst = _attrs[frame];
+        const FrameAttribute* f;
+
+        if ( &dst != &last->second )
+        {
+            Attributes::const_iterator i = last->second.begin();
+            Attributes::const_iterator e = last->second.end();
+            for ( ; i != e; ++i )
+            {
+                for ( f = kFrameAttributes; f->name; ++f )
+                    if ( i->first == ( f->translated ? _(f->shown) :
+                                       f->shown ) ) break;
+                if ( f->name || dst.find( i->first ) != dst.end() )
+                    continue;
+                dst.insert( std::make_pair( i->first, i->second->copy() ) );
+            }
+        }
+
+        for ( f = kFrameAttributes; f->name; ++f )
+        {
+            const std::string shown = f->translated ? _(f->shown) : f->shown;
+            Attributes::iterator j = dst.find( shown );
+            if ( j != dst.end() )
+            {
+                delete j->second;
+                dst.erase( j );
+            }
+
+            Imf::Header::ConstIterator i = h.find( f->name );
+            if ( i == h.end() ) continue;
+            dst.insert( std::make_pair( shown, i.attribute().copy() ) );
+        }
+
+        const Imf::TimeCodeAttribute *attr =
+            h.findTypedAttribute<Imf::TimeCodeAttribute>( N_("timeCode") );
+        if ( attr && frame == start_frame() )
+            process_timecode( attr->value() );
+        return;
+    }
+
     stringSet attrs;
     attrs.insert( N_("type") );
 
@@ -2287,7 +2570,6 @@ bool exrImage::fetch_multipart(  mrv::image_type_ptr& canvas,
         }
 
 
-        InputPart in (inmaster, _curpart);
         const Box2i& dataWindow = header.dataWindow();
         const Box2i& displayWindow = header.displayWindow();
 
@@ -2321,8 +2603,7 @@ bool exrImage::fetch_multipart(  mrv::image_type_ptr& canvas,
 
         if ( _curpart != oldpart )
         {
-            InputPart in (inmaster, _curpart);
-            const Header& header = in.header();
+            const Header& header = inmaster.header(_curpart);
 
 
             const Box2i& dataWindow = header.dataWindow();
@@ -2350,8 +2631,7 @@ bool exrImage::fetch_multipart(  mrv::image_type_ptr& canvas,
 
             try
             {
-                in.setFrameBuffer(fb);
-                in.readPixels( dataWindow.min.y, dataWindow.max.y );
+                read_pixels( canvas, inmaster, _curpart, header, fb );
             }
             catch( const std::exception& e )
             {
@@ -2363,8 +2643,7 @@ bool exrImage::fetch_multipart(  mrv::image_type_ptr& canvas,
         {
             try
             {
-                in.setFrameBuffer(fb);
-                in.readPixels( dataWindow.min.y, dataWindow.max.y );
+                read_pixels( canvas, inmaster, _curpart, header, fb );
             }
             catch( const std::exception& e )
             {
@@ -168,6 +168,10 @@ protected:
     bool find_channels( mrv::image_type_ptr& canvas,
 			const Imf::Header& h, Imf::FrameBuffer& fb,
                         const boost::int64_t& frame );
+    void read_pixels( mrv::image_type_ptr& canvas,
+                      Imf::MultiPartInputFile& inmaster,
+                      const int part, const Imf::Header& h,
+                      Imf::FrameBuffer& fb );
     void read_header_attr( const Imf::Header& h,
                            const boost::int64_t& frame );
 
@@ -214,6 +218,32 @@ protected:
     stringSet layers;
     int order[4];
 
+    // Channels chosen for a header layout and channel, and the slices
+    // they are read into, so frames of a sequence do not set them up
+    // again.
+    struct ChannelLayout
+    {
+        boost::uint64_t hash;   //!< layout hash of header, 0 if none
+        std::string     key;    //!< channel and range chosen from
+        std::vector< std::string > names;
+        int             order[4];
+        int             xsampling[4], ysampling[4];
+        Imf::PixelType  type;
+        bool            alpha;
+
+        bool            slices;   //!< slices below are set
+        bool            yca;      //!< slices are for luma/chroma
+        image_type::Format format;
+        unsigned        channels;
+        unsigned        sx, sy;
+        int             offsets[4];
+        size_t          xs[4], ys[4];
+    };
+    ChannelLayout _layout;
+
+    boost::int64_t  _header_frame;   //!< frame whose header was last read
+    boost::uint64_t _header_layout;  //!< layout hash of that header
+
     // Stereo in same image
     bool _has_stereo;
 
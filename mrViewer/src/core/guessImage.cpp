@@ -26,6 +26,9 @@
  */
 
 #include <iostream>
+#include <map>
+
+#include <boost/thread/mutex.hpp>
 
 #include <FL/Fl.H>
 
@@ -54,6 +57,8 @@
 
 #include "gui/mrvPreferences.h"
 #include "Sequence.h"
+#include "mrvDirectoryIndex.h"
+#include "mrvThread.h"
 #include "mrvIO.h"
 #include "mrvOS.h"
 
@@ -103,9 +108,8 @@ ImageTypes image_filetypes[] =
 };
 
 
-CMedia* test_image( const char* name,
-                    boost::uint8_t* datas, int size,
-                    const bool is_seq )
+const ImageTypes* test_image( const char* name,
+                              boost::uint8_t* datas, int size )
 {
     ImageTypes* type = image_filetypes;
     for ( ; type->get; ++type )
@@ -113,21 +117,64 @@ CMedia* test_image( const char* name,
         if ( type->test )
         {
             if ( type->test( datas, size ) )
-                return type->get( name, datas );
+                return type;
             else if ( type->test_filename && type->test_filename( name ) )
-                return type->get( name, datas );
+                return type;
         }
         else
         {
             if ( type->test_filename( name ) )
             {
-                return type->get( name, datas );
+                return type;
             }
         }
     }
     return NULL;
 }
 
+//
+// All frames of a sequence are of the same format, so the first one
+// probed tells the format of the rest.  Without this, each reader
+// opened on the sequence (stereo eye, read ahead loaders, thumbnails...)
+// probed it again, with some formats opening the file several times.
+//
+struct KnownFormats
+{
+    typedef boost::mutex Mutex;
+    typedef std::map< std::string, const ImageTypes* > FormatMap;
+
+    Mutex     mutex;
+    FormatMap formats;  //!< by sequence fileroot (root.%04d.ext)
+};
+
+// Sequences remembered before starting over.
+const size_t kMaxKnownFormats = 1024;
+
+KnownFormats& known_formats()
+{
+    static KnownFormats* k = new KnownFormats;
+    return *k;
+}
+
+const ImageTypes* known_format( const std::string& fileroot )
+{
+    KnownFormats& k = known_formats();
+    KnownFormats::Mutex& m = k.mutex;
+    SCOPED_LOCK( m );
+    KnownFormats::FormatMap::const_iterator i = k.formats.find( fileroot );
+    if ( i == k.formats.end() ) return NULL;
+    return i->second;
+}
+
+void remember_format( const std::string& fileroot, const ImageTypes* type )
+{
+    KnownFormats& k = known_formats();
+    KnownFormats::Mutex& m = k.mutex;
+    SCOPED_LOCK( m );
+    if ( k.formats.size() >= kMaxKnownFormats ) k.formats.clear();
+    k.formats[ fileroot ] = type;
+}
+
 std::string parse_view( const std::string& root, bool left )
 {
     size_t idx = root.find( "%V" );
@@ -251,8 +298,13 @@ CMedia* guess( bool is_stereo, bool is_seq, bool left,
     size_t size = len;
     const boost::uint8_t* test_data = datas;
 
+    // The printf pattern of the sequence, same for all its frames.
+    const std::string& fileroot = is_stereo ? tmp : root;
+    const ImageTypes* type = NULL;
+    if ( is_seq && !network && DirectoryIndex::instance().exists( name ) )
+        type = known_format( fileroot );
 
-    if (!datas && !network ) {
+    if (!datas && !network && !type ) {
         size = 1024;
         FILE* fp = fl_fopen(name, "rb");
         if (!fp)
@@ -357,8 +409,13 @@ CMedia* guess( bool is_stereo, bool is_seq, bool left,
     }
     else
     {
-        image = test_image( name, (boost::uint8_t*)test_data,
-                            (unsigned int)size, is_seq );
+        if ( !type )
+        {
+            type = test_image( name, (boost::uint8_t*)test_data,
+                               (unsigned int)size );
+            if ( type && is_seq ) remember_format( fileroot, type );
+        }
+        if ( type ) image = type->get( name, test_data );
     }
 
     if ( image )
@@ -387,7 +444,7 @@ CMedia* guess( bool is_stereo, bool is_seq, bool left,
         TRACE2( "**** DID NOT LOAD " << image << " " << name );
     }
 
-    delete [] test_data;
+    delete [] read_data;
 
     return image;
 }
@@ -0,0 +1,210 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvAudioStore.cpp
+ * @author gga
+ * @date   Sun Oct 18 19:52:17 2026
+ *
+ * @brief  Ring of decoded audio frames, indexed by frame.
+ *
+ *
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include "core/mrvAudioStore.h"
+
+namespace {
+
+// Slots of a new store.  Grown by reserve() up to kMaxSlots, past which
+// frames far apart share slots.
+const size_t kMinSlots = 64;
+const size_t kMaxSlots = 32768;
+
+struct OlderFirst
+{
+    inline bool operator()( const mrv::audio_type_ptr& a,
+                            const mrv::audio_type_ptr& b ) const
+    {
+        const timeval& x = a->ptime();
+        const timeval& y = b->ptime();
+        if ( x.tv_sec != y.tv_sec ) return x.tv_sec < y.tv_sec;
+        return x.tv_usec < y.tv_usec;
+    }
+};
+
+}
+
+namespace mrv {
+
+const int64_t AudioStore::kFree = std::numeric_limits<int64_t>::min();
+
+AudioStore::AudioStore() :
+    _slots( kMinSlots ),
+    _mask( kMinSlots - 1 ),
+    _count( 0 ),
+    _first( 0 ),
+    _last( 0 )
+{
+}
+
+void AudioStore::reserve( const unsigned n )
+{
+    size_t cap = _slots.size();
+    while ( cap < n && cap < kMaxSlots ) cap *= 2;
+    if ( cap == _slots.size() ) return;
+
+    // Frames in different slots stay in different slots, as the old
+    // capacity divides the new one.
+    std::vector< audio_type_ptr > slots( cap );
+    const size_t mask = cap - 1;
+    std::vector< audio_type_ptr >::iterator i = _slots.begin();
+    for ( ; i != _slots.end(); ++i )
+    {
+        if ( !live( *i ) ) continue;
+        slots[ size_t( (*i)->frame() & int64_t( mask ) ) ].swap( *i );
+    }
+
+    _slots.swap( slots );
+    _mask = mask;
+}
+
+void AudioStore::evict( audio_type_ptr& a )
+{
+    if ( !live( a ) ) return;
+
+    --_count;
+
+    // Keep it for reuse, unless someone is still playing or saving it.
+    if ( a.use_count() == 1 )
+        a->frame( kFree );
+    else
+        a.reset();
+}
+
+unsigned AudioStore::store( const int64_t f, const unsigned freq,
+                            const short channels, const boost::uint8_t* data,
+                            const unsigned size )
+{
+    audio_type_ptr& a = _slots[ slot( f ) ];
+
+    // Replaces an older frame in the slot or the same frame decoded
+    // again.
+    evict( a );
+
+    if ( a && a.use_count() == 1 )
+        a->assign( f, freq, channels, data, size );
+    else
+        a.reset( new audio_type( f, freq, channels, data, size ) );
+
+    if ( _count == 0 )
+    {
+        _first = _last = f;
+    }
+    else
+    {
+        if ( f < _first ) _first = f;
+        if ( f > _last )  _last = f;
+    }
+    ++_count;
+
+    return a->size();
+}
+
+audio_type_ptr AudioStore::find( const int64_t f ) const
+{
+    const audio_type_ptr& a = _slots[ slot( f ) ];
+    if ( a && a->frame() == f ) return a;
+    return audio_type_ptr();
+}
+
+audio_type_ptr AudioStore::lower_bound( int64_t f ) const
+{
+    if ( _count == 0 || f > _last ) return audio_type_ptr();
+    if ( f < _first ) f = _first;
+
+    // Usually f or a frame right after it is stored.
+    if ( _last - f < int64_t( _slots.size() ) )
+    {
+        for ( ; f <= _last; ++f )
+        {
+            const audio_type_ptr& a = _slots[ slot( f ) ];
+            if ( a && a->frame() == f ) return a;
+        }
+        return audio_type_ptr();
+    }
+
+    // Frames are further apart than the slots.  Look at all of them.
+    audio_type_ptr r;
+    std::vector< audio_type_ptr >::const_iterator i = _slots.begin();
+    for ( ; i != _slots.end(); ++i )
+    {
+        if ( !live( *i ) || (*i)->frame() < f ) continue;
+        if ( !r || (*i)->frame() < r->frame() ) r = *i;
+    }
+    return r;
+}
+
+void AudioStore::erase( const int64_t f )
+{
+    audio_type_ptr& a = _slots[ slot( f ) ];
+    if ( a && a->frame() == f ) evict( a );
+}
+
+void AudioStore::keep( const int64_t first, const int64_t last )
+{
+    std::vector< audio_type_ptr >::iterator i = _slots.begin();
+    for ( ; i != _slots.end(); ++i )
+    {
+        if ( !live( *i ) ) continue;
+        const int64_t f = (*i)->frame();
+        if ( f < first || f > last ) evict( *i );
+    }
+
+    if ( _count == 0 ) return;
+    if ( first > _first ) _first = first;
+    if ( last < _last )   _last = last;
+}
+
+void AudioStore::oldest_before( const int64_t frame, FrameList& frames ) const
+{
+    std::vector< audio_type_ptr > old;
+    std::vector< audio_type_ptr >::const_iterator i = _slots.begin();
+    for ( ; i != _slots.end(); ++i )
+    {
+        if ( live( *i ) && (*i)->frame() < frame ) old.push_back( *i );
+    }
+
+    std::sort( old.begin(), old.end(), OlderFirst() );
+
+    frames.clear();
+    std::vector< audio_type_ptr >::const_iterator j = old.begin();
+    for ( ; j != old.end(); ++j )
+        frames.push_back( (*j)->frame() );
+}
+
+void AudioStore::clear()
+{
+    std::vector< audio_type_ptr >::iterator i = _slots.begin();
+    for ( ; i != _slots.end(); ++i )
+        evict( *i );
+    _count = 0;
+}
+
+} // namespace mrv
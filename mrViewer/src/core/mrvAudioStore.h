@@ -0,0 +1,119 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvAudioStore.h
+ * @author gga
+ * @date   Sun Oct 18 19:52:17 2026
+ *
+ * @brief  Ring of decoded audio frames, indexed by frame.
+ *
+ *
+ */
+
+#ifndef mrvAudioStore_h
+#define mrvAudioStore_h
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "core/mrvFrame.h"
+
+namespace mrv {
+
+//
+// Decoded audio frames of an image.  Frame f lives in slot f modulo the
+// capacity, so finding it takes no search and frames arriving out of
+// order need no insertion.  Frames no one else holds are kept when
+// evicted and their buffers reused for the next frame stored in their
+// slot, so once warmed up storing audio allocates nothing.
+//
+// Not locked.  Callers hold CMedia::audio_mutex(), as they did for the
+// deque it replaces.
+//
+class AudioStore
+{
+public:
+    typedef std::vector< int64_t > FrameList;
+
+public:
+    AudioStore();
+
+    // Make room for at least n frames, within a limit.  Frames stored
+    // are kept.
+    void reserve( const unsigned n );
+
+    // Store a copy of the samples of frame f, replacing any frame in its
+    // slot.  Returns the size stored.
+    unsigned store( const int64_t f, const unsigned freq,
+                    const short channels, const boost::uint8_t* data,
+                    const unsigned size );
+
+    // Frame f, or NULL if not stored.
+    audio_type_ptr find( const int64_t f ) const;
+
+    // First frame stored at or after f, or NULL if none.
+    audio_type_ptr lower_bound( const int64_t f ) const;
+
+    inline bool contains( const int64_t f ) const {
+        const audio_type_ptr& a = _slots[ slot( f ) ];
+        return a && a->frame() == f;
+    }
+
+    inline size_t size() const { return _count; }
+    inline bool  empty() const { return _count == 0; }
+
+    // All frames stored are within [first(), last()].
+    inline int64_t first() const { return _first; }
+    inline int64_t last() const  { return _last; }
+
+    void erase( const int64_t f );
+
+    // Erase frames outside [first, last].
+    void keep( const int64_t first, const int64_t last );
+
+    // Frames stored before frame, oldest decoded first.
+    void oldest_before( const int64_t frame, FrameList& frames ) const;
+
+    void clear();
+
+protected:
+    inline size_t slot( const int64_t f ) const {
+        return size_t( f & int64_t( _mask ) );
+    }
+
+    inline bool live( const audio_type_ptr& a ) const {
+        return a && a->frame() != kFree;
+    }
+
+    void evict( audio_type_ptr& a );
+
+protected:
+    // Frame of evicted frames kept for reuse.
+    static const int64_t kFree;
+
+    std::vector< audio_type_ptr > _slots;
+    size_t  _mask;
+    size_t  _count;
+    int64_t _first;
+    int64_t _last;
+};
+
+} // namespace mrv
+
+#endif // mrvAudioStore_h
@@ -0,0 +1,156 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvCacheRuns.cpp
+ * @author gga
+ * @date   Sun Oct 18 22:04:37 2026
+ *
+ * @brief  Runs of consecutive cached frames.
+ *
+ *
+ */
+
+#include <algorithm>
+
+#include "core/mrvThread.h"
+#include "core/mrvCacheRuns.h"
+
+namespace mrv {
+
+CacheRuns::CacheRuns()
+{
+}
+
+void CacheRuns::insert( const boost::int64_t f )
+{
+    SCOPED_LOCK( _mutex );
+
+    RunMap::iterator next = _runs.upper_bound( f );
+    RunMap::iterator prev = _runs.end();
+    if ( next != _runs.begin() )
+    {
+        prev = next;
+        --prev;
+        if ( prev->second >= f ) return;
+        if ( prev->second != f - 1 ) prev = _runs.end();
+    }
+
+    const bool join_next = ( next != _runs.end() && next->first == f + 1 );
+
+    if ( prev != _runs.end() )
+    {
+        if ( join_next )
+        {
+            prev->second = next->second;
+            _runs.erase( next );
+        }
+        else
+        {
+            prev->second = f;
+        }
+    }
+    else if ( join_next )
+    {
+        const boost::int64_t last = next->second;
+        _runs.erase( next );
+        _runs.insert( std::make_pair( f, last ) );
+    }
+    else
+    {
+        _runs.insert( std::make_pair( f, f ) );
+    }
+}
+
+void CacheRuns::erase( const boost::int64_t f )
+{
+    SCOPED_LOCK( _mutex );
+
+    RunMap::iterator i = _runs.upper_bound( f );
+    if ( i == _runs.begin() ) return;
+    --i;
+
+    const boost::int64_t first = i->first;
+    const boost::int64_t last  = i->second;
+    if ( last < f ) return;
+
+    if ( first == f )
+        _runs.erase( i );
+    else
+        i->second = f - 1;
+
+    if ( last > f )
+        _runs.insert( std::make_pair( f + 1, last ) );
+}
+
+void CacheRuns::clear()
+{
+    SCOPED_LOCK( _mutex );
+    _runs.clear();
+}
+
+bool CacheRuns::contains( const boost::int64_t f ) const
+{
+    SCOPED_LOCK( _mutex );
+
+    RunMap::const_iterator i = _runs.upper_bound( f );
+    if ( i == _runs.begin() ) return false;
+    --i;
+    return i->second >= f;
+}
+
+void CacheRuns::runs( const boost::int64_t first, const boost::int64_t last,
+                      RunList& runs ) const
+{
+    runs.clear();
+
+    SCOPED_LOCK( _mutex );
+
+    RunMap::const_iterator i = _runs.upper_bound( first );
+    if ( i != _runs.begin() )
+    {
+        RunMap::const_iterator prev = i;
+        --prev;
+        if ( prev->second >= first ) i = prev;
+    }
+
+    for ( ; i != _runs.end() && i->first <= last; ++i )
+    {
+        runs.push_back( Run( std::max( i->first, first ),
+                             std::min( i->second, last ) ) );
+    }
+}
+
+void CacheRuns::intersect( const RunList& a, const RunList& b,
+                           RunList& out )
+{
+    out.clear();
+
+    RunList::const_iterator i = a.begin();
+    RunList::const_iterator j = b.begin();
+    while ( i != a.end() && j != b.end() )
+    {
+        const boost::int64_t first = std::max( i->first, j->first );
+        const boost::int64_t last  = std::min( i->second, j->second );
+        if ( first <= last ) out.push_back( Run( first, last ) );
+
+        if ( i->second < j->second ) ++i;
+        else ++j;
+    }
+}
+
+} // namespace mrv
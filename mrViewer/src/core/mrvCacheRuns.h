@@ -0,0 +1,79 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvCacheRuns.h
+ * @author gga
+ * @date   Sun Oct 18 22:04:37 2026
+ *
+ * @brief  Runs of consecutive cached frames.
+ *
+ *
+ */
+
+#ifndef mrvCacheRuns_h
+#define mrvCacheRuns_h
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace mrv {
+
+//
+// Frames of a clip held in its cache, kept as runs of consecutive frames
+// and updated as frames are cached and evicted.  The timeline draws its
+// cache line from the runs, in time proportional to their number instead
+// of to the frames of the clip.
+//
+class CacheRuns
+{
+public:
+    typedef boost::mutex                                     Mutex;
+    typedef std::pair< boost::int64_t, boost::int64_t >      Run;  //!< inclusive
+    typedef std::vector< Run >                               RunList;
+
+public:
+    CacheRuns();
+
+    void insert( const boost::int64_t f );
+    void erase( const boost::int64_t f );
+    void clear();
+
+    bool contains( const boost::int64_t f ) const;
+
+    // Runs within [first, last], clipped to it, in order.
+    void runs( const boost::int64_t first, const boost::int64_t last,
+               RunList& runs ) const;
+
+    // Frames in both a and b, as runs.
+    static void intersect( const RunList& a, const RunList& b,
+                           RunList& out );
+
+protected:
+    typedef std::map< boost::int64_t, boost::int64_t > RunMap; //!< first->last
+
+    mutable Mutex _mutex;
+    RunMap        _runs;
+};
+
+} // namespace mrv
+
+#endif // mrvCacheRuns_h
@@ -158,6 +158,7 @@ void client::stop()
     stopped_ = true;
 
     deadline_.cancel();
+    clock_timer_.cancel();
     non_empty_output_queue_.cancel();
     socket_.close();
 
@@ -259,10 +260,16 @@ void client::handle_connect(const boost::system::error_code& ec,
 
       await_output();
 
+      // Servers that know binary frames answer and switch to them.
+      if ( binary_sync ) deliver( N_("binary_offer") );
+
       write( N_("sync_image"), "" );
 
       // Start the input actor.
       start_read();
+
+      // Start sampling the server's clock.
+      check_clock( boost::system::error_code() );
    }
 }
 
@@ -271,13 +278,9 @@ void client::handle_connect(const boost::system::error_code& ec,
 void client::deliver( const std::string& msg )
 {
 
-    SCOPED_LOCK( mtx );
-
     LOG_INFO( "Client Deliver: " << msg );
 
-   output_queue_.push_back(msg + "\n");
-
-   non_empty_output_queue_.expires_from_now(boost::posix_time::seconds(0));
+    queue( msg );
 }
 
 void client::start_read()
@@ -287,11 +290,20 @@ void client::start_read()
    // deadline_.expires_from_now(boost::posix_time::seconds(30));
    deadline_.expires_at(boost::posix_time::pos_infin);
 
-   // Start an asynchronous operation to read a newline-delimited message.
-   boost::asio::async_read_until(socket_, input_buffer_, '\n',
-                                 boost::bind(&client::handle_read,
-                                             shared_from_this(),
-                                             boost::asio::placeholders::error));
+   // Start an asynchronous operation to read a newline-delimited message
+   // or a binary frame.
+   size_t missing = bytes_missing();
+   if ( missing > 0 )
+       boost::asio::async_read(socket_, input_buffer_,
+                               boost::asio::transfer_at_least( missing ),
+                               boost::bind(&client::handle_read,
+                                           shared_from_this(),
+                                           boost::asio::placeholders::error));
+   else
+       boost::asio::async_read_until(socket_, input_buffer_, '\n',
+                                     boost::bind(&client::handle_read,
+                                                 shared_from_this(),
+                                                 boost::asio::placeholders::error));
 
 
 }
@@ -305,19 +317,10 @@ void client::handle_read(const boost::system::error_code& ec)
 
     if (!ec)
     {
-        // Extract the newline-delimited message from the buffer.
-        std::istream is(&input_buffer_);
-        // is.exceptions( std::ifstream::failbit | std::ifstream::badbit |
-        //                std::ifstream::eofbit );
-
-
-
-        std::string id = boost::lexical_cast<std::string>(socket_.remote_endpoint() );
         try {
+            // Handle all whole messages read.
             std::string msg;
-            is.clear();
-
-            if ( std::getline(is, msg) )
+            while ( next_message( msg ) )
             {
                 if ( msg == N_("OK") || msg.empty() )
                 {
@@ -327,12 +330,15 @@ void client::handle_read(const boost::system::error_code& ec)
                 {
                     LOG_INFO( _("Not OK") );
                 }
-                else if ( parse( msg ) )
+                else if ( handshake( msg ) || clock_message( msg ) )
                 {
                 }
                 else
                 {
-                    LOG_ERROR( _("Unknown message") );
+                    local_time( msg );
+
+                    if ( !parse( msg ) )
+                        LOG_ERROR( _("Unknown message") );
                 }
             }
         }
@@ -360,11 +366,32 @@ void client::handle_read(const boost::system::error_code& ec)
     }
 }
 
+void client::check_clock( const boost::system::error_code& ec )
+{
+    if ( stopped_ || ec == boost::asio::error::operation_aborted )
+        return;
+
+    if ( clock_unanswered() )
+    {
+        LOG_CONN( _("Server does not sync clocks.") );
+        return;
+    }
+
+    ping_clock();
+
+    clock_timer_.expires_from_now( clock_interval() );
+    clock_timer_.async_wait( boost::bind( &client::check_clock,
+                                          shared_from_this(),
+                                          boost::asio::placeholders::error ) );
+}
+
 void client::await_output()
 {
    if (stopped_)
        return;
 
+   SCOPED_LOCK( mtx );
+
    if (output_queue_.empty())
    {
       // There are no messages that are ready to be sent. The actor goes to
@@ -378,6 +405,15 @@ void client::await_output()
                        shared_from_this() ) );
 
    }
+   else if ( !batch_due() )
+   {
+      // Let more messages join the batch.
+      non_empty_output_queue_.expires_at( batch_time_ );
+
+      non_empty_output_queue_.async_wait(
+          boost::bind( &mrv::client::await_output,
+                       shared_from_this() ) );
+   }
    else
    {
       start_write();
@@ -388,10 +424,11 @@ void client::start_write()
 {
     SCOPED_LOCK( mtx );
 
-    // Start an asynchronous operation to send a message.
+    take_batch();
+
+    // Start an asynchronous operation to send the queued messages.
     boost::asio::async_write(socket_,
-                             boost::asio::buffer(output_queue_.front(),
-                                                 output_queue_.front().size()),
+                             boost::asio::buffer(output_batch_),
                              boost::bind(&client::handle_write,
                                          shared_from_this(),
                                          boost::asio::placeholders::error));
@@ -406,10 +443,6 @@ void client::handle_write(const boost::system::error_code& ec)
 
    if (!ec)
    {
-       assert0( !output_queue_.empty() );
-
-       output_queue_.pop_front();
-
        await_output();
    }
    else
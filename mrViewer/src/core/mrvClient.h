@@ -66,6 +66,7 @@ class client : public Parser,
     void handle_write( const boost::system::error_code& ec );
 
     void check_deadline();
+    void check_clock( const boost::system::error_code& ec );
 
     static void create( ViewerUI* main );
     static void remove( ViewerUI* main );
@@ -17,6 +17,7 @@
 */
 
 #include <math.h>
+#include <vector>
 
 #include <OpenColorIO/OpenColorIO.h>
 namespace OCIO = OCIO_NAMESPACE;
@@ -216,11 +217,15 @@ bool prepare_image( mrv::image_type_ptr& pic, const CMedia* img,
     {
         float one_gamma = 1.0f / img->gamma();
 
+        RowReader read( ptr.get() );
+        RowWriter write( sho.get() );
+        std::vector< ImagePixel > row( dw );
         for ( unsigned y = 0; y < dh; ++y )
         {
+            read( y, 0, dw, &row[0] );
             for ( unsigned x = 0; x < dw; ++x )
             {
-                ImagePixel p = ptr->pixel( x, y );
+                ImagePixel& p = row[x];
 
                 if ( p.r > 0.f && isfinite(p.r) )
                     p.r = expf( logf(p.r) * one_gamma );
@@ -228,9 +233,8 @@ bool prepare_image( mrv::image_type_ptr& pic, const CMedia* img,
                     p.g = expf( logf(p.g) * one_gamma );
                 if ( p.b > 0.f && isfinite(p.b) )
                     p.b = expf( logf(p.b) * one_gamma );
-
-                sho->pixel( x, y, p );
             }
+            write( y, 0, dw, &row[0] );
         }
     }
     else
@@ -246,14 +250,15 @@ bool prepare_image( mrv::image_type_ptr& pic, const CMedia* img,
                                format, pt ) );
 
 
+    RowReader read( sho.get() );
+    RowWriter write( pic.get() );
+    std::vector< ImagePixel > row( dw );
     for ( unsigned y = 0; y < dh; ++y )
     {
+        read( y, 0, dw, &row[0] );
         for ( unsigned x = 0; x < dw; ++x )
-        {
-            ImagePixel p = sho->pixel( x, y );
-            p.clamp();
-            pic->pixel( x, y, p );
-        }
+            row[x].clamp();
+        write( y, 0, dw, &row[0] );
     }
 
     if ( save_ctx )
@@ -0,0 +1,93 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvDecodeBudget.cpp
+ * @author gga
+ * @date   Sun Oct 18 09:21:44 2026
+ *
+ * @brief  Splits the machine's cores among the decoders of playing clips.
+ *
+ *
+ */
+
+#include "core/mrvScheduler.h"
+#include "core/mrvDecodeBudget.h"
+
+namespace mrv {
+
+DecodeBudget& DecodeBudget::instance()
+{
+    static DecodeBudget budget;
+    return budget;
+}
+
+// Same cores as the scheduler's pool, which works mostly while playback
+// is stopped or between the frames decoded.
+DecodeBudget::DecodeBudget() :
+    _cores( Scheduler::instance().threads() ),
+    _generation( 0 )
+{
+    if ( _cores < 1 ) _cores = 1;
+}
+
+void DecodeBudget::start( const CMedia* img, const unsigned max_threads )
+{
+    Mutex::scoped_lock lk( _mutex );
+    if ( max_threads == 0 ) _clips.erase( img );
+    else _clips[img] = max_threads;
+    ++_generation;
+}
+
+void DecodeBudget::stop( const CMedia* img )
+{
+    Mutex::scoped_lock lk( _mutex );
+    if ( _clips.erase( img ) ) ++_generation;
+}
+
+unsigned DecodeBudget::active() const
+{
+    Mutex::scoped_lock lk( _mutex );
+    return unsigned( _clips.size() );
+}
+
+unsigned DecodeBudget::threads( const CMedia* img,
+                                const unsigned max_threads ) const
+{
+    if ( max_threads <= 1 ) return 1;
+
+    Mutex::scoped_lock lk( _mutex );
+
+    unsigned fixed  = 0;  // cores taken by decoders that cannot thread
+    unsigned shared = 1;  // decoders sharing the rest, counting img
+    ClipMap::const_iterator i = _clips.begin();
+    ClipMap::const_iterator e = _clips.end();
+    for ( ; i != e; ++i )
+    {
+        if ( i->first == img ) continue;
+        if ( i->second <= 1 ) ++fixed;
+        else ++shared;
+    }
+
+    unsigned avail = _cores > fixed ? _cores - fixed : 1;
+    unsigned n = avail / shared;
+    if ( n < 1 ) n = 1;
+    if ( n > max_threads ) n = max_threads;
+    return n;
+}
+
+} // namespace mrv
@@ -0,0 +1,82 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvDecodeBudget.h
+ * @author gga
+ * @date   Sun Oct 18 09:21:44 2026
+ *
+ * @brief  Splits the machine's cores among the decoders of playing clips.
+ *
+ *
+ */
+
+#ifndef mrvDecodeBudget_h
+#define mrvDecodeBudget_h
+
+#include <map>
+#include <atomic>
+
+#include <boost/thread/mutex.hpp>
+
+namespace mrv {
+
+class CMedia;
+
+class DecodeBudget
+{
+public:
+    typedef boost::mutex Mutex;
+
+public:
+    static DecodeBudget& instance();
+
+    // A clip started playing.  max_threads is the most threads its
+    // decoder can make use of (1 if it cannot thread, 0 if it has none).
+    void start( const CMedia* img, const unsigned max_threads );
+
+    // A clip stopped playing.
+    void stop( const CMedia* img );
+
+    // Threads the decoder of img should use now.  Clips whose decoder
+    // cannot thread take one core each and the rest is shared evenly.
+    unsigned threads( const CMedia* img, const unsigned max_threads ) const;
+
+    // Number of clips playing.
+    unsigned active() const;
+
+    // Changes each time a clip starts or stops, so decoders know when to
+    // ask for their threads again.
+    inline unsigned generation() const { return _generation; }
+
+    inline unsigned cores() const { return _cores; }
+
+protected:
+    DecodeBudget();
+
+protected:
+    typedef std::map< const CMedia*, unsigned > ClipMap;
+
+    mutable Mutex _mutex;
+    ClipMap       _clips;   //!< playing clips and their max threads
+    unsigned      _cores;
+    std::atomic<unsigned> _generation;
+};
+
+} // namespace mrv
+
+#endif // mrvDecodeBudget_h
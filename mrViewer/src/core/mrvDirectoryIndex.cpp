@@ -0,0 +1,323 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvDirectoryIndex.cpp
+ * @author gga
+ * @date   Sun Oct 18 20:31:44 2026
+ *
+ * @brief  Cached listing of directories holding image sequences.
+ *
+ *
+ */
+
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/types.h>
+#include <dirent.h>
+#endif
+
+#include <boost/filesystem.hpp>
+
+#include "core/Sequence.h"
+#include "core/mrvThread.h"
+#include "core/mrvDirectoryIndex.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// A directory's modification time is checked at most this often, in
+// microseconds, so frames rendered meanwhile may be seen late.
+const boost::int64_t kRecheck = 2000000;
+
+// Directories kept indexed.
+const size_t kMaxEntries = 32;
+
+boost::int64_t now()
+{
+    using namespace std::chrono;
+    return duration_cast< microseconds >(
+               steady_clock::now().time_since_epoch() ).count();
+}
+
+}
+
+namespace mrv {
+
+DirectoryIndex& DirectoryIndex::instance()
+{
+    static DirectoryIndex* index = new DirectoryIndex;
+    return *index;
+}
+
+DirectoryIndex::DirectoryIndex()
+{
+}
+
+std::string DirectoryIndex::key( const std::string& root,
+                                 const std::string& view,
+                                 const std::string& ext )
+{
+    // No file name holds a slash.
+    return root + '/' + view + '/' + ext;
+}
+
+std::string DirectoryIndex::normalize( const std::string& dir )
+{
+    std::string r = dir;
+    while ( r.size() > 1 && ( r[r.size()-1] == '/' ||
+                              r[r.size()-1] == '\\' ) )
+        r.resize( r.size() - 1 );
+    if ( r.empty() ) r = ".";
+    return r;
+}
+
+/**
+ * Read the names of the files in dir, skipping directories.  The type of
+ * each file comes from the listing itself where the system gives it, so
+ * files are not stat'ed one by one.  Links are, to skip dangling ones.
+ */
+bool DirectoryIndex::list( const std::string& dir, FileList& names )
+{
+    names.clear();
+
+#if defined(_WIN32) || defined(_WIN64)
+    // Windows returns the type of each file with the listing.
+    boost::system::error_code ec;
+    fs::directory_iterator i( dir, ec ), e;
+    if ( ec ) return false;
+    for ( ; i != e; i.increment( ec ) )
+    {
+        if ( ec ) return false;
+        // Status follows links, so dangling ones are not listed.
+        const fs::file_status s = i->status( ec );
+        if ( ec || !fs::exists( s ) || fs::is_directory( s ) ) continue;
+        names.push_back( i->path().filename().string() );
+    }
+#else
+    DIR* d = opendir( dir.c_str() );
+    if ( !d ) return false;
+
+    struct dirent* ent;
+    while ( ( ent = readdir( d ) ) != NULL )
+    {
+        const char* n = ent->d_name;
+        if ( n[0] == '.' && ( n[1] == 0 || ( n[1] == '.' && n[2] == 0 ) ) )
+            continue;
+#ifdef DT_DIR
+        if ( ent->d_type == DT_DIR ) continue;
+        // Links are followed, so dangling ones are not listed.
+        if ( ent->d_type == DT_UNKNOWN || ent->d_type == DT_LNK )
+#endif
+        {
+            boost::system::error_code ec;
+            const fs::file_status s = fs::status( dir + '/' + n, ec );
+            if ( ec || !fs::exists( s ) || fs::is_directory( s ) ) continue;
+        }
+        names.push_back( n );
+    }
+    closedir( d );
+#endif
+
+    std::sort( names.begin(), names.end() );
+    return true;
+}
+
+/**
+ * Group the files of e into sequences.
+ */
+void DirectoryIndex::index( Entry& e )
+{
+    e.ranges.clear();
+
+    std::string root, frame, view, ext;
+    FileList::const_iterator i = e.names.begin();
+    FileList::const_iterator end = e.names.end();
+    for ( ; i != end; ++i )
+    {
+        if ( ! split_sequence( root, frame, view, ext, *i ) )
+            continue;
+        if ( frame.empty() ) continue;
+
+        const boost::int64_t f = atoll( frame.c_str() );
+        const std::string k = key( root, view, ext );
+
+        RangeMap::iterator r = e.ranges.find( k );
+        if ( r == e.ranges.end() )
+        {
+            Range n;
+            n.first = n.last = f;
+            n.pad = 0;
+            r = e.ranges.insert( std::make_pair( k, n ) ).first;
+        }
+        else
+        {
+            if ( f < r->second.first ) r->second.first = f;
+            if ( f > r->second.last )  r->second.last = f;
+        }
+
+        if ( r->second.pad == 0 && frame[0] == '0' && frame.size() > 1 )
+            r->second.pad = (unsigned) frame.size();
+    }
+}
+
+DirectoryIndex::Entry* DirectoryIndex::entry( const std::string& d )
+{
+    const std::string dir = normalize( d );
+    const boost::int64_t t = now();
+
+    EntryMap::iterator i = _entries.find( dir );
+    if ( i != _entries.end() && t - i->second.checked < kRecheck )
+    {
+        i->second.used = t;
+        return &i->second;
+    }
+
+    boost::system::error_code ec;
+    time_t mtime = fs::last_write_time( dir, ec );
+    if ( ec )
+    {
+        if ( i != _entries.end() ) _entries.erase( i );
+        return NULL;
+    }
+
+    if ( i != _entries.end() )
+    {
+        Entry& e = i->second;
+        e.checked = e.used = t;
+        // A directory changed in the second it was read may have
+        // gotten files after.
+        if ( mtime == e.mtime && mtime < e.read )
+            return &e;
+    }
+
+    Entry n;
+    n.read = time( NULL );
+    if ( ! list( dir, n.names ) )
+    {
+        if ( i != _entries.end() ) _entries.erase( i );
+        return NULL;
+    }
+    n.mtime = mtime;
+    n.checked = n.used = t;
+    index( n );
+
+    Entry& e = _entries[dir];
+    e.names.swap( n.names );
+    e.ranges.swap( n.ranges );
+    e.mtime = n.mtime;
+    e.read = n.read;
+    e.checked = n.checked;
+    e.used = n.used;
+
+    trim();
+    return &_entries[dir];
+}
+
+/**
+ * Drop the least recently used directories past kMaxEntries.
+ */
+void DirectoryIndex::trim()
+{
+    while ( _entries.size() > kMaxEntries )
+    {
+        EntryMap::iterator oldest = _entries.begin();
+        EntryMap::iterator i = oldest;
+        for ( ++i; i != _entries.end(); ++i )
+        {
+            if ( i->second.used < oldest->second.used ) oldest = i;
+        }
+        _entries.erase( oldest );
+    }
+}
+
+bool DirectoryIndex::limits( const std::string& dir, const std::string& root,
+                             const std::string& view, const std::string& ext,
+                             boost::int64_t& first, boost::int64_t& last,
+                             unsigned& pad )
+{
+    SCOPED_LOCK( _mutex );
+
+    Entry* e = entry( dir );
+    if ( !e ) return false;
+
+    RangeMap::const_iterator i = e->ranges.find( key( root, view, ext ) );
+    if ( i == e->ranges.end() ) return false;
+
+    first = i->second.first;
+    last  = i->second.last;
+    pad   = i->second.pad;
+    return true;
+}
+
+bool DirectoryIndex::exists( const std::string& file )
+{
+    size_t pos = file.find_last_of( "/\\" );
+    std::string dir, name;
+    if ( pos == std::string::npos )
+    {
+        name = file;
+    }
+    else
+    {
+        dir  = file.substr( 0, pos + 1 );
+        name = file.substr( pos + 1 );
+    }
+
+    {
+        SCOPED_LOCK( _mutex );
+        Entry* e = entry( dir );
+        if ( e && std::binary_search( e->names.begin(), e->names.end(),
+                                      name ) )
+            return true;
+#if !defined(_WIN32) && !defined(_WIN64) && !defined(__APPLE__)
+        if ( e ) return false;
+#endif
+    }
+
+    // Directory cannot be listed, but its files may still be there.  On
+    // systems that ignore case, the name may differ in case from the one
+    // listed.
+    boost::system::error_code ec;
+    return fs::exists( file, ec );
+}
+
+bool DirectoryIndex::files( const std::string& dir, FileList& files )
+{
+    files.clear();
+
+    SCOPED_LOCK( _mutex );
+    Entry* e = entry( dir );
+    if ( !e ) return false;
+
+    std::string prefix = dir;
+    if ( !prefix.empty() && prefix[prefix.size()-1] != '/' &&
+         prefix[prefix.size()-1] != '\\' )
+        prefix += '/';
+
+    files.reserve( e->names.size() );
+    FileList::const_iterator i = e->names.begin();
+    for ( ; i != e->names.end(); ++i )
+        files.push_back( prefix + *i );
+    return true;
+}
+
+} // namespace mrv
@@ -0,0 +1,118 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvDirectoryIndex.h
+ * @author gga
+ * @date   Sun Oct 18 20:31:44 2026
+ *
+ * @brief  Cached listing of directories holding image sequences.
+ *
+ *
+ */
+
+#ifndef mrvDirectoryIndex_h
+#define mrvDirectoryIndex_h
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace mrv {
+
+//
+// Render directories can hold hundreds of thousands of files, often over
+// NFS, and walking them with a stat per file for every shot of a reel
+// takes minutes.  Each directory is read once, without stat'ing its
+// files, and its files grouped into sequences.  The listing is read
+// again only when the directory's modification time changes, which is
+// checked at most every couple of seconds.
+//
+class DirectoryIndex
+{
+public:
+    typedef boost::mutex                Mutex;
+    typedef std::vector< std::string >  FileList;
+
+public:
+    static DirectoryIndex& instance();
+
+    // Frame range of the sequence with root, view and ext (as returned
+    // by split_sequence() for a file name without directory) in dir.
+    // pad is the number of digits of zero padded frames, or 0.  Returns
+    // false if the directory cannot be read or holds no such frames.
+    bool limits( const std::string& dir, const std::string& root,
+                 const std::string& view, const std::string& ext,
+                 boost::int64_t& first, boost::int64_t& last,
+                 unsigned& pad );
+
+    // Whether file exists, as for frames of a sequence.
+    bool exists( const std::string& file );
+
+    // Full paths of the files (not directories) in dir, sorted.
+    bool files( const std::string& dir, FileList& files );
+
+protected:
+    struct Range
+    {
+        boost::int64_t first;
+        boost::int64_t last;
+        unsigned       pad;
+    };
+
+    typedef std::map< std::string, Range > RangeMap;
+
+    struct Entry
+    {
+        time_t         mtime;    //!< of the directory when read
+        time_t         read;     //!< wall time it was read
+        boost::int64_t checked;  //!< last time mtime was checked
+        boost::int64_t used;
+        FileList       names;    //!< sorted, without directory
+        RangeMap       ranges;   //!< by sequence key()
+    };
+
+    typedef std::map< std::string, Entry > EntryMap;
+
+protected:
+    DirectoryIndex();
+
+    static std::string key( const std::string& root, const std::string& view,
+                            const std::string& ext );
+    static std::string normalize( const std::string& dir );
+
+    // Entry for dir, read or read again if stale.  NULL if the directory
+    // cannot be read.  Called with _mutex locked.
+    Entry* entry( const std::string& dir );
+
+    static bool list( const std::string& dir, FileList& names );
+    static void index( Entry& e );
+
+    void trim();
+
+protected:
+    Mutex    _mutex;
+    EntryMap _entries;
+};
+
+} // namespace mrv
+
+#endif // mrvDirectoryIndex_h
@@ -0,0 +1,578 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvDiskCache.cpp
+ * @author gga
+ * @date   Mon Oct 19 00:02:18 2026
+ *
+ * @brief  Decoded frames spilled to a local disk.
+ *
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <boost/filesystem.hpp>
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/bind.hpp>
+
+#include "core/mrvThread.h"
+#include "core/mrvHome.h"
+#include "core/mrvScheduler.h"
+#include "core/mrvDiskCache.h"
+#include "gui/mrvIO.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const char* kModule = "dcache";
+
+const char kMagic[8] = { 'm', 'r', 'v', 'D', 'C', '0', '1', 0 };
+
+// Pixels start at this offset of a file, so they are page aligned when
+// mapped.
+const size_t kDataOffset = 4096;
+
+// Frames waiting to be written.  Evictions past it are dropped, so the
+// memory they hold is released at once.
+const unsigned kMaxPending = 8;
+
+const char* const kExtension = ".mrvc";
+
+struct Header
+{
+    char            magic[8];
+    boost::uint32_t key_size;    //!< key follows the header
+    boost::uint32_t width;
+    boost::uint32_t height;
+    boost::uint16_t channels;
+    boost::uint16_t format;
+    boost::uint16_t type;
+    boost::uint16_t valid;
+    boost::int64_t  frame;
+    boost::int64_t  repeat;
+    boost::int64_t  pts;
+    boost::int64_t  ctime;
+    boost::int64_t  mtime;
+    boost::int32_t  region[4];
+    boost::uint64_t data_size;
+};
+
+#if !defined(_WIN32) && !defined(_WIN64)
+// Unmaps the file of a frame when its pixels are released.
+struct Unmapper
+{
+    void*  base;
+    size_t size;
+
+    void operator()( mrv::aligned16_uint8_t* ) const
+    {
+        munmap( base, size );
+    }
+};
+#endif
+
+bool check_header( const Header& h, const std::string& key )
+{
+    return ( memcmp( h.magic, kMagic, sizeof(kMagic) ) == 0 &&
+             h.key_size == key.size() &&
+             sizeof(Header) + h.key_size <= kDataOffset );
+}
+
+}
+
+namespace mrv {
+
+DiskCache& DiskCache::instance()
+{
+    static DiskCache* cache = new DiskCache;
+    return *cache;
+}
+
+DiskCache::DiskCache() :
+    _active( false ),
+    _max_bytes( 0 ),
+    _bytes( 0 ),
+    _pending( 0 )
+{
+}
+
+std::string DiskCache::default_directory()
+{
+    std::string dir = mrv::homepath();
+    if ( dir.empty() ) return dir;
+    dir += "/.filmaura/cache";
+    return dir;
+}
+
+std::string DiskCache::directory() const
+{
+    SCOPED_LOCK( _mutex );
+    return _dir;
+}
+
+void DiskCache::directory( const std::string& dir )
+{
+    {
+        SCOPED_LOCK( _mutex );
+        if ( dir == _dir ) return;
+
+        _active = false;
+        _index.clear();
+        _frames.clear();
+        _lru.clear();
+        _bytes = 0;
+        _dir.clear();
+
+        if ( dir.empty() ) return;
+
+        boost::system::error_code ec;
+        fs::create_directories( dir, ec );
+        if ( !fs::is_directory( dir, ec ) )
+        {
+            LOG_ERROR( _("Cannot create disk cache directory ") << dir );
+            return;
+        }
+
+        _dir = dir;
+    }
+
+    scan();
+    _active = true;
+}
+
+void DiskCache::max_bytes( const boost::uint64_t bytes )
+{
+    SCOPED_LOCK( _mutex );
+    _max_bytes = bytes;
+    trim();
+}
+
+void DiskCache::scan()
+{
+    struct Found
+    {
+        std::time_t     mtime;
+        std::string     key;
+        std::string     file;
+        boost::uint64_t bytes;
+
+        bool operator<( const Found& b ) const { return mtime > b.mtime; }
+    };
+
+    std::vector< Found > found;
+
+    const std::string dir = directory();
+    boost::system::error_code ec;
+    fs::directory_iterator i( dir, ec ), e;
+    for ( ; !ec && i != e; i.increment( ec ) )
+    {
+        const fs::path& p = i->path();
+        const std::string ext = p.extension().string();
+        if ( ext == ".tmp" )
+        {
+            fs::remove( p, ec );
+            continue;
+        }
+        if ( ext != kExtension ) continue;
+
+        FILE* f = fopen( p.string().c_str(), "rb" );
+        if ( !f ) continue;
+
+        Header h;
+        Found n;
+        bool ok = ( fread( &h, sizeof(h), 1, f ) == 1 &&
+                    h.key_size > 0 &&
+                    sizeof(Header) + h.key_size <= kDataOffset );
+        if ( ok )
+        {
+            n.key.resize( h.key_size );
+            ok = ( fread( &n.key[0], h.key_size, 1, f ) == 1 &&
+                   check_header( h, n.key ) );
+        }
+        fclose( f );
+
+        if ( !ok )
+        {
+            fs::remove( p, ec );
+            continue;
+        }
+
+        n.file  = p.string();
+        n.bytes = kDataOffset + h.data_size;
+        n.mtime = fs::last_write_time( p, ec );
+        found.push_back( n );
+    }
+
+    std::sort( found.begin(), found.end() );
+
+    SCOPED_LOCK( _mutex );
+    std::vector< Found >::const_iterator j = found.begin();
+    for ( ; j != found.end(); ++j )
+    {
+        if ( _index.find( j->key ) != _index.end() ) continue;
+        _lru.push_back( j->key );
+        Entry& n = add( j->key );
+        n.file    = j->file;
+        n.bytes   = j->bytes;
+        n.pending = false;
+        n.lru     = --_lru.end();
+        _bytes += n.bytes;
+    }
+
+    trim();
+}
+
+std::string DiskCache::frame_key( const std::string& key )
+{
+    // Keys start with the source file and its modification time.
+    const size_t a = key.find( '|' );
+    if ( a == std::string::npos ) return key;
+    const size_t b = key.find( '|', a + 1 );
+    if ( b == std::string::npos ) return key;
+    return key.substr( 0, a ) + key.substr( b );
+}
+
+DiskCache::Entry& DiskCache::add( const std::string& key )
+{
+    ++_frames[ frame_key( key ) ];
+    return _index[key];
+}
+
+bool DiskCache::may_hold( const std::string& key ) const
+{
+    if ( !_active ) return false;
+
+    SCOPED_LOCK( _mutex );
+    return _frames.find( frame_key( key ) ) != _frames.end();
+}
+
+bool DiskCache::reserve( const std::string& key )
+{
+    SCOPED_LOCK( _mutex );
+
+    if ( _dir.empty() ) return false;
+
+    Index::iterator i = _index.find( key );
+    if ( i != _index.end() )
+    {
+        _lru.splice( _lru.begin(), _lru, i->second.lru );
+        return false;
+    }
+
+    if ( _pending >= kMaxPending ) return false;
+    ++_pending;
+
+    char name[32];
+    sprintf( name, "%016llx", (unsigned long long)
+             std::hash< std::string >()( key ) );
+
+    _lru.push_front( key );
+    Entry& n = add( key );
+    n.file    = ( fs::path( _dir ) / ( std::string( name ) + kExtension ) ).string();
+    n.bytes   = 0;
+    n.pending = true;
+    n.lru     = _lru.begin();
+    return true;
+}
+
+void DiskCache::store( const std::string& key, const image_type_ptr& pic )
+{
+    if ( !_active || !pic || !pic->data() ) return;
+    if ( ! reserve( key ) ) return;
+
+    Scheduler::instance().submit( boost::bind( &DiskCache::write_frame,
+                                               this, key, pic ),
+                                  Scheduler::kBackground, "disk cache" );
+}
+
+void DiskCache::store( const std::string& key, const PackedFrame_ptr& p )
+{
+    if ( !_active || !p ) return;
+    if ( ! reserve( key ) ) return;
+
+    Scheduler::instance().submit( boost::bind( &DiskCache::write_packed,
+                                               this, key, p ),
+                                  Scheduler::kBackground, "disk cache" );
+}
+
+void DiskCache::write_packed( const std::string key, const PackedFrame_ptr p )
+{
+    write_frame( key, p->unpack() );
+}
+
+void DiskCache::write_frame( const std::string key, const image_type_ptr pic )
+{
+    std::string file;
+    {
+        SCOPED_LOCK( _mutex );
+        Index::iterator i = _index.find( key );
+        if ( i == _index.end() || !i->second.pending )
+        {
+            --_pending;
+            return;
+        }
+        file = i->second.file;
+    }
+
+    const bool ok = write( file, key, *pic );
+
+    SCOPED_LOCK( _mutex );
+    --_pending;
+
+    Index::iterator i = _index.find( key );
+    if ( i == _index.end() || i->second.file != file )
+        return;
+
+    if ( !ok )
+    {
+        erase( i );
+        return;
+    }
+
+    i->second.pending = false;
+    i->second.bytes = kDataOffset + pic->data_size();
+    _bytes += i->second.bytes;
+    trim();
+}
+
+/**
+ * Write the header, key and pixels of pic to a temporary file, renamed
+ * to file once complete, so a file is never read half written.
+ */
+bool DiskCache::write( const std::string& file, const std::string& key,
+                       const VideoFrame& pic )
+{
+    if ( sizeof(Header) + key.size() > kDataOffset ) return false;
+
+    Header h;
+    memset( &h, 0, sizeof(h) );
+    memcpy( h.magic, kMagic, sizeof(kMagic) );
+    h.key_size  = boost::uint32_t( key.size() );
+    h.width     = pic.width();
+    h.height    = pic.height();
+    h.channels  = pic.channels();
+    h.format    = boost::uint16_t( pic.format() );
+    h.type      = boost::uint16_t( pic.pixel_type() );
+    h.valid     = pic.valid();
+    h.frame     = pic.frame();
+    h.repeat    = pic.repeat();
+    h.pts       = pic.pts();
+    h.ctime     = pic.ctime();
+    h.mtime     = pic.mtime();
+    h.region[0] = pic.region().x();
+    h.region[1] = pic.region().y();
+    h.region[2] = pic.region().w();
+    h.region[3] = pic.region().h();
+    h.data_size = pic.data_size();
+
+    std::vector< char > head( kDataOffset, 0 );
+    memcpy( &head[0], &h, sizeof(h) );
+    memcpy( &head[sizeof(h)], key.c_str(), key.size() );
+
+    const std::string tmp = file + ".tmp";
+    FILE* f = fopen( tmp.c_str(), "wb" );
+    if ( !f ) return false;
+
+    bool ok = ( fwrite( &head[0], kDataOffset, 1, f ) == 1 &&
+                fwrite( pic.data().get(), h.data_size, 1, f ) == 1 );
+    ok = ( fclose( f ) == 0 ) && ok;
+
+    boost::system::error_code ec;
+    if ( ok )
+    {
+        fs::rename( tmp, file, ec );
+        ok = !ec;
+    }
+    if ( !ok )
+    {
+        LOG_WARNING( _("Could not write disk cache file ") << file );
+        fs::remove( tmp, ec );
+    }
+    return ok;
+}
+
+/**
+ * Map the pixels of file, which must hold key.  Where files cannot be
+ * mapped, they are read instead.
+ */
+image_type_ptr DiskCache::read( const std::string& file,
+                                const std::string& key )
+{
+    image_type_ptr pic;
+
+#if defined(_WIN32) || defined(_WIN64)
+    FILE* f = fopen( file.c_str(), "rb" );
+    if ( !f ) return pic;
+
+    std::vector< char > head( kDataOffset );
+    if ( fread( &head[0], kDataOffset, 1, f ) != 1 )
+    {
+        fclose( f );
+        return pic;
+    }
+
+    const Header& h = *(const Header*) &head[0];
+    if ( !check_header( h, key ) ||
+         key.compare( 0, key.size(), &head[sizeof(Header)], h.key_size ) )
+    {
+        fclose( f );
+        return pic;
+    }
+
+    pic.reset( new VideoFrame( h.frame, h.width, h.height, h.channels,
+                               (VideoFrame::Format) h.format,
+                               (VideoFrame::PixelType) h.type,
+                               h.repeat, h.pts ) );
+    const bool ok = ( pic->data_size() == h.data_size &&
+                      fread( pic->data().get(), h.data_size, 1, f ) == 1 );
+    fclose( f );
+    if ( !ok ) return image_type_ptr();
+#else
+    int fd = open( file.c_str(), O_RDONLY );
+    if ( fd < 0 ) return pic;
+
+    struct stat sbuf;
+    if ( fstat( fd, &sbuf ) < 0 || size_t( sbuf.st_size ) < kDataOffset )
+    {
+        close( fd );
+        return pic;
+    }
+
+    // Private and writable, so pixels changed in memory are copied and
+    // never reach the file.
+    const size_t size = sbuf.st_size;
+    void* base = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                       fd, 0 );
+    close( fd );
+    if ( base == MAP_FAILED ) return pic;
+
+    const char* head = (const char*) base;
+    const Header& h = *(const Header*) head;
+    if ( !check_header( h, key ) ||
+         key.compare( 0, key.size(), head + sizeof(Header), h.key_size ) ||
+         kDataOffset + h.data_size > size )
+    {
+        munmap( base, size );
+        return pic;
+    }
+
+    Unmapper u = { base, size };
+    VideoFrame::PixelData data( (aligned16_uint8_t*) ( (char*) base +
+                                                       kDataOffset ), u );
+    pic.reset( new VideoFrame( h.frame, h.width, h.height, h.channels,
+                               (VideoFrame::Format) h.format,
+                               (VideoFrame::PixelType) h.type,
+                               h.repeat, h.pts, data ) );
+    if ( pic->data_size() != h.data_size ) return image_type_ptr();
+#endif
+
+    pic->valid( h.valid != 0 );
+    pic->shown();
+    pic->ctime( h.ctime );
+    pic->mtime( h.mtime );
+    pic->region( mrv::Recti( h.region[0], h.region[1],
+                             h.region[2], h.region[3] ) );
+    return pic;
+}
+
+image_type_ptr DiskCache::fetch( const std::string& key )
+{
+    if ( !_active ) return image_type_ptr();
+
+    std::string file;
+    {
+        SCOPED_LOCK( _mutex );
+        Index::iterator i = _index.find( key );
+        if ( i == _index.end() || i->second.pending )
+            return image_type_ptr();
+        _lru.splice( _lru.begin(), _lru, i->second.lru );
+        file = i->second.file;
+    }
+
+    image_type_ptr pic = read( file, key );
+    if ( !pic )
+    {
+        // Removed, damaged or overwritten by a key of the same hash.
+        SCOPED_LOCK( _mutex );
+        Index::iterator i = _index.find( key );
+        if ( i != _index.end() && !i->second.pending ) erase( i );
+    }
+    return pic;
+}
+
+void DiskCache::erase( Index::iterator i )
+{
+    boost::system::error_code ec;
+    if ( !i->second.pending )
+    {
+        fs::remove( i->second.file, ec );
+        _bytes -= i->second.bytes;
+    }
+    _lru.erase( i->second.lru );
+
+    FrameCount::iterator c = _frames.find( frame_key( i->first ) );
+    if ( c != _frames.end() && --c->second == 0 ) _frames.erase( c );
+
+    _index.erase( i );
+}
+
+void DiskCache::trim()
+{
+    std::list< std::string >::iterator k = _lru.end();
+    while ( _bytes > _max_bytes && k != _lru.begin() )
+    {
+        --k;
+        Index::iterator i = _index.find( *k );
+        if ( i->second.pending ) continue;
+
+        std::list< std::string >::iterator prev = k;
+        ++prev;
+        erase( i );
+        k = prev;
+    }
+}
+
+void DiskCache::clear()
+{
+    SCOPED_LOCK( _mutex );
+
+    Index::iterator i = _index.begin();
+    while ( i != _index.end() )
+    {
+        Index::iterator n = i;
+        ++n;
+        if ( !i->second.pending ) erase( i );
+        i = n;
+    }
+}
+
+} // namespace mrv
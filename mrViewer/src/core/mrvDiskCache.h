@@ -0,0 +1,151 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvDiskCache.h
+ * @author gga
+ * @date   Mon Oct 19 00:02:18 2026
+ *
+ * @brief  Decoded frames spilled to a local disk.
+ *
+ *
+ */
+
+#ifndef mrvDiskCache_h
+#define mrvDiskCache_h
+
+#include <atomic>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "core/mrvFrame.h"
+#include "core/mrvPackedFrame.h"
+
+namespace mrv {
+
+//
+// Frames evicted from memory are written, already decoded, to files in a
+// directory of a local disk, and mapped back from them when needed again
+// instead of being read and decoded from their source.  Writing is done
+// in the background.  The least recently used files are removed past
+// max_bytes().
+//
+// Frames are found by a key made of their source file, its modification
+// time, the frame, eye and layer, so a re-rendered frame is never served
+// stale.
+//
+class DiskCache
+{
+public:
+    typedef boost::mutex Mutex;
+
+public:
+    static DiskCache& instance();
+
+    // Directory the frames are written to.  Empty turns the cache off.
+    // Frames left in it by a previous session are used.
+    void directory( const std::string& dir );
+    std::string directory() const;
+
+    inline bool active() const { return _active; }
+
+    // Most bytes kept on disk.
+    void max_bytes( const boost::uint64_t bytes );
+    inline boost::uint64_t max_bytes() const { return _max_bytes; }
+
+    // Default directory, under the user's home, as the temporary
+    // directory is often kept in memory.
+    static std::string default_directory();
+
+    // Write pic, or p once expanded, under key in the background.
+    void store( const std::string& key, const image_type_ptr& pic );
+    void store( const std::string& key, const PackedFrame_ptr& p );
+
+    // The frame stored under key, mapped from its file, or NULL.
+    image_type_ptr fetch( const std::string& key );
+
+    // True if a frame is stored under key, whatever the modification
+    // time in it.  Saves looking at the source of frames never stored.
+    bool may_hold( const std::string& key ) const;
+
+    // Remove all files of the cache.
+    void clear();
+
+protected:
+    struct Entry
+    {
+        std::string     file;
+        boost::uint64_t bytes;
+        bool            pending;  //!< still being written
+        std::list< std::string >::iterator lru;
+    };
+
+    typedef std::unordered_map< std::string, Entry > Index;
+
+    // Number of keys stored of each key without modification time.
+    typedef std::unordered_map< std::string, unsigned > FrameCount;
+
+protected:
+    DiskCache();
+
+    // Add an entry for key to be written.  False if the cache is off,
+    // holds key already or too many frames are waiting to be written.
+    bool reserve( const std::string& key );
+
+    void write_frame( const std::string key, const image_type_ptr pic );
+    void write_packed( const std::string key, const PackedFrame_ptr p );
+
+    static bool write( const std::string& file, const std::string& key,
+                       const VideoFrame& pic );
+    static image_type_ptr read( const std::string& file,
+                                const std::string& key );
+
+    // Read the keys of the files in the directory.
+    void scan();
+
+    // Key without the modification time of the source.
+    static std::string frame_key( const std::string& key );
+
+    // Add an entry to the index.  Called with _mutex locked.
+    Entry& add( const std::string& key );
+
+    // Remove the least recently used files past _max_bytes.  Called with
+    // _mutex locked.
+    void trim();
+
+    // Called with _mutex locked.
+    void erase( Index::iterator i );
+
+protected:
+    mutable Mutex            _mutex;
+    std::atomic<bool>        _active;
+    std::string              _dir;
+    boost::uint64_t          _max_bytes;
+    boost::uint64_t          _bytes;
+    unsigned                 _pending;
+    Index                    _index;
+    FrameCount               _frames;
+    std::list< std::string > _lru;     //!< keys, most recently used first
+};
+
+} // namespace mrv
+
+#endif // mrvDiskCache_h
@@ -25,8 +25,10 @@
  *
  */
 
+#include <cmath>
 #include <iostream>
 #include <limits>    // for quietNaN
+#include <vector>
 
 #include <half.h>
 
@@ -59,11 +61,19 @@ float yw[3] = { 0.2126f, 0.7152f, 0.0722f };
 
 #include "core/mrvI8N.h"
 #include "core/mrvAlignedData.h"
+#include "core/mrvFramePool.h"
+#include "core/mrvResample.h"
 #include "core/mrvFrame_u8.inl"
 #include "core/mrvFrame_u16.inl"
 #include "core/mrvFrame_u32.inl"
 #include "core/mrvFrame_h16.inl"
 #include "core/mrvFrame_f32.inl"
+#include "core/mrvFrame_rows.inl"
+#include "core/mrvScheduler.h"
+#include "core/mrvThread.h"
+
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/bind.hpp>
 
 
 // #define DEBUG_ALLOCS
@@ -273,6 +283,33 @@ size_t VideoFrame::data_size() const
 }
 
 
+VideoFrame::VideoFrame( const boost::int64_t& frame,
+                        const size_t w, const size_t h,
+                        const unsigned short c,
+                        const Format format,
+                        const PixelType type,
+                        const boost::int64_t repeat,
+                        const boost::int64_t pts,
+                        const PixelData& data ) :
+    _frame( frame ),
+    _pts( pts ),
+    _repeat( repeat ),
+    _width( w ),
+    _height( h ),
+    _valid( true ),
+    _channels( c ),
+    _ctime( 0 ),
+    _mtime( 0 ),
+    _format( format ),
+    _type( type ),
+    _data( data ),
+    _has_stats( false ),
+    _shown( false )
+{
+    gettimeofday( &_ptime, NULL );
+    CMedia::memory_used += data_size();
+}
+
 VideoFrame::~VideoFrame()
 {
 #ifdef DEBUG_ALLOCS
@@ -284,19 +321,20 @@ VideoFrame::~VideoFrame()
 }
 
 /**
- * Allocate a frame aligned to 16 bytes in memory.
+ * Allocate a frame aligned to 16 bytes in memory.  The buffer comes from
+ * the frame pool and goes back to it when the frame is released.
  *
  */
 void VideoFrame::allocate()
 {
     size_t size = data_size();
-    mrv::aligned16_uint8_t* ptr = new mrv::aligned16_uint8_t[ size ];
+    _data = FramePool::instance().acquire( size );
 #ifdef DEBUG_ALLOCS
     std::cerr << this << " alloc video frame " << std::dec << _frame << " "
-              << (void*) ptr << " size: " << size << std::endl
-              << this << " ptr+size=" << (void*) (ptr+size) << std::endl;
+              << (void*) _data.get() << " size: " << size << std::endl
+              << this << " ptr+size=" << (void*) (_data.get()+size)
+              << std::endl;
 #endif
-    _data.reset( ptr );
     CMedia::memory_used += size;
 }
 
@@ -352,6 +390,8 @@ void VideoFrame::pixel( const unsigned int x, const unsigned int y,
     if ( !_data )
         throw std::runtime_error( _("mrv::Frame No pixel data to change") );
 
+    _has_stats.store( false, std::memory_order_relaxed );
+
     switch( _type )
     {
     case kByte:
@@ -369,6 +409,196 @@ void VideoFrame::pixel( const unsigned int x, const unsigned int y,
     }
 }
 
+RowReader::RowReader( const VideoFrame* pic ) :
+    _pic( pic )
+{
+    RowWriter::WriteFunc wr;
+    _specialized = select_row( pic, _read, wr );
+}
+
+RowWriter::RowWriter( VideoFrame* pic ) :
+    _pic( pic )
+{
+    RowReader::ReadFunc rd;
+    _specialized = select_row( pic, rd, _write );
+}
+
+
+namespace {
+
+typedef boost::mutex Mutex;
+
+// Guards the statistics of all frames, which are stored once.
+Mutex stats_mutex;
+
+// Rows of the picture each task of stats() reads.
+const unsigned kStatsRows = 32;
+
+struct StatsBand
+{
+    mrv::ImagePixel min;
+    mrv::ImagePixel max;
+    double          sum[4];
+    boost::uint64_t count[4];
+};
+
+// Part of pic the statistics are of: the region decoded, as the rest is
+// black, or all of it.
+mrv::Recti stats_area( const VideoFrame* pic )
+{
+    const int W = int( pic->width() );
+    const int H = int( pic->height() );
+    const mrv::Recti& r = pic->region();
+    if ( r.empty() ) return mrv::Recti( 0, 0, W, H );
+
+    const int x = std::min( std::max( r.x(), 0 ), W );
+    const int y = std::min( std::max( r.y(), 0 ), H );
+    return mrv::Recti( x, y, std::min( r.r(), W ) - x,
+                       std::min( r.b(), H ) - y );
+}
+
+/**
+ * Find the minimum, maximum and sum of the finite values of each channel
+ * of a band of rows of the stats_area() of pic.
+ */
+void stats_cb( const VideoFrame* pic, const mrv::Recti* area,
+               StatsBand* bands, const unsigned band )
+{
+    const unsigned yl = area->y() + band * kStatsRows;
+    unsigned yh = yl + kStatsRows;
+    if ( yh > unsigned( area->b() ) ) yh = area->b();
+
+    const unsigned x0 = area->x();
+    const unsigned n = area->w();
+    mrv::RowReader read( pic );
+    std::vector< ImagePixel > row( n );
+
+    StatsBand& b = bands[band];
+    float* lo = (float*) &b.min;
+    float* hi = (float*) &b.max;
+    for ( unsigned c = 0; c < 4; ++c )
+    {
+        lo[c] = std::numeric_limits<float>::max();
+        hi[c] = -std::numeric_limits<float>::max();
+        b.sum[c] = 0.0;
+        b.count[c] = 0;
+    }
+
+    for ( unsigned y = yl; y < yh; ++y )
+    {
+        read( y, x0, n, &row[0] );
+        const float* f = (const float*) &row[0];
+
+        // Sums of a row are kept in floats and added to the doubles
+        // of the band, which keeps them precise enough.
+#ifdef MR_SSE
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one  = _mm_set1_ps( 1.0f );
+        const __m128 big  = _mm_set1_ps( std::numeric_limits<float>::max() );
+        const __m128 nbig = _mm_set1_ps( -std::numeric_limits<float>::max() );
+        __m128 vlo = _mm_loadu_ps( lo );
+        __m128 vhi = _mm_loadu_ps( hi );
+        __m128 sum = zero;
+        __m128 cnt = zero;
+        for ( unsigned i = 0; i < n; ++i, f += 4 )
+        {
+            const __m128 v = _mm_loadu_ps( f );
+            // v - v is 0 for finite values only.
+            const __m128 ok = _mm_cmpeq_ps( _mm_sub_ps( v, v ), zero );
+            const __m128 x = _mm_and_ps( ok, v );
+            vlo = _mm_min_ps( vlo, _mm_or_ps( x, _mm_andnot_ps( ok, big ) ) );
+            vhi = _mm_max_ps( vhi, _mm_or_ps( x, _mm_andnot_ps( ok, nbig ) ) );
+            sum = _mm_add_ps( sum, x );
+            cnt = _mm_add_ps( cnt, _mm_and_ps( ok, one ) );
+        }
+        _mm_storeu_ps( lo, vlo );
+        _mm_storeu_ps( hi, vhi );
+        float s[4], k[4];
+        _mm_storeu_ps( s, sum );
+        _mm_storeu_ps( k, cnt );
+        for ( unsigned c = 0; c < 4; ++c )
+        {
+            b.sum[c] += s[c];
+            b.count[c] += boost::uint64_t( k[c] );
+        }
+#else
+        float s[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for ( unsigned i = 0; i < n; ++i, f += 4 )
+        {
+            for ( unsigned c = 0; c < 4; ++c )
+            {
+                if ( !std::isfinite( f[c] ) ) continue;
+                if ( f[c] < lo[c] ) lo[c] = f[c];
+                if ( f[c] > hi[c] ) hi[c] = f[c];
+                s[c] += f[c];
+                ++b.count[c];
+            }
+        }
+        for ( unsigned c = 0; c < 4; ++c )
+            b.sum[c] += s[c];
+#endif
+    }
+}
+
+}  // namespace
+
+const VideoFrame::Stats& VideoFrame::stats() const
+{
+    if ( _has_stats.load( std::memory_order_acquire ) )
+        return _stats;
+
+    Stats r;
+    float* lo = (float*) &r.min;
+    float* hi = (float*) &r.max;
+    float* mean = (float*) &r.mean;
+    for ( unsigned c = 0; c < 4; ++c )
+        lo[c] = hi[c] = mean[c] = 0.0f;
+
+    const mrv::Recti area = stats_area( this );
+    if ( _data && area.w() > 0 && area.h() > 0 )
+    {
+        const unsigned n = ( area.h() + kStatsRows - 1 ) / kStatsRows;
+        std::vector< StatsBand > bands( n );
+
+        Scheduler::instance().parallel_for( n,
+                                            boost::bind( stats_cb, this,
+                                                         &area, &bands[0],
+                                                         _1 ),
+                                            "stats" );
+
+        for ( unsigned c = 0; c < 4; ++c )
+        {
+            float l = std::numeric_limits<float>::max();
+            float h = -std::numeric_limits<float>::max();
+            double sum = 0.0;
+            boost::uint64_t count = 0;
+            for ( unsigned i = 0; i < n; ++i )
+            {
+                const float* bl = (const float*) &bands[i].min;
+                const float* bh = (const float*) &bands[i].max;
+                if ( bl[c] < l ) l = bl[c];
+                if ( bh[c] > h ) h = bh[c];
+                sum += bands[i].sum[c];
+                count += bands[i].count[c];
+            }
+
+            // Channels with no finite values are left at 0.
+            if ( count == 0 ) continue;
+            lo[c] = l;
+            hi[c] = h;
+            mean[c] = float( sum / double( count ) );
+        }
+    }
+
+    SCOPED_LOCK( stats_mutex );
+    if ( ! _has_stats.load( std::memory_order_relaxed ) )
+    {
+        _stats = r;
+        _has_stats.store( true, std::memory_order_release );
+    }
+    return _stats;
+}
+
 /**
  * Scale video frame in X
  *
@@ -569,33 +799,18 @@ VideoFrame* VideoFrame::quick_resize( unsigned int w, unsigned int h ) const
 }
 
 /**
- * Resize video frame with box filtering.
+ * Resize video frame with a tent filter.  See mrv::resample().
  *
- * @param w width of resulting video frame
- * @param h height of resulting video frame
+ * @param w width of resulting video frame (0 to keep width)
+ * @param h height of resulting video frame (0 to keep height)
  *
  * @return resized video frame
  */
 VideoFrame* VideoFrame::resize( unsigned int w, unsigned int h ) const
 {
-
-    double f;
-    if ( w == 0 || width() == 0 )
-        f = 1.0;
-    else
-        f = (double) w / (double)width();
-
-    VideoFrame* scaledX = scaleX( float(f) );
-
-    if ( h == 0 || height() == 0 )
-        f = 1.0;
-    else
-        f = (double) h / (double)height();
-
-    VideoFrame* scaled  = scaledX->scaleY( float(f) );
-    delete scaledX;
-
-    return scaled;
+    if ( w == 0 ) w = unsigned( width() );
+    if ( h == 0 ) h = unsigned( height() );
+    return resample( this, w, h );
 }
 
 /**
@@ -649,6 +864,9 @@ VideoFrame::self& VideoFrame::operator=( const VideoFrame::self& b )
     _mtime    = b.mtime();
     _type     = b.pixel_type();
     _valid    = b.valid();
+    _region   = b.region();
+    _has_stats = false;
+    _shown    = b._shown.load();
     allocate();
 #ifdef DEBUG_ALLOCS
     std::cerr << "VideoFrame::operator= memcpy " << b.data_size() << std::endl;
@@ -658,6 +876,15 @@ VideoFrame::self& VideoFrame::operator=( const VideoFrame::self& b )
 }
 
 
+bool VideoFrame::has_region( const mrv::Recti& r ) const
+{
+    if ( _region.empty() ) return true;
+    if ( r.empty() ) return false;
+    return ( r.x() >= _region.x() && r.y() >= _region.y() &&
+             r.r() <= _region.r() && r.b() <= _region.b() );
+}
+
+
 void copy_image( mrv::image_type_ptr& dst, const mrv::image_type_ptr& src,
                  SwsContext** sws_ctx )
 {
@@ -724,13 +951,13 @@ void copy_image( mrv::image_type_ptr& dst, const mrv::image_type_ptr& src,
             tmp = src;
         }
 
+        RowReader read( tmp.get() );
+        RowWriter write( dst.get() );
+        std::vector< ImagePixel > row( sw );
         for ( unsigned y = 0; y < sh; ++y )
         {
-            for ( unsigned x = 0; x < sw; ++x )
-            {
-                const ImagePixel& p = tmp->pixel( x, y );
-                dst->pixel( x, y, p );
-            }
+            read( y, 0, sw, &row[0] );
+            write( y, 0, sw, &row[0] );
         }
     }
 }
@@ -741,7 +968,28 @@ void AudioFrame::sum_memory() noexcept
     std::cerr << "alloc audio frame " << _frame << " " << (void*) _data
               << " size: " << _size << std::endl;
 #endif
-    CMedia::memory_used += _size;
+    CMedia::memory_used += _capacity;
+}
+
+void AudioFrame::assign( const boost::int64_t frame,
+                         const int freq, const short channels,
+                         const boost::uint8_t* data, const unsigned int size )
+{
+    if ( size > _capacity )
+    {
+        mrv::aligned16_uint8_t* d = new mrv::aligned16_uint8_t[size];
+        delete [] _data;
+        _data = d;
+        CMedia::memory_used += size - _capacity;
+        _capacity = size;
+    }
+
+    gettimeofday( &_ptime, NULL );
+    _frame = frame;
+    _freq = freq;
+    _channels = channels;
+    _size = size;
+    memcpy( _data, data, size );
 }
 
 AudioFrame::~AudioFrame()
@@ -751,7 +999,7 @@ AudioFrame::~AudioFrame()
 #endif
     delete [] _data;
     _data = NULL;
-    CMedia::memory_used -= _size;
+    CMedia::memory_used -= _capacity;
     //assert0( CMedia::memory_used >= 0 );
     if ( CMedia::memory_used < 0 ) CMedia::memory_used = 0;
 }
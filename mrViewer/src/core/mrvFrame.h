@@ -39,6 +39,7 @@
 #endif
 
 
+#include <atomic>
 #include <cstring>
 #include <ctime>                  // for time_t
 #ifdef LINUX
@@ -54,6 +55,7 @@
 #include "core/mrvAssert.h"
 #include "core/mrvAlignedData.h"
 #include "core/mrvImagePixel.h"
+#include "core/mrvRectangle.h"
 
 struct SwsContext;
 
@@ -127,6 +129,14 @@ public:
     typedef ImagePixel       Pixel;
     typedef boost::shared_array< mrv::aligned16_uint8_t > PixelData;
 
+    // Minimum, maximum and mean of the finite values of each channel.
+    struct Stats
+    {
+        ImagePixel min;
+        ImagePixel max;
+        ImagePixel mean;
+    };
+
 private:
     boost::int64_t              _frame;  //!< position in video stream
     boost::int64_t              _pts;  //!< video pts in ffmpeg
@@ -141,6 +151,10 @@ private:
     Format                      _format; //!< rgb/yuv format
     PixelType                   _type;   //!< pixel type
     PixelData                   _data;   //!< video data
+    mrv::Recti                  _region; //!< part decoded, empty if all
+    mutable Stats               _stats;
+    mutable std::atomic<bool>   _has_stats;
+    mutable std::atomic<bool>   _shown;   //!< shown, or not freshly decoded
 
 public:
 
@@ -156,7 +170,9 @@ public:
         _ctime( 0 ),
         _mtime( 0 ),
         _format( kRGBA ),
-        _type( kByte )
+        _type( kByte ),
+        _has_stats( false ),
+        _shown( false )
     {
         gettimeofday( &_ptime, NULL );
     }
@@ -172,7 +188,10 @@ public:
         _ctime( b._ctime ),
         _mtime( b._mtime ),
         _format( b._format ),
-        _type( b._type )
+        _type( b._type ),
+        _region( b._region ),
+        _has_stats( false ),
+        _shown( b._shown.load() )
     {
         gettimeofday( &_ptime, NULL );
         allocate();
@@ -197,12 +216,25 @@ public:
         _ctime( 0 ),
         _mtime( 0 ),
         _format( format ),
-        _type( type )
+        _type( type ),
+        _has_stats( false ),
+        _shown( false )
     {
         gettimeofday( &_ptime, NULL );
         allocate();
     }
 
+    // Use pixels allocated elsewhere (a decoder's frame), without a copy.
+    // They must be laid out as allocate() would.
+    VideoFrame( const boost::int64_t& frame,
+                const size_t w, const size_t h,
+                const unsigned short c,
+                const Format format,
+                const PixelType type,
+                const boost::int64_t repeat,
+                const boost::int64_t pts,
+                const PixelData& data );
+
     ~VideoFrame();
 
     void allocate();
@@ -213,6 +245,12 @@ public:
         return _ptime;
     }
 
+    // Mark the frame as shown.  Returns whether it was already shown, or
+    // was not decoded just now (unpacked or read back from disk).
+    inline bool shown() const {
+        return _shown.exchange( true );
+    }
+
     inline void width( const size_t w ) {
         _width = w;
     }
@@ -310,10 +348,26 @@ public:
         return _data;
     }
 
+    // Part of the picture that was decoded, in pixels.  The rest is
+    // black.  An empty region means all of it.
+    inline void region( const mrv::Recti& r ) {
+        _region = r;
+    }
+    inline const mrv::Recti& region() const {
+        return _region;
+    }
+
+    // True if the decoded part holds all of r (empty meaning all).
+    bool has_region( const mrv::Recti& r ) const;
+
     ImagePixel pixel( const unsigned int x, const unsigned int y ) const;
     void pixel( const unsigned int x, const unsigned int y,
                 const ImagePixel& p );
 
+    // Statistics of the pixels.  Computed in parallel the first time
+    // they are asked for, and kept until pixel() changes a pixel.
+    const Stats& stats() const;
+
     inline bool operator==( const self& b ) const
     {
         return _frame == b.frame();  // should never happen
@@ -385,6 +439,68 @@ private:
 };
 
 
+//
+// Reading a picture one pixel() at a time switches on its pixel type and
+// format for every pixel.  RowReader and RowWriter pick a function
+// specialized on pixel type and channel layout once per picture, and
+// then convert whole rows (or every step'th pixel of a row) with it.
+// Interleaved lumma, RGB(A) and BGR(A) pictures get tight loops.  Planar
+// and YUV pictures still go through pixel().
+//
+class RowReader
+{
+public:
+    typedef void (*ReadFunc)( const VideoFrame* pic, const unsigned y,
+                              const unsigned x, const unsigned n,
+                              const unsigned step, ImagePixel* out );
+
+public:
+    RowReader( const VideoFrame* pic );
+
+    // Read n pixels of row y into out, starting at x, every step pixels.
+    inline void operator()( const unsigned y, const unsigned x,
+                            const unsigned n, ImagePixel* out,
+                            const unsigned step = 1 ) const
+    {
+        _read( _pic, y, x, n, step, out );
+    }
+
+    // True if the picture has a specialized, fast reader.
+    inline bool specialized() const { return _specialized; }
+
+protected:
+    const VideoFrame* _pic;
+    ReadFunc          _read;
+    bool              _specialized;
+};
+
+class RowWriter
+{
+public:
+    typedef void (*WriteFunc)( VideoFrame* pic, const unsigned y,
+                               const unsigned x, const unsigned n,
+                               const unsigned step, const ImagePixel* in );
+
+public:
+    RowWriter( VideoFrame* pic );
+
+    // Write n pixels from in to row y, starting at x, every step pixels.
+    inline void operator()( const unsigned y, const unsigned x,
+                            const unsigned n, const ImagePixel* in,
+                            const unsigned step = 1 ) const
+    {
+        _write( _pic, y, x, n, step, in );
+    }
+
+    inline bool specialized() const { return _specialized; }
+
+protected:
+    VideoFrame* _pic;
+    WriteFunc   _write;
+    bool        _specialized;
+};
+
+
 class AudioFrame
 {
     timeval                _ptime; //!< audio creation time
@@ -392,6 +508,7 @@ class AudioFrame
     short        _channels;  //!< number of channels
     unsigned int     _freq;  //!< audio frequency
     unsigned int     _size;  //!< size of data (in bytes)
+    unsigned int _capacity;  //!< size of data allocated (in bytes)
     mrv::aligned16_uint8_t*  _data;  //!< audio data of size _size
 
 public:
@@ -406,6 +523,7 @@ public:
         _channels( channels ),
         _freq( freq ),
         _size( size ),
+        _capacity( size ),
         _data( new mrv::aligned16_uint8_t[size] )
     {
         gettimeofday( &_ptime, NULL );
@@ -415,6 +533,12 @@ public:
 
     void sum_memory() noexcept;
 
+    // Reuse this frame for another one, reallocating only if its data
+    // does not fit.
+    void assign( const boost::int64_t frame,
+                 const int freq, const short channels,
+                 const boost::uint8_t* data, const unsigned int size );
+
 
     ~AudioFrame();
 
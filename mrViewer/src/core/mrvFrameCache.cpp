@@ -0,0 +1,370 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvFrameCache.cpp
+ * @author gga
+ * @date   Sat Oct 17 10:12:31 2026
+ *
+ * @brief  Process-wide LRU cache of sequence frames, shared by all CMedia.
+ *
+ *
+ */
+
+#include "core/CMedia.h"
+#include "core/mrvFrameCache.h"
+
+namespace mrv {
+
+FrameCache& FrameCache::instance()
+{
+    static FrameCache cache;
+    return cache;
+}
+
+FrameCache::FrameCache() :
+    _evicting( 0 ),
+    _bytes( 0 ),
+    _hits( 0 ),
+    _misses( 0 ),
+    _evictions( 0 )
+{
+    for ( int i = 0; i < kNumPriorities; ++i )
+        _head[i] = _tail[i] = NULL;
+}
+
+FrameCache::~FrameCache()
+{
+    for ( const auto& i : _index )
+        delete i.second;
+}
+
+/**
+ * Link an entry at the most recently used end of its priority list.
+ *
+ * @param e entry to link
+ */
+void FrameCache::link( Entry* e )
+{
+    int p = e->priority;
+    e->prev = NULL;
+    e->next = _head[p];
+    if ( _head[p] ) _head[p]->prev = e;
+    _head[p] = e;
+    if ( !_tail[p] ) _tail[p] = e;
+}
+
+/**
+ * Unlink an entry from its priority list.
+ *
+ * @param e entry to unlink
+ */
+void FrameCache::unlink( Entry* e )
+{
+    int p = e->priority;
+    if ( e->prev ) e->prev->next = e->next;
+    else           _head[p] = e->next;
+    if ( e->next ) e->next->prev = e->prev;
+    else           _tail[p] = e->prev;
+    e->prev = e->next = NULL;
+}
+
+void FrameCache::insert( CMedia* img, const boost::int64_t frame,
+                         const short eye, const size_t bytes,
+                         const size_t disk_bytes )
+{
+    Mutex::scoped_lock lk( _mutex );
+
+    Key k = { img, frame, eye };
+    Index::iterator i = _index.find( k );
+    if ( i != _index.end() )
+    {
+        Entry* e = i->second;
+        _bytes -= e->bytes;
+        e->bytes = bytes;
+        e->disk_bytes = disk_bytes;
+        _bytes += bytes;
+        unlink( e );
+        link( e );
+        return;
+    }
+
+    Entry* e = new Entry;
+    e->key        = k;
+    e->owner      = img;
+    e->bytes      = bytes;
+    e->disk_bytes = disk_bytes;
+    e->priority   = kNormalPriority;
+
+    PriorityMap::const_iterator p = _priorities.find( img );
+    if ( p != _priorities.end() ) e->priority = p->second;
+
+    link( e );
+    _index.insert( std::make_pair( k, e ) );
+    _bytes += bytes;
+}
+
+bool FrameCache::touch( const CMedia* img, const boost::int64_t frame,
+                        const short eye )
+{
+    Mutex::scoped_lock lk( _mutex );
+
+    Key k = { img, frame, eye };
+    Index::iterator i = _index.find( k );
+    if ( i == _index.end() )
+    {
+        ++_misses;
+        return false;
+    }
+
+    ++_hits;
+    Entry* e = i->second;
+    if ( _head[e->priority] != e )
+    {
+        unlink( e );
+        link( e );
+    }
+    return true;
+}
+
+void FrameCache::erase( const CMedia* img, const boost::int64_t frame,
+                        const short eye )
+{
+    Mutex::scoped_lock lk( _mutex );
+
+    Key k = { img, frame, eye };
+    Index::iterator i = _index.find( k );
+    if ( i == _index.end() ) return;
+
+    Entry* e = i->second;
+    unlink( e );
+    _bytes -= e->bytes;
+    _index.erase( i );
+    delete e;
+}
+
+void FrameCache::erase( const CMedia* img )
+{
+    Mutex::scoped_lock lk( _mutex );
+
+    // Frames being evicted may still be of img.
+    while ( _evicting > 0 )
+        _evicted.wait( lk );
+
+    Index::iterator i = _index.begin();
+    for ( ; i != _index.end(); )
+    {
+        if ( i->first.media != img )
+        {
+            ++i;
+            continue;
+        }
+
+        Entry* e = i->second;
+        unlink( e );
+        _bytes -= e->bytes;
+        delete e;
+        i = _index.erase( i );
+    }
+
+    _windows.erase( img );
+}
+
+bool FrameCache::Window::holds( const boost::int64_t f ) const
+{
+    const boost::int64_t len = last - first + 1;
+    if ( f < first || f > last || len <= 0 ) return false;
+
+    boost::int64_t d = ( dir < 0 ? frame - f : f - frame ) % len;
+    if ( d < 0 ) d += len;
+    if ( dir != 0 ) return d < count;
+
+    // Both ways, half the window on each side.
+    if ( d > len - d ) d = len - d;
+    return 2 * d < count;
+}
+
+void FrameCache::window( const CMedia* img, const Window& w )
+{
+    Mutex::scoped_lock lk( _mutex );
+    _windows[img] = w;
+}
+
+void FrameCache::erase_window( const CMedia* img )
+{
+    Mutex::scoped_lock lk( _mutex );
+    _windows.erase( img );
+}
+
+void FrameCache::limit( const boost::int64_t max_memory,
+                        const CMedia* img, const boost::int64_t frame )
+{
+    std::vector< Entry* > victims;
+
+    {
+        Mutex::scoped_lock lk( _mutex );
+
+        // Frames taken are freed once evicted, or once written by the
+        // disk cache.  Count them as freed already, so no more frames
+        // than needed are taken.
+        boost::int64_t freed = 0;
+
+        // Frames about to be played go last, whatever their priority, so
+        // frames already played make room for those loaded ahead.
+        for ( int pass = 0; pass < 2; ++pass )
+        {
+            for ( int p = kLowPriority; p < kPinned; ++p )
+            {
+                Entry* e = _tail[p];
+                while ( e && CMedia::memory_used - freed >= max_memory )
+                {
+                    Entry* prev = e->prev;
+
+                    if ( e->key.media == img && e->key.frame == frame )
+                    {
+                        e = prev;
+                        continue;
+                    }
+
+                    if ( pass == 0 )
+                    {
+                        WindowMap::const_iterator w =
+                            _windows.find( e->key.media );
+                        if ( w != _windows.end() &&
+                             w->second.holds( e->key.frame ) )
+                        {
+                            e = prev;
+                            continue;
+                        }
+                    }
+
+                    unlink( e );
+                    _bytes -= e->bytes;
+                    _index.erase( e->key );
+                    victims.push_back( e );
+                    freed += e->bytes;
+
+                    e = prev;
+                }
+            }
+        }
+
+        if ( victims.empty() ) return;
+        ++_evicting;
+    }
+
+    evict( victims );
+}
+
+void FrameCache::evict( std::vector< Entry* >& victims )
+{
+    std::vector< Entry* > busy;
+
+    std::vector< Entry* >::iterator i = victims.begin();
+    std::vector< Entry* >::iterator e = victims.end();
+    for ( ; i != e; ++i )
+    {
+        Entry* v = *i;
+
+        // Never block on the owner: it may be waiting on us.
+        CMedia::Mutex& mtx = v->owner->video_mutex();
+        if ( !mtx.try_lock() )
+        {
+            busy.push_back( v );
+            continue;
+        }
+
+        // The frame may have been cached again since it was taken.
+        bool cached;
+        {
+            Mutex::scoped_lock lk( _mutex );
+            cached = ( _index.find( v->key ) != _index.end() );
+        }
+        if ( !cached )
+        {
+            v->owner->evict_frame( v->key.frame, v->key.eye,
+                                   v->disk_bytes );
+            ++_evictions;
+        }
+        mtx.unlock();
+        delete v;
+    }
+
+    Mutex::scoped_lock lk( _mutex );
+
+    // Put back frames of busy owners, unless cached again meanwhile.
+    for ( i = busy.begin(); i != busy.end(); ++i )
+    {
+        Entry* v = *i;
+        if ( _index.find( v->key ) != _index.end() )
+        {
+            delete v;
+            continue;
+        }
+        link( v );
+        _index.insert( std::make_pair( v->key, v ) );
+        _bytes += v->bytes;
+    }
+
+    if ( --_evicting == 0 ) _evicted.notify_all();
+}
+
+void FrameCache::priority( const CMedia* img, const Priority p )
+{
+    Mutex::scoped_lock lk( _mutex );
+
+    if ( p == kNormalPriority ) _priorities.erase( img );
+    else                        _priorities[img] = p;
+
+    for ( const auto& i : _index )
+    {
+        Entry* e = i.second;
+        if ( e->key.media != img || e->priority == p ) continue;
+        unlink( e );
+        e->priority = p;
+        link( e );
+    }
+}
+
+FrameCache::Priority FrameCache::priority( const CMedia* img ) const
+{
+    Mutex::scoped_lock lk( _mutex );
+
+    PriorityMap::const_iterator i = _priorities.find( img );
+    if ( i == _priorities.end() ) return kNormalPriority;
+    return i->second;
+}
+
+FrameCache::Stats FrameCache::stats() const
+{
+    Mutex::scoped_lock lk( _mutex );
+
+    Stats s;
+    s.hits      = _hits;
+    s.misses    = _misses;
+    s.evictions = _evictions;
+    s.frames    = _index.size();
+    s.bytes     = _bytes;
+    return s;
+}
+
+void FrameCache::reset_stats()
+{
+    _hits = _misses = _evictions = 0;
+}
+
+} // namespace mrv
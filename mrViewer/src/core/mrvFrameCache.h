@@ -0,0 +1,205 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvFrameCache.h
+ * @author gga
+ * @date   Sat Oct 17 10:12:31 2026
+ *
+ * @brief  Process-wide LRU cache of sequence frames, shared by all CMedia.
+ *
+ *
+ */
+
+#ifndef mrvFrameCache_h
+#define mrvFrameCache_h
+
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace mrv {
+
+class CMedia;
+
+//
+// The frame cache does not own the pictures.  Those still live in each
+// CMedia's _sequence/_right arrays.  The cache keeps an index of which
+// slots are filled, in least-recently-used order, so that when
+// Preferences::max_memory is exceeded the oldest frame of *any* clip is
+// the one released, in O(1).
+//
+// Locking order is CMedia::_mutex -> FrameCache::_mutex.  Frames to
+// evict are taken out of the index first and released by their owners
+// once our mutex is unlocked, so the rest of the cache does not wait on
+// them.  Owners are only try_lock()ed, and frames of a busy owner are put
+// back.
+//
+class FrameCache
+{
+public:
+    typedef boost::mutex              Mutex;
+    typedef boost::condition_variable Condition;
+
+    enum Eye
+    {
+        kLeftEye  = 0,
+        kRightEye = 1
+    };
+
+    enum Priority
+    {
+        kLowPriority = 0,
+        kNormalPriority,
+        kHighPriority,
+        kPinned,          //!< never evicted
+        kNumPriorities
+    };
+
+    struct Key
+    {
+        const CMedia*  media;
+        boost::int64_t frame;
+        short          eye;
+
+        inline bool operator==( const Key& b ) const
+        {
+            return media == b.media && frame == b.frame && eye == b.eye;
+        }
+    };
+
+    struct KeyHash
+    {
+        inline size_t operator()( const Key& k ) const
+        {
+            size_t h = std::hash< const void* >()( k.media );
+            h ^= std::hash< boost::int64_t >()( k.frame ) + 0x9e3779b9 +
+                 ( h << 6 ) + ( h >> 2 );
+            return h ^ size_t( k.eye );
+        }
+    };
+
+    struct Entry
+    {
+        Key      key;
+        CMedia*  owner;
+        size_t   bytes;        //!< memory used by the cached picture
+        size_t   disk_bytes;   //!< size of file on disk
+        Priority priority;
+        Entry*   prev;         //!< towards most recently used
+        Entry*   next;         //!< towards least recently used
+    };
+
+    // Frames about to be played: count frames from frame, forwards
+    // (dir 1), backwards (-1) or both ways (0), wrapping in [first, last].
+    struct Window
+    {
+        boost::int64_t frame;
+        boost::int64_t count;
+        boost::int64_t first;
+        boost::int64_t last;
+        int            dir;
+
+        bool holds( const boost::int64_t f ) const;
+    };
+
+    struct Stats
+    {
+        boost::uint64_t hits;
+        boost::uint64_t misses;
+        boost::uint64_t evictions;
+        boost::uint64_t frames;
+        boost::uint64_t bytes;
+    };
+
+public:
+    static FrameCache& instance();
+
+    // Add (or refresh) a frame as the most recently used one.
+    void insert( CMedia* img, const boost::int64_t frame, const short eye,
+                 const size_t bytes, const size_t disk_bytes );
+
+    // Mark a frame as recently used.  Counts a hit if found, a miss if not.
+    bool touch( const CMedia* img, const boost::int64_t frame,
+                const short eye = kLeftEye );
+
+    // Count a miss for a frame that had to be loaded from disk.
+    inline void miss() { ++_misses; }
+
+    // Remove a single frame from the index (does not release the picture)
+    void erase( const CMedia* img, const boost::int64_t frame,
+                const short eye );
+
+    // Remove all frames of an image from the index.
+    void erase( const CMedia* img );
+
+    // Evict least recently used frames of lowest priority until
+    // CMedia::memory_used drops below max_memory.  Frames in the window
+    // of their image go last.  The frame (img, frame) is never evicted
+    // as it is the one about to be displayed.
+    void limit( const boost::int64_t max_memory,
+                const CMedia* img, const boost::int64_t frame );
+
+    // Set the frames of an image about to be played, or remove them.
+    void window( const CMedia* img, const Window& w );
+    void erase_window( const CMedia* img );
+
+    // Set the eviction priority of all frames of an image.
+    void priority( const CMedia* img, const Priority p );
+    Priority priority( const CMedia* img ) const;
+
+    Stats stats() const;
+    void reset_stats();
+
+protected:
+    FrameCache();
+    ~FrameCache();
+
+    void link( Entry* e );
+    void unlink( Entry* e );
+
+    // Have the owners of entries taken out of the index release their
+    // frames.  Called without _mutex locked.
+    void evict( std::vector< Entry* >& victims );
+
+protected:
+    typedef std::unordered_map< Key, Entry*, KeyHash > Index;
+    typedef std::unordered_map< const CMedia*, Priority > PriorityMap;
+    typedef std::unordered_map< const CMedia*, Window > WindowMap;
+
+    mutable Mutex _mutex;
+    Condition     _evicted;   //!< evict() finished
+    unsigned      _evicting;  //!< evict() calls running
+    Index         _index;
+    PriorityMap   _priorities;
+    WindowMap     _windows;
+    Entry*        _head[kNumPriorities];  //!< most recently used
+    Entry*        _tail[kNumPriorities];  //!< least recently used
+    size_t        _bytes;
+
+    std::atomic<boost::uint64_t> _hits;
+    std::atomic<boost::uint64_t> _misses;
+    std::atomic<boost::uint64_t> _evictions;
+};
+
+} // namespace mrv
+
+#endif // mrvFrameCache_h
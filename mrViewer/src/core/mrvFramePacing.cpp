@@ -0,0 +1,245 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvFramePacing.cpp
+ * @author gga
+ * @date   Sun Oct 18 18:02:14 2026
+ *
+ * @brief  Records when frames were due and shown during playback.
+ *
+ *
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+#include "core/mrvI8N.h"
+#include "core/mrvThread.h"
+#include "core/mrvFramePacing.h"
+#include "gui/mrvIO.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+const char* kModule = "pacing";
+
+// Records kept per playback, about an hour at 60 fps.
+const size_t kMaxRecords = 216000;
+}
+
+namespace mrv {
+
+FramePacing& FramePacing::instance()
+{
+    // Never destroyed, as video threads may still record at exit.
+    static FramePacing* pacing = new FramePacing;
+    return *pacing;
+}
+
+FramePacing::FramePacing() :
+    _fps( 24.0 ),
+    _session( 0 ),
+    _active( false ),
+    _dropped( 0 ),
+    _repeated( 0 )
+{
+    memset( _histogram, 0, sizeof(_histogram) );
+}
+
+void FramePacing::csv( const std::string& file )
+{
+    SCOPED_LOCK( _mutex );
+    _csv = file;
+}
+
+void FramePacing::start( const std::string& name, const double fps )
+{
+    SCOPED_LOCK( _mutex );
+    _name = name;
+    _fps = fps;
+    ++_session;
+    _active = true;
+    _records.clear();
+    _dropped = _repeated = 0;
+    memset( _histogram, 0, sizeof(_histogram) );
+}
+
+void FramePacing::record( const boost::int64_t frame,
+                          const mrv::image_type_ptr& pic,
+                          const boost::int64_t target,
+                          const boost::int64_t present )
+{
+    Record r;
+    r.frame = frame;
+    r.shown = pic ? pic->frame() : frame;
+    r.target = target;
+    r.present = present;
+    r.latency = -1;
+    r.dropped = 0;
+    r.repeated = false;
+
+    // Pictures are stamped with the wall clock when made.  Only those
+    // shown for the first time since decoded measure decode latency, not
+    // those coming back from the cache.
+    if ( pic && !pic->shown() )
+    {
+        timeval now;
+        gettimeofday( &now, NULL );
+        const timeval& t = pic->ptime();
+        r.latency = boost::int64_t( now.tv_sec - t.tv_sec ) * 1000000 +
+                    ( now.tv_usec - t.tv_usec );
+        if ( r.latency < 0 ) r.latency = 0;
+    }
+
+    SCOPED_LOCK( _mutex );
+    if ( !_active ) return;
+
+    if ( !_records.empty() )
+    {
+        // Only count frames played in a row, not loops or seeks.
+        const Record& last = _records.back();
+        if ( std::abs( frame - last.frame ) == 1 )
+        {
+            const boost::int64_t gap = std::abs( r.shown - last.shown );
+            if ( gap == 0 )
+            {
+                r.repeated = true;
+                ++_repeated;
+            }
+            else if ( gap > 1 )
+            {
+                r.dropped = unsigned( gap - 1 );
+                _dropped += r.dropped;
+            }
+        }
+    }
+
+    if ( r.latency >= 0 )
+    {
+        unsigned i = 0;
+        const boost::int64_t ms = r.latency / 1000;
+        while ( i < kLatencyBuckets - 1 && ms >= ( 1LL << i ) ) ++i;
+        ++_histogram[i];
+    }
+
+    if ( _records.size() < kMaxRecords )
+        _records.push_back( r );
+    else
+        _records.back() = r;
+}
+
+void FramePacing::stop()
+{
+    SCOPED_LOCK( _mutex );
+    if ( !_active ) return;
+    _active = false;
+
+    if ( _records.empty() ) return;
+
+    log_summary();
+    if ( !_csv.empty() ) write_csv();
+}
+
+void FramePacing::log_summary() const
+{
+    boost::int64_t jitter = 0, worst = 0;
+    RecordList::const_iterator i = _records.begin();
+    for ( ; i != _records.end(); ++i )
+    {
+        const boost::int64_t late = std::abs( i->present - i->target );
+        jitter += late;
+        if ( late > worst ) worst = late;
+    }
+
+    const size_t n = _records.size();
+    LOG_INFO( _name << ": " << n << _(" frames, ") << _dropped
+              << _(" dropped, ") << _repeated << _(" repeated, ")
+              << jitter / 1000.0 / n << _(" ms average jitter, ")
+              << worst / 1000.0 << _(" ms worst.") );
+
+    std::ostringstream os;
+    for ( unsigned b = 0; b < kLatencyBuckets; ++b )
+    {
+        if ( !_histogram[b] ) continue;
+        if ( b < kLatencyBuckets - 1 )
+            os << " <" << ( 1 << b ) << "ms:" << _histogram[b];
+        else
+            os << " >=" << ( 1 << ( b - 1 ) ) << "ms:" << _histogram[b];
+    }
+    LOG_INFO( _("Decode to display latency:") << os.str() );
+}
+
+void FramePacing::write_csv() const
+{
+    const bool header = ( !fs::exists( _csv ) || fs::file_size( _csv ) == 0 );
+
+    std::ofstream f( _csv.c_str(), std::ios::app );
+    if ( !f )
+    {
+        LOG_ERROR( _("Could not write frame pacing to ") << _csv );
+        return;
+    }
+
+    if ( header )
+        f << "session,media,fps,frame,shown,target_us,present_us,late_us,"
+          << "dropped,repeated,latency_us" << std::endl;
+
+    // Times are relative to the first frame due.
+    const boost::int64_t t0 = _records.front().target;
+    RecordList::const_iterator i = _records.begin();
+    for ( ; i != _records.end(); ++i )
+    {
+        f << _session << ",\"" << _name << "\"," << _fps << ','
+          << i->frame << ',' << i->shown << ','
+          << i->target - t0 << ',' << i->present - t0 << ','
+          << i->present - i->target << ','
+          << i->dropped << ',' << ( i->repeated ? 1 : 0 ) << ','
+          << i->latency << std::endl;
+    }
+}
+
+unsigned FramePacing::frames() const
+{
+    SCOPED_LOCK( _mutex );
+    return unsigned( _records.size() );
+}
+
+unsigned FramePacing::dropped() const
+{
+    SCOPED_LOCK( _mutex );
+    return _dropped;
+}
+
+unsigned FramePacing::repeated() const
+{
+    SCOPED_LOCK( _mutex );
+    return _repeated;
+}
+
+std::vector< unsigned > FramePacing::histogram() const
+{
+    SCOPED_LOCK( _mutex );
+    return std::vector< unsigned >( _histogram,
+                                    _histogram + kLatencyBuckets );
+}
+
+} // namespace mrv
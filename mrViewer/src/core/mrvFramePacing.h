@@ -0,0 +1,112 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvFramePacing.h
+ * @author gga
+ * @date   Sun Oct 18 18:02:14 2026
+ *
+ * @brief  Records when frames were due and shown during playback.
+ *
+ *
+ */
+
+#ifndef mrvFramePacing_h
+#define mrvFramePacing_h
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "core/mrvFrame.h"
+
+namespace mrv {
+
+//
+// The video thread of the foreground image records each frame it shows:
+// when it was due, when it was shown, the frame of the picture actually
+// found, and how long ago that picture was decoded.  When playback stops,
+// a summary is logged and, if asked for on the command line, the records
+// are appended to a CSV file.
+//
+class FramePacing
+{
+public:
+    typedef boost::mutex Mutex;
+
+    struct Record
+    {
+        boost::int64_t frame;    //!< frame asked for
+        boost::int64_t shown;    //!< frame of the picture shown
+        boost::int64_t target;   //!< when it was due, in microseconds
+        boost::int64_t present;  //!< when it was shown, in microseconds
+        boost::int64_t latency;  //!< from decode to display, -1 if none
+        unsigned       dropped;  //!< frames skipped before this one
+        bool           repeated; //!< same picture as previous frame
+    };
+
+    typedef std::vector< Record > RecordList;
+
+    // Latency histogram.  Bucket i holds latencies below 2^i ms, the last
+    // one the rest.
+    enum { kLatencyBuckets = 12 };
+
+public:
+    static FramePacing& instance();
+
+    // Append records to file each time playback stops.  Empty to stop.
+    void csv( const std::string& file );
+
+    // Start a new playback of media name.
+    void start( const std::string& name, const double fps );
+
+    // Frame was shown with picture pic at present, due at target.
+    void record( const boost::int64_t frame, const mrv::image_type_ptr& pic,
+                 const boost::int64_t target, const boost::int64_t present );
+
+    // Playback stopped.
+    void stop();
+
+    unsigned frames() const;
+    unsigned dropped() const;
+    unsigned repeated() const;
+    std::vector< unsigned > histogram() const;
+
+protected:
+    FramePacing();
+
+    void write_csv() const;
+    void log_summary() const;
+
+protected:
+    mutable Mutex  _mutex;
+    std::string    _csv;
+    std::string    _name;
+    double         _fps;
+    unsigned       _session;
+    bool           _active;
+    RecordList     _records;
+    unsigned       _dropped;
+    unsigned       _repeated;
+    unsigned       _histogram[kLatencyBuckets];
+};
+
+} // namespace mrv
+
+#endif // mrvFramePacing_h
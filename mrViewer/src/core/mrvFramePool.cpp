@@ -0,0 +1,201 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvFramePool.cpp
+ * @author gga
+ * @date   Sun Oct 18 11:05:17 2026
+ *
+ * @brief  Pool of recycled pixel buffers for video frames.
+ *
+ *
+ */
+
+#include <new>
+
+#include "core/mrvFramePool.h"
+
+namespace {
+
+// Buffers smaller than this (thumbnails, icons) go straight to malloc.
+const size_t kMinPooledSize = 64 * 1024;
+
+// Size classes are this many steps per power of two, so that any buffer
+// wastes at most 1/8th of its size.
+const unsigned kStepsPerDoubling = 8;
+
+}
+
+namespace mrv {
+
+FramePool& FramePool::instance()
+{
+    // Never destroyed, as frames may still be released at exit.
+    static FramePool* pool = new FramePool;
+    return *pool;
+}
+
+FramePool::FramePool() :
+    _bytes( 0 ),
+    _buffers( 0 ),
+    _max_bytes( 256 * 1024 * 1024 ),
+    _clock( 0 ),
+    _acquires( 0 ),
+    _reuses( 0 )
+{
+}
+
+FramePool::~FramePool()
+{
+    clear();
+}
+
+size_t FramePool::size_class( const size_t size )
+{
+    if ( size < kMinPooledSize ) return size;
+
+    size_t top = 1;
+    while ( top < size ) top <<= 1;
+
+    size_t step = top / ( 2 * kStepsPerDoubling );
+    return ( size + step - 1 ) / step * step;
+}
+
+void FramePool::Releaser::operator()( mrv::aligned16_uint8_t* p ) const
+{
+    FramePool::instance().release( p, size );
+}
+
+FramePool::PixelData FramePool::acquire( const size_t size )
+{
+    ++_acquires;
+
+    const size_t bytes = size_class( size );
+    if ( bytes >= kMinPooledSize )
+    {
+        Mutex::scoped_lock lk( _mutex );
+        ++_clock;
+        BinMap::iterator i = _bins.find( bytes );
+        if ( i != _bins.end() && !i->second.buffers.empty() )
+        {
+            Bin& bin = i->second;
+            void* ptr = bin.buffers.back();
+            bin.buffers.pop_back();
+            bin.last_use = _clock;
+            _bytes -= bytes;
+            --_buffers;
+            ++_reuses;
+            Releaser r = { bytes };
+            return PixelData( (mrv::aligned16_uint8_t*) ptr, r );
+        }
+    }
+
+    void* ptr = av_malloc( bytes );
+    if ( !ptr ) throw std::bad_alloc();
+    Releaser r = { bytes };
+    return PixelData( (mrv::aligned16_uint8_t*) ptr, r );
+}
+
+/**
+ * Free idle buffers of the least recently used size classes, until
+ * needed bytes fit in the pool.  Called with _mutex locked.
+ *
+ * @param needed bytes that need to fit
+ * @param keep   size class not to free
+ */
+void FramePool::trim( const size_t needed, const size_t keep )
+{
+    while ( _bytes + needed > _max_bytes )
+    {
+        BinMap::iterator oldest = _bins.end();
+        BinMap::iterator i = _bins.begin();
+        for ( ; i != _bins.end(); ++i )
+        {
+            if ( i->first == keep || i->second.buffers.empty() ) continue;
+            if ( oldest == _bins.end() ||
+                 i->second.last_use < oldest->second.last_use )
+                oldest = i;
+        }
+        if ( oldest == _bins.end() ) return;
+
+        std::vector< void* >& buffers = oldest->second.buffers;
+        av_free( buffers.back() );
+        buffers.pop_back();
+        _bytes -= oldest->first;
+        --_buffers;
+    }
+}
+
+void FramePool::release( void* ptr, const size_t size )
+{
+    if ( size < kMinPooledSize )
+    {
+        av_free( ptr );
+        return;
+    }
+
+    Mutex::scoped_lock lk( _mutex );
+
+    trim( size, size );
+    if ( _bytes + size > _max_bytes )
+    {
+        av_free( ptr );
+        return;
+    }
+
+    Bin& bin = _bins[size];
+    bin.buffers.push_back( ptr );
+    bin.last_use = _clock;
+    _bytes += size;
+    ++_buffers;
+}
+
+void FramePool::max_bytes( const size_t x )
+{
+    Mutex::scoped_lock lk( _mutex );
+    _max_bytes = x;
+    trim( 0, 0 );
+}
+
+void FramePool::clear()
+{
+    Mutex::scoped_lock lk( _mutex );
+
+    BinMap::iterator i = _bins.begin();
+    for ( ; i != _bins.end(); ++i )
+    {
+        std::vector< void* >& buffers = i->second.buffers;
+        for ( size_t j = 0; j < buffers.size(); ++j )
+            av_free( buffers[j] );
+    }
+    _bins.clear();
+    _bytes = _buffers = 0;
+}
+
+FramePool::Stats FramePool::stats() const
+{
+    Mutex::scoped_lock lk( _mutex );
+
+    Stats s;
+    s.acquires = _acquires;
+    s.reuses   = _reuses;
+    s.bytes    = _bytes;
+    s.buffers  = _buffers;
+    return s;
+}
+
+} // namespace mrv
@@ -0,0 +1,115 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvFramePool.h
+ * @author gga
+ * @date   Sun Oct 18 11:05:17 2026
+ *
+ * @brief  Pool of recycled pixel buffers for video frames.
+ *
+ *
+ */
+
+#ifndef mrvFramePool_h
+#define mrvFramePool_h
+
+#include <atomic>
+#include <map>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_array.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "core/mrvAlignedData.h"
+
+namespace mrv {
+
+//
+// Decoding a movie allocates and frees a frame's worth of pixels for every
+// frame.  The pool keeps released buffers binned by size class and hands
+// them back out, so at a steady resolution no memory is allocated at all.
+//
+class FramePool
+{
+public:
+    typedef boost::mutex Mutex;
+    typedef boost::shared_array< mrv::aligned16_uint8_t > PixelData;
+
+    struct Stats
+    {
+        boost::uint64_t acquires;  //!< buffers requested
+        boost::uint64_t reuses;    //!< buffers served from the pool
+        boost::uint64_t bytes;     //!< bytes held idle in the pool
+        boost::uint64_t buffers;   //!< buffers held idle in the pool
+    };
+
+public:
+    static FramePool& instance();
+
+    // Get a buffer of at least size bytes.  It returns to the pool when
+    // the last PixelData referencing it is released.
+    PixelData acquire( const size_t size );
+
+    // Most bytes the pool may hold idle.
+    void max_bytes( const size_t x );
+    inline size_t max_bytes() const { return _max_bytes; }
+
+    // Free all idle buffers.
+    void clear();
+
+    Stats stats() const;
+
+protected:
+    FramePool();
+    ~FramePool();
+
+    struct Bin
+    {
+        std::vector< void* > buffers;
+        boost::uint64_t      last_use;
+    };
+
+    struct Releaser
+    {
+        size_t size;
+        void operator()( mrv::aligned16_uint8_t* p ) const;
+    };
+
+    static size_t size_class( const size_t size );
+
+    void release( void* ptr, const size_t size );
+    void trim( const size_t needed, const size_t keep );
+
+protected:
+    typedef std::map< size_t, Bin > BinMap;
+
+    mutable Mutex   _mutex;
+    BinMap          _bins;
+    size_t          _bytes;       //!< idle bytes held
+    size_t          _buffers;     //!< idle buffers held
+    size_t          _max_bytes;
+    boost::uint64_t _clock;       //!< bumped on every acquire
+
+    std::atomic<boost::uint64_t> _acquires;
+    std::atomic<boost::uint64_t> _reuses;
+};
+
+} // namespace mrv
+
+#endif // mrvFramePool_h
@@ -0,0 +1,221 @@
+/**
+ * @file   mrvFrame_rows.inl
+ * @author gga
+ * @date   Sun Oct 18 09:12:40 2026
+ *
+ * @brief  Row operations specialized on pixel type and channel layout.
+ *
+ *
+ */
+
+namespace {
+
+using mrv::ImagePixel;
+using mrv::VideoFrame;
+
+//
+// Conversion of a channel to and from the floats of an ImagePixel, and
+// alpha of images without one.  These must match pixel_u8(), pixel_u16(),
+// etc.
+//
+template< typename T > struct Channel;
+
+template<> struct Channel< boost::uint8_t >
+{
+    static inline float alpha() { return 1.0f; }
+    static inline float to_float( const boost::uint8_t v ) {
+        return v / 255.0f;
+    }
+    static inline boost::uint8_t from_float( const float v ) {
+        return boost::uint8_t( v * 255.0f );
+    }
+};
+
+template<> struct Channel< boost::uint16_t >
+{
+    static inline float alpha() { return 0.0f; }
+    static inline float to_float( const boost::uint16_t v ) {
+        return v / 65535.0f;
+    }
+    static inline boost::uint16_t from_float( const float v ) {
+        return boost::uint16_t( v * 65535.0f );
+    }
+};
+
+template<> struct Channel< boost::uint32_t >
+{
+    static inline float alpha() { return 0.0f; }
+    static inline float to_float( const boost::uint32_t v ) {
+        return float(v) / (float) limit;
+    }
+    static inline boost::uint32_t from_float( const float v ) {
+        return boost::uint32_t( v * limit );
+    }
+};
+
+template<> struct Channel< half >
+{
+    static inline float alpha() { return 0.0f; }
+    static inline float to_float( const half v ) { return v; }
+    static inline half from_float( const float v ) { return v; }
+};
+
+template<> struct Channel< float >
+{
+    static inline float alpha() { return 0.0f; }
+    static inline float to_float( const float v ) { return v; }
+    static inline float from_float( const float v ) { return v; }
+};
+
+//
+// Interleaved lumma (C = 1), RGB/BGR (C = 3) and RGBA/BGRA (C = 4) rows.
+//
+template< typename T, unsigned short C, bool BGR >
+struct PackedRow
+{
+    typedef Channel< T > Ch;
+
+    static void read( const VideoFrame* pic, const unsigned y,
+                      const unsigned x, const unsigned n,
+                      const unsigned step, ImagePixel* out )
+    {
+        const T* col = (const T*) pic->data().get() +
+                       ( size_t(y) * pic->width() + x ) * C;
+        const size_t stride = size_t(step) * C;
+
+        for ( unsigned i = 0; i < n; ++i, col += stride )
+        {
+            ImagePixel& p = out[i];
+            if ( C == 1 )
+            {
+                p.r = p.g = p.b = Ch::to_float( col[0] );
+                p.a = Ch::alpha();
+                continue;
+            }
+
+            p.r = Ch::to_float( col[ BGR ? 2 : 0 ] );
+            p.g = Ch::to_float( col[1] );
+            p.b = Ch::to_float( col[ BGR ? 0 : 2 ] );
+            p.a = C == 4 ? Ch::to_float( col[3] ) : Ch::alpha();
+        }
+    }
+
+    static void write( VideoFrame* pic, const unsigned y,
+                       const unsigned x, const unsigned n,
+                       const unsigned step, const ImagePixel* in )
+    {
+        T* col = (T*) pic->data().get() + ( size_t(y) * pic->width() + x ) * C;
+        const size_t stride = size_t(step) * C;
+
+        for ( unsigned i = 0; i < n; ++i, col += stride )
+        {
+            const ImagePixel& p = in[i];
+            if ( C == 1 )
+            {
+                col[0] = Ch::from_float( p.r );
+                continue;
+            }
+
+            col[ BGR ? 2 : 0 ] = Ch::from_float( p.r );
+            col[1]             = Ch::from_float( p.g );
+            col[ BGR ? 0 : 2 ] = Ch::from_float( p.b );
+            if ( C == 4 ) col[3] = Ch::from_float( p.a );
+        }
+    }
+};
+
+//
+// Planar and YUV formats go through pixel() for each pixel.
+//
+struct GenericRow
+{
+    static void read( const VideoFrame* pic, const unsigned y,
+                      const unsigned x, const unsigned n,
+                      const unsigned step, ImagePixel* out )
+    {
+        for ( unsigned i = 0; i < n; ++i )
+            out[i] = pic->pixel( x + i * step, y );
+    }
+
+    static void write( VideoFrame* pic, const unsigned y,
+                       const unsigned x, const unsigned n,
+                       const unsigned step, const ImagePixel* in )
+    {
+        for ( unsigned i = 0; i < n; ++i )
+            pic->pixel( x + i * step, y, in[i] );
+    }
+};
+
+template< typename T >
+bool packed_row( const VideoFrame* pic,
+                 mrv::RowReader::ReadFunc& rd, mrv::RowWriter::WriteFunc& wr )
+{
+    const unsigned short c = pic->channels();
+    switch( pic->format() )
+    {
+    case VideoFrame::kLumma:
+        if ( c != 1 ) return false;
+        rd = &PackedRow< T, 1, false >::read;
+        wr = &PackedRow< T, 1, false >::write;
+        return true;
+    case VideoFrame::kRGB:
+        if ( c != 3 ) return false;
+        rd = &PackedRow< T, 3, false >::read;
+        wr = &PackedRow< T, 3, false >::write;
+        return true;
+    case VideoFrame::kBGR:
+        if ( c != 3 ) return false;
+        rd = &PackedRow< T, 3, true >::read;
+        wr = &PackedRow< T, 3, true >::write;
+        return true;
+    case VideoFrame::kRGBA:
+        if ( c != 4 ) return false;
+        rd = &PackedRow< T, 4, false >::read;
+        wr = &PackedRow< T, 4, false >::write;
+        return true;
+    case VideoFrame::kBGRA:
+        if ( c != 4 ) return false;
+        rd = &PackedRow< T, 4, true >::read;
+        wr = &PackedRow< T, 4, true >::write;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Pick the row functions for the pixel type and layout of a picture.
+ *
+ * @param pic picture to read or write
+ * @param rd  row reader function returned
+ * @param wr  row writer function returned
+ *
+ * @return true if specialized functions were found, false if the
+ *         generic ones, which call pixel(), were returned
+ */
+bool select_row( const VideoFrame* pic,
+                 mrv::RowReader::ReadFunc& rd, mrv::RowWriter::WriteFunc& wr )
+{
+    rd = &GenericRow::read;
+    wr = &GenericRow::write;
+
+    if ( !pic->data() ) return false;
+
+    switch( pic->pixel_type() )
+    {
+    case VideoFrame::kByte:
+        return packed_row< boost::uint8_t >( pic, rd, wr );
+    case VideoFrame::kShort:
+        return packed_row< boost::uint16_t >( pic, rd, wr );
+    case VideoFrame::kInt:
+        return packed_row< boost::uint32_t >( pic, rd, wr );
+    case VideoFrame::kHalf:
+        return packed_row< half >( pic, rd, wr );
+    case VideoFrame::kFloat:
+        return packed_row< float >( pic, rd, wr );
+    default:
+        return false;
+    }
+}
+
+}  // namespace
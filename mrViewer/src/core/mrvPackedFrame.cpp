@@ -0,0 +1,221 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvPackedFrame.cpp
+ * @author gga
+ * @date   Sun Oct 18 23:10:52 2026
+ *
+ * @brief  Video frames kept losslessly compressed in memory.
+ *
+ *
+ */
+
+#include <zlib.h>
+
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/bind.hpp>
+
+#include "core/CMedia.h"
+#include "core/mrvScheduler.h"
+#include "core/mrvPackedFrame.h"
+
+namespace {
+
+// Rows compressed together.  Each block is compressed on its own.
+const unsigned kRowsPerBlock = 16;
+
+// Frames that do not pack to less than this part of their size are kept
+// as they are.
+const double kMaxRatio = 0.85;
+
+}
+
+namespace mrv {
+
+PackedFrame::PackedFrame( const VideoFrame& pic ) :
+    _frame( pic.frame() ),
+    _pts( pic.pts() ),
+    _repeat( pic.repeat() ),
+    _width( pic.width() ),
+    _height( pic.height() ),
+    _channels( pic.channels() ),
+    _format( pic.format() ),
+    _type( pic.pixel_type() ),
+    _valid( pic.valid() ),
+    _ctime( pic.ctime() ),
+    _mtime( pic.mtime() ),
+    _region( pic.region() ),
+    _size( pic.pixel_size() ),
+    _blocks( ( pic.height() + kRowsPerBlock - 1 ) / kRowsPerBlock ),
+    _bytes( 0 )
+{
+}
+
+PackedFrame::~PackedFrame()
+{
+    CMedia::memory_used -= _bytes;
+    if ( CMedia::memory_used < 0 ) CMedia::memory_used = 0;
+}
+
+PackedFrame* PackedFrame::pack( const VideoFrame& pic )
+{
+    if ( !pic.data() || pic.width() == 0 || pic.height() == 0 )
+        return NULL;
+
+    switch( pic.format() )
+    {
+    case VideoFrame::kLumma:
+    case VideoFrame::kLummaA:
+    case VideoFrame::kRGB:
+    case VideoFrame::kRGBA:
+    case VideoFrame::kBGR:
+    case VideoFrame::kBGRA:
+        break;
+    default:
+        return NULL;
+    }
+
+    PackedFrame* p = new PackedFrame( pic );
+
+    Scheduler::instance().parallel_for( p->blocks(),
+                                        boost::bind( &PackedFrame::pack_block,
+                                                     p, &pic, _1 ),
+                                        "pack" );
+
+    size_t bytes = 0;
+    for ( unsigned i = 0; i < p->blocks(); ++i )
+    {
+        if ( p->_blocks[i].empty() )
+        {
+            delete p;
+            return NULL;
+        }
+        bytes += p->_blocks[i].size();
+    }
+
+    if ( double(bytes) > double( pic.data_size() ) * kMaxRatio )
+    {
+        delete p;
+        return NULL;
+    }
+
+    p->_bytes = bytes;
+    CMedia::memory_used += bytes;
+    return p;
+}
+
+/**
+ * Compress a block of rows of pic.  Byte k of channel c of each pixel
+ * goes to plane k * channels + c, as the difference to the same byte of
+ * the previous pixel.
+ */
+void PackedFrame::pack_block( const VideoFrame* pic, const unsigned block )
+{
+    const unsigned y = block * kRowsPerBlock;
+    unsigned rows = kRowsPerBlock;
+    if ( y + rows > _height ) rows = _height - y;
+
+    const size_t pixels = size_t(rows) * _width;
+    const size_t stride = size_t(_channels) * _size;
+    const boost::uint8_t* src = (const boost::uint8_t*) pic->data().get() +
+                                size_t(y) * _width * stride;
+
+    std::vector< boost::uint8_t > tmp( pixels * stride );
+    boost::uint8_t* d = &tmp[0];
+    for ( unsigned k = 0; k < _size; ++k )
+    {
+        for ( unsigned c = 0; c < _channels; ++c )
+        {
+            const boost::uint8_t* s = src + c * _size + k;
+            boost::uint8_t prev = 0;
+            for ( size_t i = 0; i < pixels; ++i, s += stride )
+            {
+                *d++ = boost::uint8_t( *s - prev );
+                prev = *s;
+            }
+        }
+    }
+
+    Block& b = _blocks[block];
+    uLongf len = compressBound( uLong( tmp.size() ) );
+    b.resize( len );
+    if ( compress2( &b[0], &len, &tmp[0], uLong( tmp.size() ),
+                    Z_BEST_SPEED ) != Z_OK )
+    {
+        Block().swap( b );
+        return;
+    }
+
+    Block( b.begin(), b.begin() + len ).swap( b );
+}
+
+void PackedFrame::unpack_block( VideoFrame* pic, const unsigned block ) const
+{
+    const unsigned y = block * kRowsPerBlock;
+    unsigned rows = kRowsPerBlock;
+    if ( y + rows > _height ) rows = _height - y;
+
+    const size_t pixels = size_t(rows) * _width;
+    const size_t stride = size_t(_channels) * _size;
+    boost::uint8_t* dst = (boost::uint8_t*) pic->data().get() +
+                          size_t(y) * _width * stride;
+
+    std::vector< boost::uint8_t > tmp( pixels * stride );
+    const Block& b = _blocks[block];
+    uLongf len = uLongf( tmp.size() );
+    if ( uncompress( &tmp[0], &len, &b[0], uLong( b.size() ) ) != Z_OK ||
+         len != tmp.size() )
+    {
+        memset( dst, 0, tmp.size() );
+        return;
+    }
+
+    const boost::uint8_t* s = &tmp[0];
+    for ( unsigned k = 0; k < _size; ++k )
+    {
+        for ( unsigned c = 0; c < _channels; ++c )
+        {
+            boost::uint8_t* d = dst + c * _size + k;
+            boost::uint8_t prev = 0;
+            for ( size_t i = 0; i < pixels; ++i, d += stride )
+            {
+                prev = boost::uint8_t( prev + *s++ );
+                *d = prev;
+            }
+        }
+    }
+}
+
+image_type_ptr PackedFrame::unpack() const
+{
+    image_type_ptr pic( new VideoFrame( _frame, _width, _height, _channels,
+                                        _format, _type, _repeat, _pts,
+                                        _valid ) );
+    pic->ctime( _ctime );
+    pic->mtime( _mtime );
+    pic->region( _region );
+    pic->shown();
+
+    Scheduler::instance().parallel_for( blocks(),
+                                        boost::bind( &PackedFrame::unpack_block,
+                                                     this, pic.get(), _1 ),
+                                        "unpack" );
+    return pic;
+}
+
+} // namespace mrv
@@ -0,0 +1,112 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvPackedFrame.h
+ * @author gga
+ * @date   Sun Oct 18 23:10:52 2026
+ *
+ * @brief  Video frames kept losslessly compressed in memory.
+ *
+ *
+ */
+
+#ifndef mrvPackedFrame_h
+#define mrvPackedFrame_h
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "core/mrvFrame.h"
+#include "core/mrvRectangle.h"
+
+namespace mrv {
+
+//
+// The pixels of a cached frame, compressed with zlib in independent
+// blocks of rows, so blocks are packed and unpacked in parallel.  Before
+// compressing, the bytes of each channel are split into planes and
+// stored as differences to the previous pixel, which makes the smooth
+// areas of half and float plates compress to about half.
+//
+// Only interleaved lumma and RGB(A) pictures are packed.
+//
+class PackedFrame
+{
+public:
+    // Compress pic.  Returns NULL if its layout is not packed or it would
+    // not save enough memory.
+    static PackedFrame* pack( const VideoFrame& pic );
+
+    ~PackedFrame();
+
+    // A new frame with the pixels and attributes of the packed one.
+    image_type_ptr unpack() const;
+
+    inline boost::int64_t frame() const { return _frame; }
+    inline bool valid() const { return _valid; }
+    inline time_t ctime() const { return _ctime; }
+    inline time_t mtime() const { return _mtime; }
+
+    // True if the decoded part holds all of r (empty meaning all).
+    inline bool has_region( const mrv::Recti& r ) const
+    {
+        if ( _region.empty() ) return true;
+        if ( r.empty() ) return false;
+        return ( r.x() >= _region.x() && r.y() >= _region.y() &&
+                 r.r() <= _region.r() && r.b() <= _region.b() );
+    }
+
+    // Memory used by the compressed pixels.
+    inline size_t data_size() const { return _bytes; }
+
+protected:
+    PackedFrame( const VideoFrame& pic );
+
+    void pack_block( const VideoFrame* pic, const unsigned block );
+    void unpack_block( VideoFrame* pic, const unsigned block ) const;
+
+    inline unsigned blocks() const { return unsigned( _blocks.size() ); }
+
+protected:
+    typedef std::vector< boost::uint8_t > Block;
+
+    boost::int64_t         _frame;
+    boost::int64_t         _pts;
+    boost::int64_t         _repeat;
+    unsigned               _width;
+    unsigned               _height;
+    unsigned short         _channels;
+    VideoFrame::Format     _format;
+    VideoFrame::PixelType  _type;
+    bool                   _valid;
+    time_t                 _ctime;
+    time_t                 _mtime;
+    mrv::Recti             _region;
+
+    unsigned short         _size;    //!< bytes of a channel
+    std::vector< Block >   _blocks;  //!< empty if zlib failed
+    size_t                 _bytes;
+};
+
+typedef boost::shared_ptr< PackedFrame > PackedFrame_ptr;
+
+} // namespace mrv
+
+#endif // mrvPackedFrame_h
@@ -28,6 +28,7 @@
 #ifndef mrvPacketQueue_h
 #define mrvPacketQueue_h
 
+#include <atomic>
 #include <cassert>
 #include <iostream>
 #include <deque>
@@ -51,6 +52,16 @@ namespace mrv {
 
 class CMedia;
 
+//
+// Packets read by the decode thread for the video, audio or subtitle
+// threads.  Seeks, flushes and loops travel as marker packets.
+//
+// The queue is not single producer, single consumer: seeks and stops
+// clear it from other threads, and playing backwards erases packets
+// from the middle.  So changes are still locked, but the size, the
+// bytes and the kind of packet in front are kept in atomics, so the
+// checks every thread polls do not take the lock.
+//
 class PacketQueue
 {
 private:
@@ -65,11 +76,25 @@ public:
     typedef boost::recursive_mutex    Mutex;
     typedef boost::condition_variable_any Condition;
 
+    // Kind of packet in front of the queue.
+    enum Marker
+    {
+        kEmpty,
+        kPacket,
+        kFlush,
+        kSeek,
+        kSeekEnd,
+        kJump,
+        kPreroll,
+        kLoopStart,
+        kLoopEnd
+    };
+
     static const char* kModule;
 
     static bool inited;
 
-    inline PacketQueue() : _bytes(0)
+    inline PacketQueue() : _bytes(0), _size(0), _front(kEmpty)
     {
     }
 
@@ -90,7 +115,6 @@ public:
 
     inline uint64_t bytes()
     {
-        Mutex::scoped_lock lk( _mutex );
         return _bytes;
     }
 
@@ -130,6 +154,7 @@ public:
 
         assert0( _bytes == 0 );
         _bytes = 0;
+        changed();
     }
 
     inline iterator end()
@@ -168,15 +193,7 @@ public:
         _packets.push_back( pkt );
 
 
-        if ( pkt.data != _flush->data &&
-             pkt.data != _seek->data  &&
-             pkt.data != _seek_end->data  &&
-             pkt.data != _jump->data &&
-             pkt.data != _preroll->data &&
-             pkt.data != _loop_start->data &&
-             pkt.data != _loop_end->data &&
-             pkt.data != NULL &&
-             pkt.size != 0 )
+        if ( counted( pkt ) )
         {
             // std::cerr << this << " #" << _packets.size()
             //          << " push back " << &pkt << " at "
@@ -206,20 +223,19 @@ public:
                   << std::endl;
 #endif
 
+        changed();
         _cond.notify_one();
 
     }
 
     inline size_t size()
     {
-        Mutex::scoped_lock lk( _mutex );
-        return _packets.size();
+        return _size;
     }
 
     inline bool empty()
     {
-        Mutex::scoped_lock lk( _mutex );
-        return _packets.empty();
+        return _size == 0;
     }
 
     inline const AVPacket& front() const
@@ -259,15 +275,7 @@ public:
 
         AVPacket& pkt = *it;
 
-        if ( pkt.data != _flush->data &&
-             pkt.data != _seek->data  &&
-             pkt.data != _seek_end->data  &&
-             pkt.data != _jump->data &&
-             pkt.data != _preroll->data &&
-             pkt.data != _loop_start->data &&
-             pkt.data != _loop_end->data &&
-             pkt.data != NULL &&
-             pkt.size !=0 )
+        if ( counted( pkt ) )
         {
             // std::cerr << this << " #" << _packets.size()
             //          << " erase " << &pkt << std::endl;
@@ -289,7 +297,9 @@ public:
             av_packet_unref( &pkt );
         }
 
-        return _packets.erase( it );
+        iterator r = _packets.erase( it );
+        changed();
+        return r;
     }
 
     inline void pop_front()
@@ -301,15 +311,7 @@ public:
 
         AVPacket& pkt = _packets.front();
 
-        if ( pkt.data != _flush->data &&
-             pkt.data != _seek->data  &&
-             pkt.data != _seek_end->data  &&
-             pkt.data != _jump->data &&
-             pkt.data != _preroll->data &&
-             pkt.data != _loop_start->data &&
-             pkt.data != _loop_end->data &&
-             pkt.data != NULL &&
-             pkt.size != 0 )
+        if ( counted( pkt ) )
         {
 #ifdef DEBUG_PACKET_QUEUE
             std::cerr << "POP FRONT " << std::dec << pkt.stream_index
@@ -346,6 +348,7 @@ public:
         }
 
         _packets.pop_front();
+        changed();
     }
 
 
@@ -365,90 +368,62 @@ public:
 
     bool is_flush()
     {
-        Mutex::scoped_lock lk( _mutex );
-        if ( _packets.empty() ) return false;
-        if ( _packets.front().data == _flush->data ) return true;
-        return false;
+        return _front == kFlush;
     }
 
     bool is_flush(const AVPacket& pkt) const
     {
-        Mutex& m = const_cast< Mutex& >( _mutex );
-        Mutex::scoped_lock lk( m );
         if ( pkt.data == _flush->data ) return true;
         return false;
     }
 
     bool is_seek()
     {
-        Mutex::scoped_lock lk( _mutex );
-        if ( _packets.empty() ) return false;
-        if ( _packets.front().data == _seek->data ) return true;
-        return false;
+        return _front == kSeek;
     }
 
     bool is_jump()
     {
-        Mutex::scoped_lock lk( _mutex );
-        if ( _packets.empty() ) return false;
-        if ( _packets.front().data == _jump->data ) return true;
-        return false;
+        return _front == kJump;
     }
 
     bool is_preroll()
     {
-        Mutex::scoped_lock lk( _mutex );
-        if ( _packets.empty() ) return false;
-        if ( _packets.front().data == _preroll->data ) return true;
-        return false;
+        return _front == kPreroll;
     }
 
     bool is_seek_end()
     {
-        Mutex::scoped_lock lk( _mutex );
-        if ( _packets.empty() ) return false;
-        if ( _packets.front().data == _seek_end->data ) return true;
-        return false;
+        return _front == kSeekEnd;
     }
 
     bool is_seek(const AVPacket& pkt) const
     {
-        Mutex& m = const_cast< Mutex& >( _mutex );
-        Mutex::scoped_lock lk( m );
         if ( pkt.data == _seek->data ) return true;
         return false;
     }
 
     bool is_jump(const AVPacket& pkt) const
     {
-        Mutex& m = const_cast< Mutex& >( _mutex );
-        Mutex::scoped_lock lk( m );
         if ( pkt.data == _jump->data ) return true;
         return false;
     }
 
     bool is_preroll(const AVPacket& pkt) const
     {
-        Mutex& m = const_cast< Mutex& >( _mutex );
-        Mutex::scoped_lock lk( m );
         if ( pkt.data == _preroll->data ) return true;
         return false;
     }
 
     bool is_seek_end(const AVPacket& pkt) const
     {
-        Mutex& m = const_cast< Mutex& >( _mutex );
-        Mutex::scoped_lock lk( m );
         if ( pkt.data == _seek_end->data ) return true;
         return false;
     }
 
     bool is_loop_start()
     {
-        Mutex::scoped_lock lk( _mutex );
-        if ( _packets.empty() ) return false;
-        if ( _packets.front().data == _loop_start->data ) return true;
-        return false;
+        return _front == kLoopStart;
     }
 
     bool is_loop_start(const AVPacket& pkt) const
@@ -460,10 +435,7 @@ public:
 
     bool is_loop_end()
     {
-        Mutex::scoped_lock lk( _mutex );
-        if ( _packets.empty() ) return false;
-        if ( _packets.front().data == _loop_end->data ) return true;
-        return false;
+        return _front == kLoopEnd;
     }
 
     bool is_loop_end(const AVPacket& pkt) const
@@ -478,6 +450,7 @@ public:
         _packets.push_back( *_flush );
         AVPacket& pkt = _packets.back();
         pkt.dts = pkt.pts = pts;
+        changed();
         _cond.notify_one();
     }
 
@@ -487,6 +460,7 @@ public:
         _packets.push_back( *_jump );
         AVPacket& pkt = _packets.back();
         pkt.dts = pkt.pts = pts;
+        changed();
         _cond.notify_one();
     }
 
@@ -497,6 +471,7 @@ public:
         _packets.push_back( *_preroll );
         AVPacket& pkt = _packets.back();
         pkt.dts = pkt.pts = pts;
+        changed();
         _cond.notify_one();
     }
 
@@ -506,6 +481,7 @@ public:
         _packets.push_back( *_loop_start );
         AVPacket& pkt = _packets.back();
         pkt.dts = pkt.pts = frame;
+        changed();
         _cond.notify_one();
     }
 
@@ -515,6 +491,7 @@ public:
         push_back( *_loop_end );
         AVPacket& pkt = _packets.back();
         pkt.dts = pkt.pts = frame;
+        changed();
         _cond.notify_one();
     }
 
@@ -525,6 +502,7 @@ public:
         _packets.push_back( *_seek );
         AVPacket& pkt = _packets.back();
         pkt.dts = pkt.pts = pts;
+        changed();
         _cond.notify_one();
     }
 
@@ -534,6 +512,7 @@ public:
         _packets.push_back( *_seek_end );
         AVPacket& pkt = _packets.back();
         pkt.dts = pkt.pts = pts;
+        changed();
         _cond.notify_one();
     }
 
@@ -586,7 +565,35 @@ public:
 
 
 protected:
-    uint64_t      _bytes;
+    static Marker marker( const AVPacket& pkt )
+    {
+        if ( pkt.data == _flush->data )      return kFlush;
+        if ( pkt.data == _seek->data )       return kSeek;
+        if ( pkt.data == _seek_end->data )   return kSeekEnd;
+        if ( pkt.data == _jump->data )       return kJump;
+        if ( pkt.data == _preroll->data )    return kPreroll;
+        if ( pkt.data == _loop_start->data ) return kLoopStart;
+        if ( pkt.data == _loop_end->data )   return kLoopEnd;
+        return kPacket;
+    }
+
+    // Whether pkt's size is counted in _bytes.
+    static bool counted( const AVPacket& pkt )
+    {
+        return marker( pkt ) == kPacket && pkt.data != NULL && pkt.size != 0;
+    }
+
+    // Update the atomics after a change.  Called with _mutex locked.
+    inline void changed()
+    {
+        _size = _packets.size();
+        _front = _packets.empty() ? kEmpty : marker( _packets.front() );
+    }
+
+protected:
+    std::atomic<uint64_t> _bytes;
+    std::atomic<size_t>   _size;
+    std::atomic<int>      _front;   //!< Marker of packet in front
     Packets_t    _packets;
     mutable Mutex  _mutex;
     Condition       _cond;
@@ -27,6 +27,11 @@
  *
  */
 
+#ifndef __STDC_FORMAT_MACROS
+#  define __STDC_FORMAT_MACROS
+#endif
+
+#include <inttypes.h>  // for PRId64
 #include <cstdio>
 
 #include <iostream>
@@ -54,6 +59,8 @@ extern "C" {
 #include "core/aviImage.h"
 #include "core/mrvMath.h"
 #include "core/mrvTimer.h"
+#include "core/mrvFramePacing.h"
+#include "core/mrvSeatSync.h"
 #include "core/mrvThread.h"
 #include "core/mrvBarrier.h"
 
@@ -73,6 +80,9 @@ extern "C" {
 namespace
 {
 const char* kModule = "play";
+
+// How often the seat leading playback tells others where it is.
+const boost::int64_t kPlayheadInterval = 1000000;  // microseconds
 }
 
 /* no AV sync correction is done if below the minimum AV sync threshold */
@@ -1133,6 +1143,15 @@ void video_thread( PlaybackData* data )
     double fps = img->play_fps();
     timer.setDesiredFrameRate( fps );
 
+    // Only the picture the viewer shows is worth recording.
+    FramePacing& pacing = FramePacing::instance();
+    const bool record = ( fg && img->is_left_eye() );
+    if ( record ) pacing.start( img->name(), fps );
+
+    // Seats of a sync session follow the one playback was started on.
+    SeatSync& seats = SeatSync::instance();
+    boost::int64_t next_playhead = 0;
+
     while ( !img->stopped() && view->playback() != CMedia::kStopped )
     {
         TRACE( img->name() );
@@ -1300,6 +1319,17 @@ void video_thread( PlaybackData* data )
         else
         {
             diff = 0.0;
+
+            // Without audio to follow, follow the leading seat, if any.
+            double ahead;
+            if ( record && !view->seat_master() &&
+                 seats.skew( reel->edl ?
+                             reel->local_to_global( frame, img ) : frame,
+                             mrv::Timer::now(), ahead ) )
+            {
+                diff = step * ahead;
+                absdiff = std::abs( diff );
+            }
         }
 
 #if __cplusplus >= 201103L
@@ -1345,6 +1375,17 @@ void video_thread( PlaybackData* data )
 
         img->find_image( frame );
 
+        if ( record )
+        {
+            mrv::image_type_ptr pic;
+            {
+                Mutex& mtx = img->video_mutex();
+                SCOPED_LOCK( mtx );
+                pic = img->left();
+            }
+            pacing.record( frame, pic, timer.targetTime(), mrv::Timer::now() );
+        }
+
 
         if ( fg && img->is_left_eye() )
         {
@@ -1360,6 +1401,17 @@ void video_thread( PlaybackData* data )
                        << " FROM IMAGE " << img->name() );
                 view->frame( f );
 
+                // Let the other seats know when we showed which frame.
+                const boost::int64_t now = mrv::Timer::now();
+                if ( view->seat_master() && now >= next_playhead )
+                {
+                    char buf[128];
+                    sprintf( buf, N_("playhead %" PRId64 " %" PRId64),
+                             now, f );
+                    view->send_network( buf );
+                    next_playhead = now + kPlayheadInterval;
+                }
+
                 if ( reel->edl )
                 {
                     CMedia* Aimg = view->A_image();
@@ -1430,6 +1482,8 @@ void video_thread( PlaybackData* data )
         frame += step;
     }
 
+    if ( record ) pacing.stop();
+
     img->playback( CMedia::kStopped );
 
     Mutex& mtx = img->video_mutex();
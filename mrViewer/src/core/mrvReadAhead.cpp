@@ -0,0 +1,366 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvReadAhead.cpp
+ * @author gga
+ * @date   Sat Oct 17 18:40:05 2026
+ *
+ * @brief  Loads image sequence frames ahead of the playhead.
+ *
+ *
+ */
+
+#include <cmath>
+#include <string>
+
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/bind.hpp>
+
+#include "core/CMedia.h"
+#include "core/mrvFrameCache.h"
+#include "core/mrvReadAhead.h"
+#include "core/mrvScheduler.h"
+#include "core/mrvI8N.h"
+#include "core/mrvThread.h"
+#include "gui/mrvIO.h"
+#include "gui/mrvPreferences.h"
+
+namespace {
+const char* kModule = "load";
+}
+
+namespace mrv {
+
+ReadAhead& ReadAhead::instance()
+{
+    static ReadAhead pool;
+    return pool;
+}
+
+ReadAhead::ReadAhead() :
+    _max( 0 ),
+    _running( 0 ),
+    _img( NULL ),
+    _frame( 0 ),
+    _first( 0 ),
+    _last( 0 ),
+    _dir( 0 ),
+    _step( 0 ),
+    _frame_bytes( 0 )
+{
+    // Readers erase themselves from the frame cache when deleted, so
+    // make sure the cache is destroyed after us.
+    FrameCache::instance();
+}
+
+ReadAhead::~ReadAhead()
+{
+    // Readers are not deleted here, as their destructor calls forget()
+    // on us.  We only get destroyed at exit.
+    SCOPED_LOCK( _mutex );
+    _img = NULL;
+    while ( _running > 0 )
+        CONDITION_WAIT( _idle, _mutex );
+}
+
+bool ReadAhead::supports( const CMedia* img )
+{
+    if ( !img || !CMedia::cache_active() ) return false;
+    if ( !img->is_sequence() || img->has_video() ) return false;
+    if ( img->is_stereo() || img->internal() ) return false;
+    return true;
+}
+
+void ReadAhead::threads( unsigned n )
+{
+    if ( n == 0 )
+    {
+        n = Scheduler::instance().threads();
+        if ( n > 1 ) --n;   // leave a core for the ui and video threads
+        if ( n < 1 ) n = 1;
+    }
+
+    {
+        SCOPED_LOCK( _mutex );
+        if ( n == _max ) return;
+        _max = n;
+        pump();
+    }
+
+    LOG_INFO( _("Loading ") << n << _(" frames ahead at once.") );
+}
+
+void ReadAhead::request( CMedia* img, const boost::int64_t frame,
+                         const int dir, const boost::int64_t first,
+                         const boost::int64_t last )
+{
+    if ( !supports( img ) || last < first )
+    {
+        cancel();
+        return;
+    }
+
+    SCOPED_LOCK( _mutex );
+    FrameCache& cache = FrameCache::instance();
+    if ( _img && _img != img ) cache.erase_window( _img );
+
+    _img   = img;
+    _frame = frame;
+    _first = first;
+    _last  = last;
+    _dir   = dir;
+    _step  = 0;
+
+    FrameCache::Window w = { frame, window(), first, last, dir };
+    cache.window( img, w );
+    pump();
+}
+
+void ReadAhead::cancel()
+{
+    SCOPED_LOCK( _mutex );
+    if ( _img ) FrameCache::instance().erase_window( _img );
+    _img = NULL;
+}
+
+void ReadAhead::forget( const CMedia* img )
+{
+    std::vector< CMedia* > readers;
+
+    {
+        SCOPED_LOCK( _mutex );
+
+        if ( _img == img )
+        {
+            FrameCache::instance().erase_window( img );
+            _img = NULL;
+        }
+
+        while ( _busy.find( img ) != _busy.end() )
+            CONDITION_WAIT( _idle, _mutex );
+
+        ReaderMap::iterator i = _readers.lower_bound( img );
+        ReaderMap::iterator e = _readers.upper_bound( img );
+        for ( ; i != e; ++i )
+            readers.push_back( i->second.reader );
+        _readers.erase( img );
+    }
+
+    // Deleted unlocked, as ~CMedia calls forget() too.
+    std::vector< CMedia* >::iterator i = readers.begin();
+    std::vector< CMedia* >::iterator e = readers.end();
+    for ( ; i != e; ++i )
+        delete *i;
+}
+
+/**
+ * Frames of current request that fit in the memory budget, less those
+ * being loaded.  Called with _mutex locked.
+ */
+boost::int64_t ReadAhead::window() const
+{
+    const boost::int64_t len = _last - _first + 1;
+    const boost::int64_t bytes = boost::int64_t( _frame_bytes );
+    if ( bytes <= 0 ) return len;
+
+    boost::int64_t n = Preferences::max_memory / bytes - _max;
+    if ( n < 1 ) n = 1;
+    if ( n > len ) n = len;
+    return n;
+}
+
+/**
+ * Pick next frame of current request to load.  Called with _mutex locked.
+ *
+ * @param img      image to load frame of
+ * @param f        frame to load
+ * @param distance frames from the playhead to f
+ *
+ * @return true if there is a frame to load, false if not
+ */
+bool ReadAhead::next_frame( CMedia*& img, boost::int64_t& f,
+                            boost::int64_t& distance )
+{
+    if ( !_img ) return false;
+
+    // Do not load further ahead than fits in memory, or frames loaded
+    // would evict others before they are played.  Frames behind the
+    // playhead are evicted to make room as it moves.
+    const boost::int64_t len = _last - _first + 1;
+    const boost::int64_t n = window();
+    while ( _step < n )
+    {
+        boost::int64_t k = _step++;
+        boost::int64_t off;
+        if ( _dir > 0 )      off = k;
+        else if ( _dir < 0 ) off = -k;
+        else                 off = ( k & 1 ) ? ( k + 1 ) / 2 : -( k / 2 );
+
+        boost::int64_t c = ( _frame + off - _first ) % len;
+        if ( c < 0 ) c += len;
+        c += _first;
+
+        if ( _inflight.find( c ) != _inflight.end() ) continue;
+
+        img = _img;
+        f   = c;
+        distance = off < 0 ? -off : off;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Queue frames of current request, up to the number loaded at once.
+ * Each is due when the playhead would reach it.  Called with _mutex
+ * locked.
+ */
+void ReadAhead::pump()
+{
+    Scheduler& s = Scheduler::instance();
+
+    CMedia* img = NULL;
+    boost::int64_t f = 0, distance = 0;
+    while ( _running < _max && next_frame( img, f, distance ) )
+    {
+        _inflight.insert( f );
+        ++_busy[img];
+        ++_running;
+
+        double fps = std::abs( img->play_fps() );
+        if ( fps <= 0.0 ) fps = 24.0;
+        const boost::int64_t due = Scheduler::now() +
+                                   boost::int64_t( 1e6 * distance / fps );
+
+        // The frame at the playhead, or the next one, is shown next.
+        const Scheduler::Priority p = ( distance <= 1 ?
+                                        Scheduler::kPlayback :
+                                        Scheduler::kReadAhead );
+        s.submit( boost::bind( &ReadAhead::run, this, img, f ),
+                  p, "readahead", due );
+    }
+}
+
+void ReadAhead::run( CMedia* img, const boost::int64_t f )
+{
+    load( img, f );
+
+    SCOPED_LOCK( _mutex );
+    _inflight.erase( f );
+    if ( --_busy[img] == 0 ) _busy.erase( img );
+    --_running;
+    _idle.notify_all();
+    pump();
+}
+
+CMedia* ReadAhead::acquire_reader( CMedia* img )
+{
+    {
+        SCOPED_LOCK( _mutex );
+        ReaderMap::iterator i = _readers.lower_bound( img );
+        ReaderMap::iterator e = _readers.upper_bound( img );
+        for ( ; i != e; ++i )
+        {
+            if ( i->second.busy ) continue;
+            i->second.busy = true;
+            return i->second.reader;
+        }
+    }
+
+    std::string file = img->sequence_filename( img->start_frame() );
+    CMedia* r = CMedia::guess_image( file.c_str(), NULL, 0, true,
+                                     img->start_frame(), img->end_frame() );
+    if ( !r ) return NULL;
+
+    Reader reader = { r, true };
+    SCOPED_LOCK( _mutex );
+    _readers.insert( std::make_pair( img, reader ) );
+    return r;
+}
+
+void ReadAhead::release_reader( CMedia* img, CMedia* r )
+{
+    SCOPED_LOCK( _mutex );
+    ReaderMap::iterator i = _readers.lower_bound( img );
+    ReaderMap::iterator e = _readers.upper_bound( img );
+    for ( ; i != e; ++i )
+    {
+        if ( i->second.reader != r ) continue;
+        i->second.busy = false;
+        return;
+    }
+}
+
+void ReadAhead::load( CMedia* img, const boost::int64_t f )
+{
+    if ( img->is_cache_filled( f ) != CMedia::kNoCache ) return;
+    if ( img->restore_spilled( f ) ) return;
+
+    CMedia* r = acquire_reader( img );
+    if ( !r ) return;
+
+    typedef CMedia::Mutex Mutex;
+    Mutex& mtx = img->video_mutex();
+
+    std::string ch;
+    {
+        SCOPED_LOCK( mtx );
+        if ( img->channel() ) ch = img->channel();
+    }
+
+    // Follow the layer shown in the viewer.
+    const char* rc = r->channel();
+    if ( ch != ( rc ? rc : "" ) )
+    {
+        r->channel( ch.empty() ? NULL : ch.c_str() );
+        r->clear_cache();
+    }
+
+    mrv::image_type_ptr canvas;
+    bool ok = false;
+    try
+    {
+        ok = r->fetch( canvas, f );
+    }
+    catch( const std::exception& e )
+    {
+        LOG_ERROR( r->sequence_filename( f ) << ": " << e.what() );
+    }
+
+    if ( ok && canvas )
+    {
+        _frame_bytes = canvas->data_size();
+
+        const mrv::Recti& dw = r->data_window( f );
+        const mrv::Recti& dpw = r->display_window( f );
+
+        SCOPED_LOCK( mtx );
+        if ( img->is_cache_filled( f ) == CMedia::kNoCache )
+        {
+            img->data_window( dw.x(), dw.y(), dw.r() - 1, dw.b() - 1, f );
+            img->display_window( dpw.x(), dpw.y(), dpw.r() - 1,
+                                 dpw.b() - 1, f );
+            img->cache( canvas );
+        }
+    }
+
+    release_reader( img, r );
+}
+
+} // namespace mrv
@@ -0,0 +1,132 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvReadAhead.h
+ * @author gga
+ * @date   Sat Oct 17 18:40:05 2026
+ *
+ * @brief  Loads image sequence frames ahead of the playhead.
+ *
+ *
+ */
+
+#ifndef mrvReadAhead_h
+#define mrvReadAhead_h
+
+#include <atomic>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace mrv {
+
+class CMedia;
+
+//
+// CMedia::fetch() keeps a lot of per-reader state (current part, layers,
+// data windows...), so two threads cannot fetch from the same CMedia.
+// Instead, each loader opens its own private reader of the sequence,
+// fetches the frame with it and hands the picture over to the original
+// image with CMedia::cache(), under the image's mutex.
+//
+// Frames are loaded as tasks of the Scheduler, due when the playhead
+// would reach them, with a limit on how many are queued at once.  They
+// are loaded no further ahead than fits in the memory budget.  That
+// window is handed to the FrameCache, which evicts frames already played
+// before those in it.
+//
+class ReadAhead
+{
+public:
+    typedef boost::mutex              Mutex;
+    typedef boost::condition_variable Condition;
+
+public:
+    static ReadAhead& instance();
+
+    // Returns true if frames of the image can be loaded ahead.
+    static bool supports( const CMedia* img );
+
+    // Set number of frames loaded at once.  0 uses one per core, less one.
+    void threads( unsigned n );
+    inline unsigned threads() const { return _max; }
+
+    // Load frames of img around frame, within [first, last], ahead in
+    // direction dir (1 forwards, -1 backwards, 0 both ways).  Replaces
+    // any previous request.
+    void request( CMedia* img, const boost::int64_t frame, const int dir,
+                  const boost::int64_t first, const boost::int64_t last );
+
+    // Stop loading.  Frames in flight are still finished.
+    void cancel();
+
+    // Drop all readers of an image about to be deleted.  Blocks until
+    // no frame of it is being loaded.
+    void forget( const CMedia* img );
+
+protected:
+    ReadAhead();
+    ~ReadAhead();
+
+    void pump();
+    void run( CMedia* img, const boost::int64_t f );
+    bool next_frame( CMedia*& img, boost::int64_t& f,
+                     boost::int64_t& distance );
+    boost::int64_t window() const;
+    void load( CMedia* img, const boost::int64_t f );
+
+    CMedia* acquire_reader( CMedia* img );
+    void    release_reader( CMedia* img, CMedia* r );
+
+protected:
+    struct Reader
+    {
+        CMedia* reader;
+        bool    busy;
+    };
+
+    typedef std::multimap< const CMedia*, Reader >      ReaderMap;
+    typedef std::map< const CMedia*, unsigned >         BusyMap;
+    typedef std::set< boost::int64_t >                  FrameSet;
+
+    Mutex      _mutex;
+    Condition  _idle;      //!< a frame was loaded
+    ReaderMap  _readers;
+    BusyMap    _busy;      //!< frames of each image queued or loading
+    FrameSet   _inflight;  //!< frames of current request being loaded
+    unsigned   _max;       //!< frames loaded at once
+    unsigned   _running;   //!< frames queued or loading
+
+    // Current request
+    CMedia*        _img;
+    boost::int64_t _frame;
+    boost::int64_t _first;
+    boost::int64_t _last;
+    int            _dir;
+    boost::int64_t _step;   //!< next candidate offset from _frame
+
+    std::atomic<size_t> _frame_bytes;  //!< size of last frame loaded
+};
+
+} // namespace mrv
+
+#endif // mrvReadAhead_h
@@ -0,0 +1,272 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvResample.cpp
+ * @author gga
+ * @date   Sun Oct 18 11:02:15 2026
+ *
+ * @brief  Separable, multithreaded resampling of video frames.
+ *
+ *
+ */
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/bind.hpp>
+
+#include "core/mrvSSE.h"
+#include "core/mrvFrame.h"
+#include "core/mrvResample.h"
+#include "core/mrvScheduler.h"
+
+namespace {
+
+// Fewest destination rows worth a thread of their own.
+const unsigned kMinRowsPerThread = 32;
+
+//
+// Filter weights of one axis.  Destination pixel i is the weighted sum of
+// count[i] source pixels starting at first[i], with weights at
+// weights[i * taps].
+//
+struct Kernel
+{
+    unsigned                taps;
+    std::vector< unsigned > first;
+    std::vector< unsigned > count;
+    std::vector< float >    weights;
+};
+
+void make_kernel( Kernel& k, const unsigned src, const unsigned dst )
+{
+    const double scale   = double(src) / double(dst);
+    const double support = std::max( 1.0, scale );
+
+    k.taps = unsigned( std::ceil( support * 2.0 ) ) + 2;
+    k.first.resize( dst );
+    k.count.resize( dst );
+    k.weights.assign( size_t(dst) * k.taps, 0.0f );
+
+    for ( unsigned i = 0; i < dst; ++i )
+    {
+        const double center = ( i + 0.5 ) * scale;
+        int lo = int( std::floor( center - support ) );
+        int hi = int( std::ceil( center + support ) );
+        if ( lo < 0 ) lo = 0;
+        if ( hi > int(src) - 1 ) hi = int(src) - 1;
+        if ( hi - lo + 1 > int(k.taps) ) hi = lo + int(k.taps) - 1;
+
+        float* w = &k.weights[ size_t(i) * k.taps ];
+        double sum = 0.0;
+        for ( int j = lo; j <= hi; ++j )
+        {
+            double d = std::fabs( j + 0.5 - center ) / support;
+            double x = d < 1.0 ? 1.0 - d : 0.0;
+            w[j - lo] = float(x);
+            sum += x;
+        }
+
+        k.first[i] = unsigned(lo);
+        k.count[i] = unsigned(hi - lo + 1);
+
+        if ( sum > 0.0 )
+        {
+            for ( int j = 0; j <= hi - lo; ++j )
+                w[j] = float( w[j] / sum );
+        }
+        else
+        {
+            // Nearest source pixel
+            unsigned n = std::min( unsigned(center), src - 1 );
+            k.first[i] = n;
+            k.count[i] = 1;
+            w[0] = 1.0f;
+        }
+    }
+}
+
+//
+// out = sum of n pixels at in, in + stride, ... weighted by w.
+// Pixels are four floats (r, g, b, a).
+//
+inline void weigh( const float* w, const unsigned n,
+                   const float* const* in, float* out )
+{
+#ifdef MR_SSE
+    __m128 acc = _mm_setzero_ps();
+    for ( unsigned j = 0; j < n; ++j )
+        acc = _mm_add_ps( acc, _mm_mul_ps( _mm_loadu_ps( in[j] ),
+                                           _mm_set1_ps( w[j] ) ) );
+    _mm_storeu_ps( out, acc );
+#else
+    float r = 0.f, g = 0.f, b = 0.f, a = 0.f;
+    for ( unsigned j = 0; j < n; ++j )
+    {
+        const float* p = in[j];
+        r += p[0] * w[j];
+        g += p[1] * w[j];
+        b += p[2] * w[j];
+        a += p[3] * w[j];
+    }
+    out[0] = r; out[1] = g; out[2] = b; out[3] = a;
+#endif
+}
+
+void filter_row( const Kernel& k, const mrv::ImagePixel* in,
+                 mrv::ImagePixel* out, const unsigned n )
+{
+    std::vector< const float* > taps( k.taps );
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        const unsigned c = k.count[i];
+        const mrv::ImagePixel* s = in + k.first[i];
+        for ( unsigned j = 0; j < c; ++j )
+            taps[j] = (const float*) ( s + j );
+        weigh( &k.weights[ size_t(i) * k.taps ], c, &taps[0],
+               (float*) ( out + i ) );
+    }
+}
+
+void blend_rows( const float* w, const unsigned n,
+                 const mrv::ImagePixel* const* rows,
+                 mrv::ImagePixel* out, const unsigned width )
+{
+    std::vector< const float* > taps( n );
+    for ( unsigned x = 0; x < width; ++x )
+    {
+        for ( unsigned j = 0; j < n; ++j )
+            taps[j] = (const float*) ( rows[j] + x );
+        weigh( w, n, &taps[0], (float*) ( out + x ) );
+    }
+}
+
+struct Resampler
+{
+    const mrv::VideoFrame* src;
+    Kernel                 kx;
+    Kernel                 ky;
+    mrv::RowReader         read;
+    mrv::RowWriter         write;
+
+    Resampler( const mrv::VideoFrame* s, mrv::VideoFrame* d ) :
+        src( s ),
+        read( s ),
+        write( d )
+    {
+        make_kernel( kx, unsigned( s->width() ), unsigned( d->width() ) );
+        make_kernel( ky, unsigned( s->height() ), unsigned( d->height() ) );
+    }
+
+    // Resample destination rows [y0, y1).
+    void rows( const unsigned y0, const unsigned y1 )
+    {
+        const unsigned W = unsigned( src->width() );
+        const unsigned w = unsigned( kx.first.size() );
+
+        // Ring of horizontally filtered source rows.  Rows needed by
+        // consecutive destination rows overlap, and a destination row
+        // needs at most ky.taps of them, so that many slots suffice.
+        const unsigned R = ky.taps;
+        std::vector< mrv::ImagePixel > line( W );
+        std::vector< mrv::ImagePixel > ring( size_t(R) * w );
+        std::vector< int > tags( R, -1 );
+        std::vector< const mrv::ImagePixel* > taps( R );
+        std::vector< mrv::ImagePixel > out( w );
+
+        for ( unsigned y = y0; y < y1; ++y )
+        {
+            const unsigned first = ky.first[y];
+            const unsigned n     = ky.count[y];
+            for ( unsigned j = 0; j < n; ++j )
+            {
+                const unsigned sy = first + j;
+                const unsigned slot = sy % R;
+                mrv::ImagePixel* row = &ring[ size_t(slot) * w ];
+                if ( tags[slot] != int(sy) )
+                {
+                    read( sy, 0, W, &line[0] );
+                    filter_row( kx, &line[0], row, w );
+                    tags[slot] = int(sy);
+                }
+                taps[j] = row;
+            }
+
+            blend_rows( &ky.weights[ size_t(y) * ky.taps ], n, &taps[0],
+                        &out[0], w );
+            write( y, 0, w, &out[0] );
+        }
+    }
+};
+
+// Splits the rows of a resize in bands of the same height.
+struct RowBands
+{
+    Resampler* r;
+    unsigned   band;
+    unsigned   H;
+
+    void run( const unsigned i )
+    {
+        const unsigned y = i * band;
+        r->rows( y, std::min( y + band, H ) );
+    }
+};
+
+}  // namespace
+
+
+namespace mrv {
+
+VideoFrame* resample( const VideoFrame* src,
+                      const unsigned w, const unsigned h )
+{
+    VideoFrame* dst = new VideoFrame( src->frame(),
+                                      std::max( w, 1U ),
+                                      std::max( h, 1U ),
+                                      src->channels(),
+                                      src->format(),
+                                      src->pixel_type(),
+                                      src->repeat() );
+    if ( !src->data() || src->width() == 0 || src->height() == 0 )
+        return dst;
+
+    Resampler r( src, dst );
+
+    const unsigned H = unsigned( dst->height() );
+    unsigned threads = Scheduler::instance().threads();
+    threads = std::min( threads, H / kMinRowsPerThread );
+    if ( threads < 1 ) threads = 1;
+
+    // Bands start on even rows, as 4:2:0 pictures share chroma between
+    // row pairs.
+    unsigned band = ( H + threads - 1 ) / threads;
+    band = ( band + 1 ) & ~1U;
+
+    RowBands bands = { &r, band, H };
+    Scheduler::instance().parallel_for( ( H + band - 1 ) / band,
+                                        boost::bind( &RowBands::run,
+                                                     &bands, _1 ),
+                                        "resample" );
+
+    return dst;
+}
+
+} // namespace mrv
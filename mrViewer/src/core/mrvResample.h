@@ -0,0 +1,49 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvResample.h
+ * @author gga
+ * @date   Sun Oct 18 11:02:15 2026
+ *
+ * @brief  Separable, multithreaded resampling of video frames.
+ *
+ *
+ */
+
+#ifndef mrvResample_h
+#define mrvResample_h
+
+namespace mrv {
+
+class VideoFrame;
+
+//
+// Resize a picture with a tent filter, wide enough when shrinking to
+// average all source pixels under each destination pixel.  Filter weights
+// are computed once per axis.  Bands of destination rows are resampled in
+// parallel.  Each band keeps only the few horizontally filtered source
+// rows its current row needs, so no intermediate picture is allocated.
+//
+// The result has the same format and pixel type as the source.
+//
+VideoFrame* resample( const VideoFrame* src,
+                      const unsigned w, const unsigned h );
+
+} // namespace mrv
+
+#endif // mrvResample_h
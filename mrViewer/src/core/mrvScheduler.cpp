@@ -0,0 +1,333 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvScheduler.cpp
+ * @author gga
+ * @date   Sun Oct 18 17:12:40 2026
+ *
+ * @brief  Pool of threads shared by all background work.
+ *
+ *
+ */
+
+#include <algorithm>
+#include <exception>
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/bind.hpp>
+
+#include "core/mrvI8N.h"
+#include "core/mrvThread.h"
+#include "core/mrvScheduler.h"
+#include "gui/mrvIO.h"
+
+namespace {
+const char* kModule = "sched";
+
+// Index of the scheduler thread we are in, or -1 if not one.
+thread_local int t_worker = -1;
+}
+
+namespace mrv {
+
+bool Scheduler::Entry::operator<( const Entry& b ) const
+{
+    if ( priority != b.priority ) return priority > b.priority;
+
+    // Tasks without deadline go after those with one.
+    if ( deadline != b.deadline )
+    {
+        if ( deadline == 0 ) return true;
+        if ( b.deadline == 0 ) return false;
+        return deadline > b.deadline;
+    }
+    return serial > b.serial;
+}
+
+Scheduler& Scheduler::instance()
+{
+    // Never destroyed, as tasks may still be running at exit.
+    static Scheduler* scheduler = new Scheduler;
+    return *scheduler;
+}
+
+boost::int64_t Scheduler::now()
+{
+    return av_gettime_relative();
+}
+
+Scheduler::Scheduler() :
+    _serial( 0 ),
+    _pending( 0 )
+{
+    unsigned n = boost::thread::hardware_concurrency();
+    if ( n < 1 ) n = 1;
+
+    for ( unsigned i = 0; i <= n; ++i )
+        _queues.push_back( new Queue );
+
+    for ( unsigned i = 0; i < n; ++i )
+        _threads.push_back( new boost::thread(
+                                boost::bind( &Scheduler::worker, this, i ) ) );
+
+    LOG_INFO( _("Scheduling work on ") << n << _(" threads.") );
+}
+
+void Scheduler::wake()
+{
+    {
+        // Makes sure a thread about to sleep sees _pending first.
+        SCOPED_LOCK( _mutex );
+    }
+    _cond.notify_one();
+}
+
+void Scheduler::submit( const Task& task, const Priority p,
+                        const char* name, const boost::int64_t deadline )
+{
+    Entry e;
+    e.task = task;
+    e.priority = p;
+    e.deadline = deadline;
+    e.queued = now();
+    e.name = name;
+
+    {
+        SCOPED_LOCK( _mutex );
+        e.serial = _serial++;
+        _entries.push_back( e );
+        std::push_heap( _entries.begin(), _entries.end() );
+        ++_pending;
+    }
+    _cond.notify_one();
+}
+
+void Scheduler::parallel_for( const unsigned n, const Chunk& chunk,
+                              const char* name )
+{
+    if ( n == 0 ) return;
+
+    const boost::int64_t start = now();
+
+    // The calling thread runs chunks too, so one worker is enough to
+    // split the work.
+    if ( n == 1 || _threads.empty() )
+    {
+        for ( unsigned i = 0; i < n; ++i )
+            chunk( i );
+        record( name, 0, now() - start, false );
+        return;
+    }
+
+    Group g;
+    g.chunk = chunk;
+    g.left = n;
+
+    const unsigned idx = ( t_worker < 0 ) ? unsigned( _threads.size() ) :
+                         unsigned( t_worker );
+    Queue* q = _queues[idx];
+    {
+        Mutex& qm = q->mutex;
+        SCOPED_LOCK( qm );
+        for ( unsigned i = n - 1; i > 0; --i )
+        {
+            Piece p = { &g, i };
+            q->pieces.push_back( p );
+        }
+    }
+    _pending += n - 1;
+    for ( unsigned i = 1; i < n && i <= _threads.size(); ++i )
+        wake();
+
+    Piece first = { &g, 0 };
+    run_piece( first );
+
+    // Help with queued chunks, ours or others', until ours are done.
+    Piece p;
+    while ( g.left > 0 && take_piece( idx, p ) )
+        run_piece( p );
+
+    {
+        Mutex& gm = g.mutex;
+        SCOPED_LOCK( gm );
+        while ( g.left > 0 )
+            CONDITION_WAIT( g.done, gm );
+    }
+
+    record( name, 0, now() - start, false );
+}
+
+bool Scheduler::take_piece( const unsigned idx, Piece& p )
+{
+    if ( _pending <= 0 ) return false;
+
+    {
+        Queue* q = _queues[idx];
+        Mutex& qm = q->mutex;
+        SCOPED_LOCK( qm );
+        if ( !q->pieces.empty() )
+        {
+            p = q->pieces.back();
+            q->pieces.pop_back();
+            --_pending;
+            return true;
+        }
+    }
+
+    const size_t n = _queues.size();
+    for ( size_t k = 1; k < n; ++k )
+    {
+        Queue* q = _queues[ ( idx + k ) % n ];
+        Mutex& qm = q->mutex;
+        SCOPED_LOCK( qm );
+        if ( q->pieces.empty() ) continue;
+        p = q->pieces.front();
+        q->pieces.pop_front();
+        --_pending;
+        return true;
+    }
+
+    return false;
+}
+
+bool Scheduler::take_entry( Entry& e )
+{
+    SCOPED_LOCK( _mutex );
+    if ( _entries.empty() ) return false;
+    std::pop_heap( _entries.begin(), _entries.end() );
+    e = _entries.back();
+    _entries.pop_back();
+    --_pending;
+    return true;
+}
+
+void Scheduler::run_piece( const Piece& p )
+{
+    Group* g = p.group;
+    try
+    {
+        g->chunk( p.index );
+    }
+    catch( const std::exception& e )
+    {
+        LOG_ERROR( e.what() );
+    }
+
+    // Locked, as the waiting thread frees the group once it sees none
+    // left.
+    Mutex& gm = g->mutex;
+    SCOPED_LOCK( gm );
+    if ( --g->left == 0 )
+        g->done.notify_all();
+}
+
+void Scheduler::run_entry( const Entry& e )
+{
+    const boost::int64_t start = now();
+    try
+    {
+        e.task();
+    }
+    catch( const std::exception& ex )
+    {
+        LOG_ERROR( e.name << ": " << ex.what() );
+    }
+    const boost::int64_t end = now();
+
+    record( e.name, start - e.queued, end - start,
+            e.deadline != 0 && end > e.deadline );
+}
+
+void Scheduler::worker( const unsigned idx )
+{
+    t_worker = int( idx );
+
+    for (;;)
+    {
+        // Chunks first, as someone is waiting on them.
+        Piece p;
+        if ( take_piece( idx, p ) )
+        {
+            run_piece( p );
+            continue;
+        }
+
+        Entry e;
+        if ( take_entry( e ) )
+        {
+            run_entry( e );
+            continue;
+        }
+
+        SCOPED_LOCK( _mutex );
+        while ( _pending <= 0 )
+            CONDITION_WAIT( _cond, _mutex );
+    }
+}
+
+void Scheduler::record( const char* name, const boost::int64_t wait,
+                        const boost::int64_t run, const bool late )
+{
+    SCOPED_LOCK( _stats_mutex );
+    StatsMap::iterator i = _stats.find( name );
+    if ( i == _stats.end() )
+    {
+        Stats s = { 0, 0, 0, 0, 0 };
+        i = _stats.insert( std::make_pair( std::string( name ), s ) ).first;
+    }
+
+    Stats& s = i->second;
+    ++s.count;
+    if ( late ) ++s.late;
+    s.wait += wait;
+    s.run += run;
+    if ( run > s.max_run ) s.max_run = run;
+}
+
+Scheduler::StatsMap Scheduler::stats() const
+{
+    SCOPED_LOCK( _stats_mutex );
+    return _stats;
+}
+
+void Scheduler::reset_stats()
+{
+    SCOPED_LOCK( _stats_mutex );
+    _stats.clear();
+}
+
+void Scheduler::log_stats() const
+{
+    StatsMap s = stats();
+    StatsMap::const_iterator i = s.begin();
+    for ( ; i != s.end(); ++i )
+    {
+        const Stats& t = i->second;
+        LOG_INFO( i->first << ": " << t.count << _(" runs, ")
+                  << t.run / 1000.0 / t.count << _(" ms average, ")
+                  << t.max_run / 1000.0 << _(" ms max, ")
+                  << t.wait / 1000.0 / t.count << _(" ms queued, ")
+                  << t.late << _(" late") );
+    }
+}
+
+} // namespace mrv
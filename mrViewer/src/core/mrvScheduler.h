@@ -0,0 +1,176 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvScheduler.h
+ * @author gga
+ * @date   Sun Oct 18 17:12:40 2026
+ *
+ * @brief  Pool of threads shared by all background work.
+ *
+ *
+ */
+
+#ifndef mrvScheduler_h
+#define mrvScheduler_h
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace mrv {
+
+//
+// One thread per core runs the work of all media: frames loaded ahead,
+// thumbnails, scopes, and the chunks of resizes and lut bakes.  Tasks are
+// queued by priority and then by deadline, so frames near the playhead
+// go first.  Chunks of a parallel_for() are kept in per-thread queues
+// that idle threads steal from, and the thread waiting on them runs
+// them too, so a task may split its work without deadlocking the pool.
+//
+// Playback threads of each clip (decode, video, audio, subtitles) are
+// not tasks, as they block on each other for the whole playback.  They
+// share the cores with the pool, and DecodeBudget splits the same cores
+// among the decoders of the clips playing.
+//
+class Scheduler
+{
+public:
+    typedef boost::mutex                        Mutex;
+    typedef boost::condition_variable           Condition;
+    typedef boost::function< void () >          Task;
+    typedef boost::function< void (unsigned) >  Chunk;
+
+    // Lower runs first.
+    enum Priority
+    {
+        kPlayback,     //!< needed for the frame about to be shown
+        kReadAhead,    //!< frames ahead of the playhead
+        kInteractive,  //!< scopes and other views of the frame shown
+        kBackground,   //!< thumbnails and the like
+    };
+
+    // Time spent by the tasks of a name, in microseconds.
+    struct Stats
+    {
+        unsigned        count;
+        unsigned        late;     //!< finished past their deadline
+        boost::int64_t  wait;     //!< total time queued
+        boost::int64_t  run;      //!< total time running
+        boost::int64_t  max_run;  //!< longest run
+    };
+
+    typedef std::map< std::string, Stats > StatsMap;
+
+public:
+    static Scheduler& instance();
+
+    // Microseconds of a monotonic clock, for deadlines.
+    static boost::int64_t now();
+
+    // Queue a task.  A deadline of 0 means none.
+    void submit( const Task& task, const Priority p, const char* name,
+                 const boost::int64_t deadline = 0 );
+
+    // Run chunk( i ) for i in [0, n) and wait for all of them.
+    void parallel_for( const unsigned n, const Chunk& chunk,
+                       const char* name );
+
+    inline unsigned threads() const { return unsigned( _threads.size() ); }
+
+    StatsMap stats() const;
+    void reset_stats();
+
+    // Log time spent by tasks since last reset.
+    void log_stats() const;
+
+protected:
+    Scheduler();
+
+    struct Entry
+    {
+        Task           task;
+        Priority       priority;
+        boost::int64_t deadline;
+        boost::int64_t queued;
+        unsigned       serial;
+        const char*    name;
+
+        // Heap order, so the top entry runs first.
+        bool operator<( const Entry& b ) const;
+    };
+
+    struct Group
+    {
+        Chunk                 chunk;
+        std::atomic<unsigned> left;   //!< chunks not finished
+        Mutex                 mutex;
+        Condition             done;
+    };
+
+    struct Piece
+    {
+        Group*   group;
+        unsigned index;
+    };
+
+    // Chunks pushed by a thread.  Its owner takes from the back, others
+    // steal from the front.
+    struct Queue
+    {
+        Mutex               mutex;
+        std::deque< Piece > pieces;
+    };
+
+    typedef std::vector< Entry >          EntryHeap;
+    typedef std::vector< Queue* >         QueueList;
+    typedef std::vector< boost::thread* > ThreadList;
+
+    void worker( const unsigned idx );
+    bool take_piece( const unsigned idx, Piece& p );
+    bool take_entry( Entry& e );
+    void run_piece( const Piece& p );
+    void run_entry( const Entry& e );
+    void record( const char* name, const boost::int64_t wait,
+                 const boost::int64_t run, const bool late );
+    void wake();
+
+protected:
+    Mutex            _mutex;
+    Condition        _cond;       //!< work was queued
+    EntryHeap        _entries;
+    unsigned         _serial;
+    std::atomic<int> _pending;    //!< entries and pieces queued
+
+    QueueList        _queues;     //!< one per thread, and one for others
+    ThreadList       _threads;
+
+    mutable Mutex    _stats_mutex;
+    StatsMap         _stats;
+};
+
+} // namespace mrv
+
+#endif // mrvScheduler_h
@@ -0,0 +1,203 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvSeatSync.cpp
+ * @author gga
+ * @date   Sun Oct 18 19:10:36 2026
+ *
+ * @brief  Keeps playback of several seats of a sync session together.
+ *
+ *
+ */
+
+#include <cmath>
+
+#include "core/mrvI8N.h"
+#include "core/mrvThread.h"
+#include "core/mrvSeatSync.h"
+#include "gui/mrvIO.h"
+
+namespace {
+const char* kModule = "seats";
+
+// A reference older than this is not trusted, as the leader sends one
+// every second.
+const boost::int64_t kMaxAge = 3000000;
+
+// Seats further apart than this have looped or seeked, not drifted.
+const double kMaxSkew = 1.0;
+
+// Skew is logged this often while following.
+const boost::int64_t kReportInterval = 5000000;
+}
+
+namespace mrv {
+
+SyncClock::SyncClock() :
+    _count( 0 ),
+    _next( 0 )
+{
+}
+
+void SyncClock::sample( const boost::int64_t t0, const boost::int64_t t1,
+                        const boost::int64_t t2, const boost::int64_t t3 )
+{
+    Sample s;
+    s.offset = ( ( t1 - t0 ) + ( t2 - t3 ) ) / 2;
+    s.round_trip = ( t3 - t0 ) - ( t2 - t1 );
+    if ( s.round_trip < 0 ) s.round_trip = 0;
+
+    SCOPED_LOCK( _mutex );
+    _samples[_next] = s;
+    _next = ( _next + 1 ) % kSamples;
+    if ( _count < kSamples ) ++_count;
+}
+
+int SyncClock::best() const
+{
+    int r = -1;
+    for ( unsigned i = 0; i < _count; ++i )
+    {
+        if ( r < 0 || _samples[i].round_trip < _samples[r].round_trip )
+            r = int(i);
+    }
+    return r;
+}
+
+bool SyncClock::synced() const
+{
+    SCOPED_LOCK( _mutex );
+    return _count > 0;
+}
+
+unsigned SyncClock::samples() const
+{
+    SCOPED_LOCK( _mutex );
+    return _count;
+}
+
+boost::int64_t SyncClock::offset() const
+{
+    SCOPED_LOCK( _mutex );
+    int i = best();
+    return i < 0 ? 0 : _samples[i].offset;
+}
+
+boost::int64_t SyncClock::round_trip() const
+{
+    SCOPED_LOCK( _mutex );
+    int i = best();
+    return i < 0 ? 0 : _samples[i].round_trip;
+}
+
+boost::int64_t SyncClock::to_local( const boost::int64_t t ) const
+{
+    return t - offset();
+}
+
+
+SeatSync& SeatSync::instance()
+{
+    // Never destroyed, as video threads may still ask at exit.
+    static SeatSync* seats = new SeatSync;
+    return *seats;
+}
+
+SeatSync::SeatSync() :
+    _active( false ),
+    _frame( 0 ),
+    _time( 0 ),
+    _fps( 24.0 ),
+    _step( 1 ),
+    _since( 0 ),
+    _count( 0 ),
+    _sum( 0.0 ),
+    _worst( 0.0 )
+{
+}
+
+void SeatSync::reference( const boost::int64_t frame, const boost::int64_t t,
+                          const double fps, const int step )
+{
+    SCOPED_LOCK( _mutex );
+    if ( !_active ) _since = t;
+    _active = true;
+    _frame = frame;
+    _time = t;
+    _fps = fps > 0.0 ? fps : 24.0;
+    _step = step < 0 ? -1 : 1;
+}
+
+void SeatSync::clear()
+{
+    SCOPED_LOCK( _mutex );
+    _active = false;
+    _count = 0;
+    _sum = _worst = 0.0;
+}
+
+bool SeatSync::frame_at( const boost::int64_t now,
+                         boost::int64_t& frame ) const
+{
+    SCOPED_LOCK( _mutex );
+    if ( !_active ) return false;
+
+    const boost::int64_t age = now - _time;
+    if ( age < 0 || age > kMaxAge ) return false;
+
+    frame = _frame + _step * boost::int64_t( age * _fps / 1e6 + 0.5 );
+    return true;
+}
+
+bool SeatSync::skew( const boost::int64_t frame, const boost::int64_t now,
+                     double& ahead )
+{
+    SCOPED_LOCK( _mutex );
+    if ( !_active ) return false;
+
+    const boost::int64_t age = now - _time;
+    if ( age < 0 || age > kMaxAge ) return false;
+
+    // Where the leader's playhead is now, in seconds.
+    const double leader = _frame / _fps + _step * age / 1e6;
+    ahead = _step * ( frame / _fps - leader );
+    if ( std::abs( ahead ) > kMaxSkew ) return false;
+
+    ++_count;
+    _sum += std::abs( ahead );
+    if ( std::abs( ahead ) > std::abs( _worst ) ) _worst = ahead;
+
+    if ( now - _since >= kReportInterval ) report( now );
+    return true;
+}
+
+/**
+ * Log skew to the leader since last report.  Called with _mutex locked.
+ */
+void SeatSync::report( const boost::int64_t now )
+{
+    if ( _count > 0 )
+        LOG_INFO( _("Skew to leading seat: ") << 1000.0 * _sum / _count
+                  << _(" ms average, ") << 1000.0 * _worst
+                  << _(" ms worst over ") << _count << _(" frames.") );
+    _since = now;
+    _count = 0;
+    _sum = _worst = 0.0;
+}
+
+} // namespace mrv
@@ -0,0 +1,141 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvSeatSync.h
+ * @author gga
+ * @date   Sun Oct 18 19:10:36 2026
+ *
+ * @brief  Keeps playback of several seats of a sync session together.
+ *
+ *
+ */
+
+#ifndef mrvSeatSync_h
+#define mrvSeatSync_h
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace mrv {
+
+//
+// Estimate of the clock of a peer, NTP style.  We send the peer our time
+// t0, it answers with the time it got it, t1, and the time it answered,
+// t2, and we note the time the answer arrived, t3.  The sample with the
+// shortest round trip of the last few is the one trusted, as its delays
+// are the most likely to be the same both ways.
+//
+// Times are microseconds of mrv::Timer::now().
+//
+class SyncClock
+{
+public:
+    typedef boost::mutex Mutex;
+
+    enum { kSamples = 8 };
+
+public:
+    SyncClock();
+
+    void sample( const boost::int64_t t0, const boost::int64_t t1,
+                 const boost::int64_t t2, const boost::int64_t t3 );
+
+    // Whether we have heard from the peer's clock at all.
+    bool synced() const;
+
+    // Number of samples taken, up to kSamples.
+    unsigned samples() const;
+
+    // Peer's clock minus ours.
+    boost::int64_t offset() const;
+
+    // Round trip of the sample trusted.
+    boost::int64_t round_trip() const;
+
+    // Time t of the peer's clock in ours.
+    boost::int64_t to_local( const boost::int64_t t ) const;
+
+protected:
+    struct Sample
+    {
+        boost::int64_t offset;
+        boost::int64_t round_trip;
+    };
+
+    int best() const;
+
+protected:
+    mutable Mutex _mutex;
+    Sample        _samples[kSamples];
+    unsigned      _count;
+    unsigned      _next;
+};
+
+//
+// The seat where playback was started leads.  It sends which frame it
+// showed when, in the clock of each peer, and the other seats' video
+// threads compare their own frame against it, skipping or repeating
+// frames as they do to follow audio.  Skew is logged every few seconds.
+//
+class SeatSync
+{
+public:
+    typedef boost::mutex Mutex;
+
+public:
+    static SeatSync& instance();
+
+    // The leader showed frame at time t, in our clock.
+    void reference( const boost::int64_t frame, const boost::int64_t t,
+                    const double fps, const int step );
+
+    // No seat leads anymore.
+    void clear();
+
+    // Seconds we are ahead of the leader, in the direction of playback,
+    // showing frame at time now.  Returns false if no leader or too far
+    // off to compare, as after a loop or seek.
+    bool skew( const boost::int64_t frame, const boost::int64_t now,
+               double& ahead );
+
+    // Frame the leader shows at time now.
+    bool frame_at( const boost::int64_t now, boost::int64_t& frame ) const;
+
+protected:
+    SeatSync();
+
+    void report( const boost::int64_t now );
+
+protected:
+    mutable Mutex  _mutex;
+    bool           _active;
+    boost::int64_t _frame;
+    boost::int64_t _time;
+    double         _fps;
+    int            _step;
+
+    // Skew since last report
+    boost::int64_t _since;
+    unsigned       _count;
+    double         _sum;
+    double         _worst;
+};
+
+} // namespace mrv
+
+#endif // mrvSeatSync_h
@@ -39,6 +39,7 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <deque>
 #include <iostream>
 #include <fstream>
@@ -50,6 +51,7 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/unordered_map.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/io_service.hpp>
@@ -69,6 +71,8 @@
 
 #include "core/mrvPlayback.h"
 #include "core/mrvOS.h"
+#include "core/mrvSeatSync.h"
+#include "core/mrvTimer.h"
 #include "mrvClient.h"
 #include "mrvServer.h"
 #include "gui/mrvPreferences.h"
@@ -98,6 +102,150 @@ using boost::asio::ip::tcp;
 
 namespace {
 const char* const kModule = "parser";
+
+// Names of Parser::Command values, in the same order.
+const char* const kCommandNames[] = {
+    "",
+    N_("GLPathShape"),
+    N_("GLArrowShape"),
+    N_("GLRectangleShape"),
+    N_("GLCircleShape"),
+    N_("GLErasePathShape"),
+    N_("GLTextShape"),
+    N_("GhostPrevious"),
+    N_("GhostNext"),
+    N_("FPS"),
+    N_("EDL"),
+    N_("Looping"),
+    N_("Selection"),
+    N_("UndoDraw"),
+    N_("RedoDraw"),
+    N_("FitImage"),
+    N_("Zoom"),
+    N_("Rotate"),
+    N_("Rotation"),
+    N_("Spin"),
+    N_("Offset"),
+    N_("MovePicture"),
+    N_("ScalePicture"),
+    N_("HBCSActive"),
+    N_("Hue"),
+    N_("Brightness"),
+    N_("Contrast"),
+    N_("Saturation"),
+    N_("UpdateLayers"),
+    N_("Channel"),
+    N_("FieldDisplay"),
+    N_("Normalize"),
+    N_("WipeVertical"),
+    N_("WipeHorizontal"),
+    N_("NoWipe"),
+    N_("OCIO"),
+    N_("OCIOConfig"),
+    N_("OCIOView"),
+    N_("ICS"),
+    N_("Gain"),
+    N_("Gamma"),
+    N_("Mask"),
+    N_("SafeAreas"),
+    N_("DisplayWindow"),
+    N_("Volume"),
+    N_("DataWindow"),
+    N_("UseLUT"),
+    N_("ShowBG"),
+    N_("ShowPixelRatio"),
+    N_("TimelineMax"),
+    N_("TimelineMaxDisplay"),
+    N_("TimelineMin"),
+    N_("TimelineMinDisplay"),
+    N_("VRCubic"),
+    N_("VRSpherical"),
+    N_("VRangle"),
+    N_("FullScreen"),
+    N_("PresentationMode"),
+    N_("ShiftAudio"),
+    N_("ShiftMediaStart"),
+    N_("ShiftMediaEnd"),
+    N_("CurrentReel"),
+    N_("ReplaceImage"),
+    N_("RemoveImage"),
+    N_("AudioStream"),
+    N_("CloneImage"),
+    N_("InsertImage"),
+    N_("ChangeImage"),
+    N_("ClearCache"),
+    N_("CurrentImage"),
+    N_("ExchangeImage"),
+    N_("FGReel"),
+    N_("BGReel"),
+    N_("CurrentBGImage"),
+    N_("TextureFiltering"),
+    N_("sync_image"),
+    N_("stop"),
+    N_("playfwd"),
+    N_("playback"),
+    N_("seek"),
+    N_("MediaInfoWindow"),
+    N_("ColorInfoWindow"),
+    N_("ColorControlWindow"),
+    N_("GL3dView"),
+    N_("StereoOptions"),
+    N_("StereoOutput"),
+    N_("StereoInput"),
+    N_("PaintTools"),
+    N_("HistogramWindow"),
+    N_("VectorscopeWindow"),
+    N_("WaveformWindow"),
+    N_("clock_ping"),
+    N_("clock_pong"),
+    N_("playhead"),
+};
+
+// Commands that set absolute state, of which only the latest queued one
+// is sent.
+const char* const kCoalesced[] = {
+    N_("seek"),
+    N_("Zoom"),
+    N_("Selection"),
+    N_("Offset"),
+    N_("Rotation"),
+    N_("Spin"),
+    N_("Gain"),
+    N_("Gamma"),
+    N_("Volume"),
+    NULL
+};
+
+// Messages queued within this time are sent together.
+const long kBatchDelay = 16;  // milliseconds, about one frame
+
+// Binary frames are a 4 byte length of the rest, a 2 byte command and
+// the command's arguments as text.  Unknown commands go whole as
+// arguments of kNetUnknown.
+const size_t kFrameHeader = 4;
+const size_t kMaxFrame = 64 * 1024 * 1024;
+
+// Peers' clocks are sampled quickly at first, then now and then to
+// follow their drift.
+const long kClockBurst = 100;      // milliseconds
+const long kClockInterval = 2000;  // milliseconds
+
+std::string command_of( const std::string& m )
+{
+    return m.substr( 0, m.find( ' ' ) );
+}
+
+typedef boost::unordered_map< std::string, mrv::Parser::Command > CommandMap;
+
+CommandMap command_map()
+{
+    CommandMap r;
+    for ( int i = mrv::Parser::kNetUnknown + 1;
+          i < mrv::Parser::kNetLastCommand; ++i )
+        r[ kCommandNames[i] ] = (mrv::Parser::Command) i;
+    return r;
+}
+
 }
 
 
@@ -107,12 +255,19 @@ namespace mrv {
 
 typedef CMedia::Mutex Mutex;
 
+bool Parser::binary_sync = true;
+
 Parser::Parser( boost::asio::io_service& io_service, ViewerUI* v ) :
     connected( false ),
+    binary_in( false ),
+    binary_out( false ),
+    binary_queued( false ),
     socket_( io_service ),
     ui( v ),
     deadline_(io_service),
-    non_empty_output_queue_(io_service)
+    non_empty_output_queue_(io_service),
+    clock_timer_(io_service),
+    clock_pings_( 0 )
 {
 }
 
@@ -122,6 +277,262 @@ Parser::~Parser()
     ui = NULL;
 }
 
+Parser::Command Parser::command( const std::string& name )
+{
+    static const CommandMap commands = command_map();
+
+    CommandMap::const_iterator i = commands.find( name );
+    if ( i == commands.end() ) return kNetUnknown;
+    return i->second;
+}
+
+const char* Parser::command_name( const Command c )
+{
+    if ( c <= kNetUnknown || c >= kNetLastCommand ) return "";
+    return kCommandNames[c];
+}
+
+void Parser::queue( const std::string& m )
+{
+    SCOPED_LOCK( mtx );
+
+    const std::string cmd = command_of( m );
+    for ( const char* const* k = kCoalesced; *k; ++k )
+    {
+        if ( cmd != *k ) continue;
+
+        std::deque< std::string >::iterator i = output_queue_.begin();
+        for ( ; i != output_queue_.end(); ++i )
+        {
+            if ( command_of( *i ) != cmd ) continue;
+            output_queue_.erase( i );
+            break;
+        }
+        break;
+    }
+
+    if ( output_queue_.empty() )
+    {
+        // Wake the output actor, which waits until the batch is due.
+        batch_time_ = deadline_timer::traits_type::now() +
+                      boost::posix_time::milliseconds( kBatchDelay );
+        non_empty_output_queue_.expires_at( batch_time_ );
+    }
+    output_queue_.push_back( m );
+
+    // Clock samples are only good if sent right away.
+    if ( cmd == kCommandNames[kNetClockPing] ||
+         cmd == kCommandNames[kNetClockPong] )
+    {
+        batch_time_ = deadline_timer::traits_type::now();
+        non_empty_output_queue_.expires_at( batch_time_ );
+    }
+}
+
+bool Parser::batch_due() const
+{
+    return deadline_timer::traits_type::now() >= batch_time_;
+}
+
+bool Parser::take_batch()
+{
+    SCOPED_LOCK( mtx );
+
+    if ( output_queue_.empty() ) return false;
+
+    output_batch_.clear();
+    std::deque< std::string >::const_iterator i = output_queue_.begin();
+    for ( ; i != output_queue_.end(); ++i )
+    {
+        const std::string& m = *i;
+        if ( !binary_out )
+        {
+            output_batch_ += m;
+            output_batch_ += '\n';
+
+            // Everything after this line goes in binary frames.
+            if ( m == N_("binary") ) binary_out = true;
+            continue;
+        }
+
+        Command c = command( command_of( m ) );
+        std::string args;
+        if ( c == kNetUnknown )
+            args = m;
+        else if ( m.size() > command_of( m ).size() )
+            args = m.substr( command_of( m ).size() + 1 );
+
+        const boost::uint32_t len = boost::uint32_t( 2 + args.size() );
+        char header[kFrameHeader + 2];
+        header[0] = char( ( len >> 24 ) & 0xff );
+        header[1] = char( ( len >> 16 ) & 0xff );
+        header[2] = char( ( len >> 8 ) & 0xff );
+        header[3] = char( len & 0xff );
+        header[4] = char( ( c >> 8 ) & 0xff );
+        header[5] = char( c & 0xff );
+        output_batch_.append( header, sizeof(header) );
+        output_batch_ += args;
+    }
+    output_queue_.clear();
+    return true;
+}
+
+bool Parser::handshake( const std::string& m )
+{
+    if ( m == N_("binary_offer") )
+    {
+        LOG_CONN( _("Peer syncs with binary frames.") );
+        binary_queued = true;
+        queue( N_("binary") );
+        return true;
+    }
+    if ( m == N_("binary") )
+    {
+        binary_in = true;
+        if ( !binary_queued )
+        {
+            LOG_CONN( _("Peer syncs with binary frames.") );
+            binary_queued = true;
+            queue( N_("binary") );
+        }
+        return true;
+    }
+    return false;
+}
+
+bool Parser::clock_message( const std::string& m )
+{
+    const boost::int64_t now = Timer::now();
+
+    const std::string cmd = command_of( m );
+    const Command c = command( cmd );
+    if ( c != kNetClockPing && c != kNetClockPong ) return false;
+
+    std::istringstream is( m.substr( cmd.size() ) );
+    is.imbue(std::locale("C"));
+
+    boost::int64_t t0 = 0, t1 = 0, t2 = 0;
+    if ( c == kNetClockPing )
+    {
+        if ( !( is >> t0 ) ) return true;
+
+        char buf[128];
+        sprintf( buf, N_("clock_pong %" PRId64 " %" PRId64 " %" PRId64),
+                 t0, now, Timer::now() );
+        queue( buf );
+        return true;
+    }
+
+    if ( !( is >> t0 >> t1 >> t2 ) ) return true;
+
+    const bool first = ( clock_.samples() == SyncClock::kSamples - 1 );
+    clock_.sample( t0, t1, t2, now );
+    if ( first )
+        LOG_INFO( _("Peer's clock is ") << clock_.offset() / 1000.0
+                  << _(" ms ahead, round trip ")
+                  << clock_.round_trip() / 1000.0 << _(" ms.") );
+    return true;
+}
+
+void Parser::ping_clock()
+{
+    ++clock_pings_;
+
+    char buf[64];
+    sprintf( buf, N_("clock_ping %" PRId64), Timer::now() );
+    queue( buf );
+}
+
+boost::posix_time::time_duration Parser::clock_interval() const
+{
+    if ( clock_.samples() < SyncClock::kSamples )
+        return boost::posix_time::milliseconds( kClockBurst );
+    return boost::posix_time::milliseconds( kClockInterval );
+}
+
+bool Parser::clock_unanswered() const
+{
+    return clock_pings_ >= SyncClock::kSamples && !clock_.synced();
+}
+
+void Parser::local_time( std::string& m ) const
+{
+    const std::string cmd = command_of( m );
+    const Command c = command( cmd );
+    if ( c != kNetPlayForwards && c != kNetPlayBackwards &&
+         c != kNetPlayhead ) return;
+
+    std::istringstream is( m.substr( cmd.size() ) );
+    is.imbue(std::locale("C"));
+
+    boost::int64_t t, f;
+    if ( !( is >> t >> f ) ) return;
+
+    // 0 if we do not know the peer's clock yet.
+    if ( t != 0 ) t = clock_.synced() ? clock_.to_local( t ) : 0;
+
+    char buf[128];
+    sprintf( buf, "%s %" PRId64 " %" PRId64, cmd.c_str(), t, f );
+    m = buf;
+}
+
+size_t Parser::bytes_missing() const
+{
+    if ( !binary_in ) return 0;
+
+    const size_t size = input_buffer_.size();
+    if ( size < kFrameHeader ) return kFrameHeader - size;
+
+    const unsigned char* p = boost::asio::buffer_cast< const unsigned char* >(
+                             input_buffer_.data() );
+    const size_t len = ( size_t(p[0]) << 24 ) | ( size_t(p[1]) << 16 ) |
+                       ( size_t(p[2]) << 8 ) | size_t(p[3]);
+    if ( size >= kFrameHeader + len ) return 0;
+    return kFrameHeader + len - size;
+}
+
+bool Parser::next_message( std::string& m )
+{
+    const size_t size = input_buffer_.size();
+    const char* p = boost::asio::buffer_cast< const char* >(
+                    input_buffer_.data() );
+
+    if ( !binary_in )
+    {
+        const char* nl = (const char*) memchr( p, '\n', size );
+        if ( !nl ) return false;
+        m.assign( p, nl - p );
+        input_buffer_.consume( nl - p + 1 );
+        return true;
+    }
+
+    if ( size < kFrameHeader ) return false;
+
+    const unsigned char* u = (const unsigned char*) p;
+    const size_t len = ( size_t(u[0]) << 24 ) | ( size_t(u[1]) << 16 ) |
+                       ( size_t(u[2]) << 8 ) | size_t(u[3]);
+    if ( len < 2 || len > kMaxFrame )
+    {
+        LOG_ERROR( _("Bad frame from peer, length ") << len );
+        socket_.close();
+        return false;
+    }
+    if ( size < kFrameHeader + len ) return false;
+
+    const Command c = (Command) ( ( unsigned(u[4]) << 8 ) | unsigned(u[5]) );
+    const std::string args( p + kFrameHeader + 2, len - 2 );
+    input_buffer_.consume( kFrameHeader + len );
+
+    if ( c == kNetUnknown )
+        m = args;
+    else
+    {
+        m = command_name( c );
+        if ( !args.empty() ) m += ' ' + args;
+    }
+    return true;
+}
+
 void Parser::write( const std::string& s, const std::string& id )
 {
     if ( !connected || !ui || !ui->uiView ) {
@@ -130,6 +541,9 @@ void Parser::write( const std::string& s, const std::string& id )
 
     mrv::ImageView* v = view();
 
+    // Only peers that answer our clock know where a playhead is.
+    const bool timed = ( command( command_of( s ) ) == kNetPlayhead );
+
     Mutex& m = v->_clients_mtx;
     SCOPED_LOCK( m );
 
@@ -141,6 +555,7 @@ void Parser::write( const std::string& s, const std::string& id )
         try
         {
             if ( !(*i)->socket_.is_open() ) continue;
+            if ( timed && !(*i)->clock_.synced() ) continue;
             std::string p = boost::lexical_cast<std::string>( (*i)->socket_.remote_endpoint() );
 
             if ( p == id )
@@ -180,6 +595,31 @@ mrv::EDLGroup* Parser::edl_group() const
     return ui->uiEDLWindow->uiEDLGroup;
 }
 
+/**
+ * Read the time and frame a peer started playback at, if sent, and
+ * follow it.
+ *
+ * @param is   stream of the playfwd or playback message
+ * @param v    our view
+ * @param step direction of playback
+ *
+ * @return frame the peer is at now, or AV_NOPTS_VALUE if not sent
+ */
+static int64_t follow_leader( std::istream& is, const ImageView* v,
+                              const int step )
+{
+    int64_t t = 0, f = 0;
+    if ( !( is >> t >> f ) ) return AV_NOPTS_VALUE;
+
+    // Peer's clock is not known yet.  Just start at the same frame.
+    if ( t == 0 ) return f;
+
+    SeatSync& seats = SeatSync::instance();
+    seats.reference( f, t, v->fps(), step );
+    seats.frame_at( Timer::now(), f );
+    return f;
+}
+
 bool Parser::parse( const std::string& s )
 {
     if ( !connected || !ui || !ui->uiView ) return false;
@@ -189,9 +629,6 @@ bool Parser::parse( const std::string& s )
 
     typedef CMedia::Mutex Mutex;
 
-    Mutex& mtx = v->commands_mutex;
-    SCOPED_LOCK( mtx );
-
     std::istringstream is( s );
 
     // Set locale globally to user locale
@@ -202,15 +639,26 @@ bool Parser::parse( const std::string& s )
     //     std::locale::global( std::locale(env) );
     is.imbue(std::locale("C"));
 
+    std::string cmd;
+    is >> cmd;
+
+    // Unknown commands are dropped before taking any lock.
+    const Command id = command( cmd );
+    if ( id == kNetUnknown )
+    {
+        LOG_ERROR( "Parsing failed for "  << s );
+        return false;
+    }
+
+    Mutex& mtx = v->commands_mutex;
+    SCOPED_LOCK( mtx );
+
     char* oldloc = av_strdup( setlocale( LC_NUMERIC, NULL ) );
     setlocale( LC_NUMERIC, "C" );
 
 
     mrv::Reel r;
 
-    std::string cmd;
-    is >> cmd;
-
     bool ok = false;
 
 
@@ -222,7 +670,9 @@ bool Parser::parse( const std::string& s )
 
     NET( "Received: " << s );
 
-    if ( cmd == N_("GLPathShape") )
+    switch( id )
+    {
+    case kNetGLPathShape:
     {
         Point xy;
         std::string points;
@@ -240,7 +690,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("GLArrowShape") )
+    break;
+    case kNetGLArrowShape:
     {
         Point xy;
         std::string points;
@@ -258,7 +709,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("GLRectangleShape") )
+    break;
+    case kNetGLRectangleShape:
     {
         Point xy;
         std::string points;
@@ -276,7 +728,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("GLCircleShape") )
+    break;
+    case kNetGLCircleShape:
     {
         Point xy;
         std::string points;
@@ -292,7 +745,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("GLErasePathShape") )
+    break;
+    case kNetGLErasePathShape:
     {
         Point xy;
         std::string points;
@@ -310,7 +764,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("GLTextShape") )
+    break;
+    case kNetGLTextShape:
     {
         Point xy;
         std::string font, text;
@@ -398,21 +853,24 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("GhostPrevious") )
+    break;
+    case kNetGhostPrevious:
     {
         short x;
         is >> x;
         v->ghost_previous( x );
         ok = true;
     }
-    else if ( cmd == N_("GhostNext") )
+    break;
+    case kNetGhostNext:
     {
         short x;
         is >> x;
         v->ghost_next( x );
         ok = true;
     }
-    else if ( cmd == N_("FPS") )
+    break;
+    case kNetFPS:
     {
         double fps;
         is >> fps;
@@ -421,7 +879,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("EDL") )
+    break;
+    case kNetEDL:
     {
         int b;
         is >> b;
@@ -431,7 +890,8 @@ bool Parser::parse( const std::string& s )
             browser()->clear_edl();
         ok = true;
     }
-    else if ( cmd == N_("Looping") )
+    break;
+    case kNetLooping:
     {
         int i;
         is >> i;
@@ -439,7 +899,8 @@ bool Parser::parse( const std::string& s )
         v->looping( (CMedia::Looping)i );
         ok = true;
     }
-    else if ( cmd == N_("Selection") )
+    break;
+    case kNetSelection:
     {
         double x, y, w, h;
         is >> x >> y >> w >> h;
@@ -447,24 +908,28 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("UndoDraw") )
+    break;
+    case kNetUndoDraw:
     {
         v->undo_draw();
         ok = true;
     }
-    else if ( cmd == N_("RedoDraw") )
+    break;
+    case kNetRedoDraw:
     {
         v->redo_draw();
         ok = true;
     }
-    else if ( cmd == N_("FitImage") )
+    break;
+    case kNetFitImage:
     {
         ImageView::Command c;
         c.type = ImageView::kFitImage;
         v->commands.push_back( c );
         ok = true;
     }
-    else if ( cmd == N_("Zoom") )
+    break;
+    case kNetZoom:
     {
         float z;
         is >> z;
@@ -476,7 +941,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("Rotate") )
+    break;
+    case kNetRotate:
     {
         float x;
         is >> x;
@@ -488,7 +954,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("Rotation") )
+    break;
+    case kNetRotation:
     {
         double x, y;
         is >> x >> y;
@@ -497,7 +964,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("Spin") )
+    break;
+    case kNetSpin:
     {
         double x, y;
         is >> x >> y;
@@ -506,7 +974,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("Offset") )
+    break;
+    case kNetOffset:
     {
         double x, y;
         is >> x >> y;
@@ -515,7 +984,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("MovePicture") )
+    break;
+    case kNetMovePicture:
     {
         double x, y;
         is >> x >> y;
@@ -527,7 +997,8 @@ bool Parser::parse( const std::string& s )
             ok = true;
         }
     }
-    else if ( cmd == N_("ScalePicture") )
+    break;
+    case kNetScalePicture:
     {
         double x, y;
         is >> x >> y;
@@ -539,7 +1010,8 @@ bool Parser::parse( const std::string& s )
             ok = true;
         }
     }
-    else if ( cmd == N_("HBCSActive") )
+    break;
+    case kNetHBCSActive:
     {
         int t;
         is >> t;
@@ -547,7 +1019,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("Hue") )
+    break;
+    case kNetHue:
     {
         float f;
         is >> f;
@@ -555,7 +1028,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("Brightness") )
+    break;
+    case kNetBrightness:
     {
         float f;
         is >> f;
@@ -563,7 +1037,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("Contrast") )
+    break;
+    case kNetContrast:
     {
         float f;
         is >> f;
@@ -571,7 +1046,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("Saturation") )
+    break;
+    case kNetSaturation:
     {
         float f;
         is >> f;
@@ -579,12 +1055,14 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("UpdateLayers") )
+    break;
+    case kNetUpdateLayers:
     {
         v->update_layers();
         ok = true;
     }
-    else if ( cmd == N_("Channel") )
+    break;
+    case kNetChannel:
     {
         unsigned short ch;
         std::string name;
@@ -598,7 +1076,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("FieldDisplay") )
+    break;
+    case kNetFieldDisplay:
     {
         int field;
         is >> field;
@@ -606,7 +1085,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("Normalize") )
+    break;
+    case kNetNormalize:
     {
         int b;
         is >> b;
@@ -615,7 +1095,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("WipeVertical") )
+    break;
+    case kNetWipeVertical:
     {
         float b;
         is >> b;
@@ -624,7 +1105,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("WipeHorizontal") )
+    break;
+    case kNetWipeHorizontal:
     {
         float b;
         is >> b;
@@ -633,14 +1115,16 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("NoWipe") )
+    break;
+    case kNetNoWipe:
     {
         v->wipe_direction( ImageView::kNoWipe );
         v->wipe_amount( 0.0f );
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("OCIO") )
+    break;
+    case kNetOCIO:
     {
         bool t;
         is >> t;
@@ -657,7 +1141,8 @@ bool Parser::parse( const std::string& s )
         }
         ok = true;
     }
-    else if ( cmd == N_("OCIOConfig") )
+    break;
+    case kNetOCIOConfig:
     {
         std::string s;
         is.clear();
@@ -680,7 +1165,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("OCIOView") )
+    break;
+    case kNetOCIOView:
     {
         std::string d, s;
         is.clear();
@@ -702,7 +1188,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("ICS") )
+    break;
+    case kNetICS:
     {
         std::string s;
         is.clear();
@@ -719,7 +1206,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("Gain") )
+    break;
+    case kNetGain:
     {
         float f;
         is >> f;
@@ -727,7 +1215,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("Gamma") )
+    break;
+    case kNetGamma:
     {
         float f;
         is >> f;
@@ -735,7 +1224,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("Mask") )
+    break;
+    case kNetMask:
     {
         float b;
         is >> b;
@@ -743,7 +1233,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("SafeAreas") )
+    break;
+    case kNetSafeAreas:
     {
         int b;
         is >> b;
@@ -751,7 +1242,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("DisplayWindow") )
+    break;
+    case kNetDisplayWindow:
     {
         int b;
         is >> b;
@@ -759,7 +1251,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("Volume") )
+    break;
+    case kNetVolume:
     {
         float b;
         is >> b;
@@ -767,7 +1260,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("DataWindow") )
+    break;
+    case kNetDataWindow:
     {
         int b;
         is >> b;
@@ -775,7 +1269,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("UseLUT") )
+    break;
+    case kNetUseLUT:
     {
         int b;
         is >> b;
@@ -784,7 +1279,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("ShowBG") )
+    break;
+    case kNetShowBG:
     {
         int b;
         is >> b;
@@ -792,7 +1288,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("ShowPixelRatio") )
+    break;
+    case kNetShowPixelRatio:
     {
         int b;
         is >> b;
@@ -800,7 +1297,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("TimelineMax") )
+    break;
+    case kNetTimelineMax:
     {
         double x;
         is >> x;
@@ -810,7 +1308,8 @@ bool Parser::parse( const std::string& s )
         c.frame = (int64_t) x;
         ok = true;
     }
-    else if ( cmd == N_("TimelineMaxDisplay") )
+    break;
+    case kNetTimelineMaxDisplay:
     {
         double x;
         is >> x;
@@ -820,7 +1319,8 @@ bool Parser::parse( const std::string& s )
         c.frame = (int64_t) x;
         ok = true;
     }
-    else if ( cmd == N_("TimelineMin") )
+    break;
+    case kNetTimelineMin:
     {
         double x;
         is >> x;
@@ -831,7 +1331,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("TimelineMinDisplay") )
+    break;
+    case kNetTimelineMinDisplay:
     {
         double x;
         is >> x;
@@ -840,7 +1341,8 @@ bool Parser::parse( const std::string& s )
         c.frame = (int64_t) x;
         ok = true;
     }
-    else if ( cmd == N_("VRCubic") )
+    break;
+    case kNetVRCubic:
     {
         bool t;
         is >> t;
@@ -851,7 +1353,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("VRSpherical") )
+    break;
+    case kNetVRSpherical:
     {
         bool t;
         is >> t;
@@ -862,7 +1365,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("VRangle") )
+    break;
+    case kNetVRAngle:
     {
         float t;
         is >> t;
@@ -870,7 +1374,8 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
-    else if ( cmd == N_("FullScreen") )
+    break;
+    case kNetFullScreen:
     {
         int on;
         is >> on;
@@ -879,7 +1384,8 @@ bool Parser::parse( const std::string& s )
         v->commands.push_back( c );
         ok = true;
     }
-    else if ( cmd == N_("PresentationMode" ) )
+    break;
+    case kNetPresentationMode:
     {
         int on;
         is >> on;
@@ -888,7 +1394,8 @@ bool Parser::parse( const std::string& s )
         v->commands.push_back( c );
         ok = true;
     }
-    else if ( cmd == N_("ShiftAudio") )
+    break;
+    case kNetShiftAudio:
     {
         int reel;
         is >> reel;
@@ -906,7 +1413,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("ShiftMediaStart") )
+    break;
+    case kNetShiftMediaStart:
     {
         int reel;
         is >> reel;
@@ -924,7 +1432,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("ShiftMediaEnd") )
+    break;
+    case kNetShiftMediaEnd:
     {
         int reel;
         is >> reel;
@@ -942,7 +1451,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("CurrentReel") )
+    break;
+    case kNetCurrentReel:
     {
         std::string name;
         is.clear();
@@ -959,7 +1469,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("ReplaceImage") )
+    break;
+    case kNetReplaceImage:
     {
         int idx;
         is >> idx;
@@ -982,7 +1493,8 @@ bool Parser::parse( const std::string& s )
             ok = true;
         }
     }
-    else if ( cmd == N_("RemoveImage") )
+    break;
+    case kNetRemoveImage:
     {
         int idx;
         is >> idx;
@@ -995,7 +1507,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("AudioStream") )
+    break;
+    case kNetAudioStream:
     {
         unsigned idx;
         is >> idx;
@@ -1004,7 +1517,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("CloneImage") )
+    break;
+    case kNetCloneImage:
     {
         std::string imgname;
         is.clear();
@@ -1037,7 +1551,8 @@ bool Parser::parse( const std::string& s )
             }
         }
     }
-    else if ( cmd == N_("InsertImage") )
+    break;
+    case kNetInsertImage:
     {
         int idx;
         is >> idx;
@@ -1056,8 +1571,8 @@ bool Parser::parse( const std::string& s )
         v->commands.push_back( c );
         ok = true;
     }
-    else
-        if ( cmd == N_("ChangeImage") )
+    break;
+    case kNetChangeImage:
     {
         int idx;
         is >> idx;
@@ -1071,7 +1586,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("ClearCache") )
+    break;
+    case kNetClearCache:
     {
 
         ImageView::Command c;
@@ -1082,7 +1598,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("CurrentImage") )
+    break;
+    case kNetCurrentImage:
     {
         int idx = 0;
         std::string imgname;
@@ -1107,7 +1624,8 @@ bool Parser::parse( const std::string& s )
         ok = true;
 
     }
-    else if ( cmd == N_("ExchangeImage") )
+    break;
+    case kNetExchangeImage:
     {
         int oldsel, sel;
         is >> oldsel;
@@ -1122,7 +1640,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("FGReel") )
+    break;
+    case kNetFGReel:
     {
         int idx;
         is >> idx;
@@ -1137,7 +1656,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("BGReel") )
+    break;
+    case kNetBGReel:
     {
         int idx;
         is >> idx;
@@ -1152,7 +1672,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("CurrentBGImage") )
+    break;
+    case kNetCurrentBGImage:
     {
         std::string imgname;
         is.clear();
@@ -1206,14 +1727,16 @@ bool Parser::parse( const std::string& s )
         }
         v->redraw();
     }
-    else if ( cmd == N_("TextureFiltering") )
+    break;
+    case kNetTextureFiltering:
     {
         int f;
         is >> f;
         v->texture_filtering( (ImageView::TextureFiltering) f );
         ok = true;
     }
-    else if ( cmd == N_("sync_image") )
+    break;
+    case kNetSyncImage:
     {
         std::string cmd;
         char buf[1024];
@@ -1490,11 +2013,14 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("stop") )
+    break;
+    case kNetStop:
     {
         int64_t f;
         is >> f;
 
+        SeatSync::instance().clear();
+
         {
             ImageView::Command c;
             c.type = ImageView::kStopVideo;
@@ -1506,23 +2032,28 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("playfwd") )
+    break;
+    case kNetPlayForwards:
     {
         ImageView::Command c;
         c.type = ImageView::kPlayForwards;
+        c.frame = follow_leader( is, v, 1 );
 
         v->commands.push_back( c );
         ok = true;
     }
-    else if ( cmd == N_("playback") )
+    break;
+    case kNetPlayBackwards:
     {
         ImageView::Command c;
         c.type = ImageView::kPlayBackwards;
+        c.frame = follow_leader( is, v, -1 );
 
         v->commands.push_back( c );
         ok = true;
     }
-    else if ( cmd == N_("seek") )
+    break;
+    case kNetSeek:
     {
         int64_t f;
         is >> f;
@@ -1557,7 +2088,8 @@ bool Parser::parse( const std::string& s )
 
         ok = true;
     }
-    else if ( cmd == N_("MediaInfoWindow") )
+    break;
+    case kNetMediaInfoWindow:
     {
         int x;
         is >> x;
@@ -1574,7 +2106,8 @@ bool Parser::parse( const std::string& s )
         v->commands.push_back( c );
         ok = true;
     }
-    else if ( cmd == N_("ColorInfoWindow") )
+    break;
+    case kNetColorInfoWindow:
     {
         int x;
         is >> x;
@@ -1591,7 +2124,8 @@ bool Parser::parse( const std::string& s )
         v->commands.push_back( c );
         ok = true;
     }
-    else if ( cmd == N_("ColorControlWindow") )
+    break;
+    case kNetColorControlWindow:
     {
         int x;
         is >> x;
@@ -1608,7 +2142,8 @@ bool Parser::parse( const std::string& s )
         v->commands.push_back( c );
         ok = true;
     }
-    else if ( cmd == N_("GL3dView") )
+    break;
+    case kNetGL3dView:
     {
         int x;
         is >> x;
@@ -1625,7 +2160,8 @@ bool Parser::parse( const std::string& s )
         v->commands.push_back( c );
         ok = true;
     }
-    else if ( cmd == N_("StereoOptions") )
+    break;
+    case kNetStereoOptions:
     {
         int x;
         is >> x;
@@ -1642,21 +2178,24 @@ bool Parser::parse( const std::string& s )
         v->commands.push_back( c );
         ok = true;
     }
-    else if ( cmd == N_("StereoOutput") )
+    break;
+    case kNetStereoOutput:
     {
         int x;
         is >> x;
         v->stereo_output( (CMedia::StereoOutput) x );
         ok = true;
     }
-    else if ( cmd == N_("StereoInput") )
+    break;
+    case kNetStereoInput:
     {
         int x;
         is >> x;
         v->stereo_input( (CMedia::StereoInput) x );
         ok = true;
     }
-    else if ( cmd == N_("PaintTools") )
+    break;
+    case kNetPaintTools:
     {
         int x;
         is >> x;
@@ -1673,7 +2212,8 @@ bool Parser::parse( const std::string& s )
         v->commands.push_back( c );
         ok = true;
     }
-    else if ( cmd == N_("HistogramWindow") )
+    break;
+    case kNetHistogramWindow:
     {
         int x;
         is >> x;
@@ -1690,7 +2230,8 @@ bool Parser::parse( const std::string& s )
         v->commands.push_back( c );
         ok = true;
     }
-    else if ( cmd == N_("VectorscopeWindow") )
+    break;
+    case kNetVectorscopeWindow:
     {
         int x;
         is >> x;
@@ -1707,7 +2248,8 @@ bool Parser::parse( const std::string& s )
         v->commands.push_back( c );
         ok = true;
     }
-    else if ( cmd == N_("WaveformWindow") )
+    break;
+    case kNetWaveformWindow:
     {
         int x;
         is >> x;
@@ -1724,6 +2266,23 @@ bool Parser::parse( const std::string& s )
         v->commands.push_back( c );
         ok = true;
     }
+    break;
+    case kNetPlayhead:
+    {
+        int64_t t = 0, f = 0;
+        is >> t >> f;
+
+        // Follow the seat leading playback, if we know its clock.
+        CMedia::Playback p = v->playback();
+        if ( t != 0 && p != CMedia::kStopped )
+            SeatSync::instance().reference( f, t, v->fps(),
+                                            p == CMedia::kBackwards ? -1 : 1 );
+        ok = true;
+    }
+    break;
+    default:
+        break;
+    }
 
     if (!ok) LOG_ERROR( "Parsing failed for "  << s );
 
@@ -1777,6 +2336,8 @@ void tcp_session::start()
 
     start_read();
 
+    check_clock( boost::system::error_code() );
+
     //	std::cerr << "start1: " << socket_.native_handle() << std::endl;
     // input_deadline_.async_wait(
     //                            boost::bind(&tcp_session::check_deadline,
@@ -1800,15 +2361,9 @@ bool tcp_session::stopped()
 
 void tcp_session::deliver( const std::string& msg )
 {
-    SCOPED_LOCK( mtx );
-
     LOG_INFO( "Server Deliver: " << msg );
 
-    output_queue_.push_back(msg + "\n");
-
-    // Signal that the output queue contains messages. Modifying the expiry
-    // will wake the output actor, if it is waiting on the timer.
-    non_empty_output_queue_.expires_from_now(boost::posix_time::seconds(0));
+    queue( msg );
 }
 
 
@@ -1817,6 +2372,7 @@ void tcp_session::stop()
     connected = false;
 
     deadline_.cancel();
+    clock_timer_.cancel();
     socket_.close();
     non_empty_output_queue_.cancel();
 
@@ -1858,11 +2414,19 @@ void tcp_session::start_read()
     // input_deadline_.expires_from_now(boost::posix_time::seconds(30));
     // input_deadline_.expires_at(boost::posix_time::pos_infin);
 
-    // Start an asynchronous operation to read a newline-delimited message.
-    boost::asio::async_read_until(
-        socket(), input_buffer_, '\n',
-        boost::bind( &tcp_session::handle_read, shared_from_this(),
-                     boost::asio::placeholders::error ) );
+    // Start an asynchronous operation to read a newline-delimited message
+    // or a binary frame.
+    size_t missing = bytes_missing();
+    if ( missing > 0 )
+        boost::asio::async_read(
+            socket(), input_buffer_, boost::asio::transfer_at_least( missing ),
+            boost::bind( &tcp_session::handle_read, shared_from_this(),
+                         boost::asio::placeholders::error ) );
+    else
+        boost::asio::async_read_until(
+            socket(), input_buffer_, '\n',
+            boost::bind( &tcp_session::handle_read, shared_from_this(),
+                         boost::asio::placeholders::error ) );
 }
 
 void tcp_session::handle_read(const boost::system::error_code& ec)
@@ -1872,17 +2436,12 @@ void tcp_session::handle_read(const boost::system::error_code& ec)
 
     if (!ec)
     {
-        // Extract the newline-delimited message from the buffer.
-        std::istream is(&input_buffer_);
-        is.exceptions( std::ifstream::failbit | std::ifstream::badbit |
-                       std::ifstream::eofbit );
-
         std::string id = boost::lexical_cast<std::string>(socket().remote_endpoint() );
 
         try {
+            // Handle all whole messages read.
             std::string msg;
-            is.clear();
-            if ( std::getline(is, msg) )
+            while ( next_message( msg ) )
             {
                 if ( msg == N_("OK") || msg.empty() )
                 {
@@ -1891,17 +2450,26 @@ void tcp_session::handle_read(const boost::system::error_code& ec)
                 {
                     LOG_CONN( N_("Not OK") );
                 }
-                else if ( parse( msg ) )
+                else if ( handshake( msg ) || clock_message( msg ) )
                 {
-                    // send message to all clients
-                    // We need to do this to update multiple clients.
-                    // Note that the original client that sent the
-                    // message will be skipped as it is IDed.
-                    write( msg, id );
                 }
                 else
                 {
-                    write( N_("Not OK"), "" );
+                    // Times are passed on in our clock.
+                    local_time( msg );
+
+                    if ( parse( msg ) )
+                    {
+                        // send message to all clients
+                        // We need to do this to update multiple clients.
+                        // Note that the original client that sent the
+                        // message will be skipped as it is IDed.
+                        write( msg, id );
+                    }
+                    else
+                    {
+                        write( N_("Not OK"), "" );
+                    }
                 }
             }
         }
@@ -1920,6 +2488,25 @@ void tcp_session::handle_read(const boost::system::error_code& ec)
     }
 }
 
+void tcp_session::check_clock( const boost::system::error_code& ec )
+{
+    if ( stopped() || ec == boost::asio::error::operation_aborted )
+        return;
+
+    if ( clock_unanswered() )
+    {
+        LOG_CONN( _("Peer does not sync clocks.") );
+        return;
+    }
+
+    ping_clock();
+
+    clock_timer_.expires_from_now( clock_interval() );
+    clock_timer_.async_wait( boost::bind( &tcp_session::check_clock,
+                                          shared_from_this(),
+                                          boost::asio::placeholders::error ) );
+}
+
 void tcp_session::await_output()
 {
 
@@ -1928,6 +2515,8 @@ void tcp_session::await_output()
 
 
     try {
+        SCOPED_LOCK( mtx );
+
         if (output_queue_.empty())
         {
             // There are no messages that are ready to be sent. The actor goes to
@@ -1941,6 +2530,15 @@ void tcp_session::await_output()
                             shared_from_this())
             );
         }
+        else if ( !batch_due() )
+        {
+            // Let more messages join the batch.
+            non_empty_output_queue_.expires_at( batch_time_ );
+            non_empty_output_queue_.async_wait(
+                boost::bind(&tcp_session::await_output,
+                            shared_from_this())
+            );
+        }
         else
         {
             start_write();
@@ -1956,9 +2554,11 @@ void tcp_session::start_write()
 {
     SCOPED_LOCK( mtx );
 
-    // Start an asynchronous operation to send a message.
+    take_batch();
+
+    // Start an asynchronous operation to send the queued messages.
     boost::asio::async_write(socket(),
-                             boost::asio::buffer(output_queue_.front()),
+                             boost::asio::buffer(output_batch_),
                              boost::bind(&tcp_session::handle_write,
                                          shared_from_this(),
                                          boost::asio::placeholders::error));
@@ -1971,8 +2571,6 @@ void tcp_session::handle_write(const boost::system::error_code& ec)
 
     if (!ec)
     {
-        output_queue_.pop_front();
-
         await_output();
     }
     else
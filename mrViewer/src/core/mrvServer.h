@@ -37,6 +37,7 @@
 #include <boost/asio/write.hpp>
 #include <boost/asio.hpp>
 
+#include "core/mrvSeatSync.h"
 #include "gui/mrvReel.h"
 
 class ViewerUI;
@@ -57,13 +58,158 @@ class Parser
   public:
     typedef boost::recursive_mutex Mutex;
 
+    // Commands understood by parse().  Binary frames carry these values,
+    // so new commands go at the end.
+    enum Command
+    {
+        kNetUnknown,
+        kNetGLPathShape,
+        kNetGLArrowShape,
+        kNetGLRectangleShape,
+        kNetGLCircleShape,
+        kNetGLErasePathShape,
+        kNetGLTextShape,
+        kNetGhostPrevious,
+        kNetGhostNext,
+        kNetFPS,
+        kNetEDL,
+        kNetLooping,
+        kNetSelection,
+        kNetUndoDraw,
+        kNetRedoDraw,
+        kNetFitImage,
+        kNetZoom,
+        kNetRotate,
+        kNetRotation,
+        kNetSpin,
+        kNetOffset,
+        kNetMovePicture,
+        kNetScalePicture,
+        kNetHBCSActive,
+        kNetHue,
+        kNetBrightness,
+        kNetContrast,
+        kNetSaturation,
+        kNetUpdateLayers,
+        kNetChannel,
+        kNetFieldDisplay,
+        kNetNormalize,
+        kNetWipeVertical,
+        kNetWipeHorizontal,
+        kNetNoWipe,
+        kNetOCIO,
+        kNetOCIOConfig,
+        kNetOCIOView,
+        kNetICS,
+        kNetGain,
+        kNetGamma,
+        kNetMask,
+        kNetSafeAreas,
+        kNetDisplayWindow,
+        kNetVolume,
+        kNetDataWindow,
+        kNetUseLUT,
+        kNetShowBG,
+        kNetShowPixelRatio,
+        kNetTimelineMax,
+        kNetTimelineMaxDisplay,
+        kNetTimelineMin,
+        kNetTimelineMinDisplay,
+        kNetVRCubic,
+        kNetVRSpherical,
+        kNetVRAngle,
+        kNetFullScreen,
+        kNetPresentationMode,
+        kNetShiftAudio,
+        kNetShiftMediaStart,
+        kNetShiftMediaEnd,
+        kNetCurrentReel,
+        kNetReplaceImage,
+        kNetRemoveImage,
+        kNetAudioStream,
+        kNetCloneImage,
+        kNetInsertImage,
+        kNetChangeImage,
+        kNetClearCache,
+        kNetCurrentImage,
+        kNetExchangeImage,
+        kNetFGReel,
+        kNetBGReel,
+        kNetCurrentBGImage,
+        kNetTextureFiltering,
+        kNetSyncImage,
+        kNetStop,
+        kNetPlayForwards,
+        kNetPlayBackwards,
+        kNetSeek,
+        kNetMediaInfoWindow,
+        kNetColorInfoWindow,
+        kNetColorControlWindow,
+        kNetGL3dView,
+        kNetStereoOptions,
+        kNetStereoOutput,
+        kNetStereoInput,
+        kNetPaintTools,
+        kNetHistogramWindow,
+        kNetVectorscopeWindow,
+        kNetWaveformWindow,
+        kNetClockPing,
+        kNetClockPong,
+        kNetPlayhead,
+        kNetLastCommand
+    };
+
   public:
     Parser( boost::asio::io_service& io_service, ViewerUI* v );
     virtual ~Parser();
 
+    static Command command( const std::string& name );
+    static const char* command_name( const Command c );
+
     bool parse( const std::string& m );
     void write( const std::string& s, const std::string& id );
 
+    // Queue a message to this peer.  Absolute state changes (seek, zoom,
+    // selection...) replace an older one still queued, and messages are
+    // sent in batches, at most one per kBatchDelay.
+    void queue( const std::string& m );
+
+    // Handle the switch to binary frames.  Returns true if m was part
+    // of it.
+    bool handshake( const std::string& m );
+
+    // Take next whole message out of input_buffer_.
+    bool next_message( std::string& m );
+
+    // Bytes to read before next_message() may find one, or 0 if reading
+    // up to a newline.
+    size_t bytes_missing() const;
+
+    // Move queued messages to output_batch_, encoded for the peer.
+    // Returns false if there were none.
+    bool take_batch();
+
+    // Whether a batch is due for writing.
+    bool batch_due() const;
+
+    // Answer or take a sample of the peer's clock.  Returns true if m
+    // was one.
+    bool clock_message( const std::string& m );
+
+    // Send our time to the peer, for it to answer with its own.
+    void ping_clock();
+
+    // Time until next ping_clock().  Short until the clock is known.
+    boost::posix_time::time_duration clock_interval() const;
+
+    // Whether the peer never answered our pings, as older versions.
+    bool clock_unanswered() const;
+
+    // Turn the time of the peer's clock in playfwd, playback and
+    // playhead messages into one of ours, so it can be passed on to
+    // other peers.
+    void local_time( std::string& m ) const;
+
     mrv::ImageView* view() const;
     mrv::ImageBrowser* browser() const;
     mrv::EDLGroup*     edl_group() const;
@@ -72,8 +218,14 @@ class Parser
     virtual void stop() = 0;
 
 
+    // Clients offer binary frames to servers when connecting.
+    static bool binary_sync;
+
   public:
     bool connected;
+    bool binary_in;      //!< peer sends binary frames
+    bool binary_out;     //!< we send binary frames
+    bool binary_queued;  //!< we queued the switch to binary frames
     tcp::socket socket_;
     Mutex mtx;
     mrv::Reel r;
@@ -81,7 +233,12 @@ class Parser
     boost::asio::streambuf input_buffer_;
     deadline_timer deadline_;
     deadline_timer non_empty_output_queue_;
+    deadline_timer clock_timer_;
+    boost::posix_time::ptime batch_time_;  //!< when queued batch is due
     std::deque< std::string > output_queue_;
+    std::string output_batch_;             //!< messages being written
+    SyncClock clock_;                      //!< estimate of peer's clock
+    unsigned clock_pings_;                 //!< pings sent
 };
 
 
@@ -101,6 +258,7 @@ class tcp_session : public Parser,
      void start_read();
      void handle_read(const boost::system::error_code& ec);
      void await_output();
+     void check_clock( const boost::system::error_code& ec );
 
      virtual void deliver( const std::string& m );
 
@@ -56,9 +56,11 @@
 //
 //----------------------------------------------------------------------------
 
+#include <time.h>
+#include <thread>
+
 #include "core/mrvFrame.h"
 #include <mrvTimer.h>
-#include <time.h>
 
 #ifdef _WIN32
 
@@ -77,8 +79,26 @@ int gettimeofday (struct timeval *tv, void *tz)
   }
 #endif
 
+namespace {
+
+// Wait this long before the frame is due spinning instead of sleeping.
+const std::chrono::microseconds kSpinTime( 2000 );
+
+inline double seconds( const mrv::Timer::Clock::duration& d )
+{
+    return std::chrono::duration<double>( d ).count();
+}
+
+}
+
 namespace mrv {
 
+boost::int64_t Timer::now()
+{
+    return std::chrono::duration_cast< std::chrono::microseconds >(
+           Clock::now().time_since_epoch() ).count();
+}
+
 Timer::Timer ():
   playState( CMedia::kForwards ),
   _spf (1 / 24.0),
@@ -86,7 +106,8 @@ Timer::Timer ():
   _framesSinceLastFpsFrame (0),
   _actualFrameRate (0)
 {
-  gettimeofday (&_lastFrameTime, 0);
+  _lastFrameTime = Clock::now();
+  _targetTime = _lastFrameTime;
   _lastFpsFrameTime = _lastFrameTime;
 #if 0 // def OSX
   osx_latencycritical_start();
@@ -99,6 +120,30 @@ Timer::Timer ():
   osx_latencycritical_end();
 #endif
     }
+
+boost::int64_t Timer::targetTime() const
+{
+    return std::chrono::duration_cast< std::chrono::microseconds >(
+           _targetTime.time_since_epoch() ).count();
+}
+
+boost::int64_t Timer::frameTime() const
+{
+    return std::chrono::duration_cast< std::chrono::microseconds >(
+           _lastFrameTime.time_since_epoch() ).count();
+}
+
+void
+Timer::sleepUntil( const Clock::time_point& t )
+{
+    const Clock::time_point wake = t - kSpinTime;
+    if ( Clock::now() < wake )
+        std::this_thread::sleep_until( wake );
+
+    while ( Clock::now() < t )
+        std::this_thread::yield();
+}
+
 void
 Timer::waitUntilNextFrameIsDue ()
 {
@@ -109,7 +154,8 @@ Timer::waitUntilNextFrameIsDue ()
       // variables and return without waiting.
       //
 
-      gettimeofday (&_lastFrameTime, 0);
+      _lastFrameTime = Clock::now();
+      _targetTime = _lastFrameTime;
       _timingError = 0;
       _lastFpsFrameTime = _lastFrameTime;
       _framesSinceLastFpsFrame = 0;
@@ -121,43 +167,31 @@ Timer::waitUntilNextFrameIsDue ()
     // was displayed, sleep until exactly _spf seconds have gone by.
     //
 
-    timeval now;
-    gettimeofday (&now, 0);
+    Clock::time_point now = Clock::now();
 
-    _timeSinceLastFrame =  now.tv_sec  - _lastFrameTime.tv_sec +
-                          (now.tv_usec - _lastFrameTime.tv_usec) * 1e-6f;
+    _timeSinceLastFrame = seconds( now - _lastFrameTime );
 
     double timeToSleep = _spf - _timeSinceLastFrame - _timingError;
 
-    #ifdef _WIN32
-
-        if (timeToSleep > 0)
-            Sleep (int (timeToSleep * 1000.0f));
-
-    #else
-
-        if (timeToSleep > 0)
-        {
-            timespec ts;
-            ts.tv_sec = (time_t) timeToSleep;
-            ts.tv_nsec = (long) ((timeToSleep - ts.tv_sec) * 1e9f);
-            nanosleep (&ts, 0);
-        }
-
-    #endif
+    _targetTime = now;
+    if (timeToSleep > 0)
+    {
+        _targetTime += std::chrono::duration_cast< Clock::duration >(
+                       std::chrono::duration<double>( timeToSleep ) );
+        sleepUntil( _targetTime );
+    }
 
     //
-    // If we slept, it is possible that we woke up a little too early
-    // or a little too late.  Keep track of the difference between
-    // now and the exact time when we wanted to wake up; next time
-    // we'll try sleep that much longer or shorter.  This should
-    // keep our average frame rate close to one frame every _spf seconds.
+    // Even spinning, we may wake up a little too late.  Keep track
+    // of the difference between now and the exact time when we wanted
+    // to wake up; next time we'll try sleep that much shorter.  This
+    // should keep our average frame rate close to one frame every _spf
+    // seconds.
     //
 
-    gettimeofday (&now, 0);
+    now = Clock::now();
 
-    float timeSinceLastSleep = now.tv_sec  - _lastFrameTime.tv_sec +
-                              (now.tv_usec - _lastFrameTime.tv_usec) * 1e-6f;
+    double timeSinceLastSleep = seconds( now - _lastFrameTime );
 
     _timingError += timeSinceLastSleep - _spf;
 
@@ -175,8 +209,7 @@ Timer::waitUntilNextFrameIsDue ()
 
     if (_framesSinceLastFpsFrame >= 24)
     {
-        float t =  now.tv_sec  - _lastFpsFrameTime.tv_sec +
-                  (now.tv_usec - _lastFpsFrameTime.tv_usec) * 1e-6f;
+        double t = seconds( now - _lastFpsFrameTime );
 
         if (t > 0)
             _actualFrameRate = _framesSinceLastFpsFrame / t;
@@ -67,6 +67,10 @@
     #include <sys/time.h>
 #endif
 
+#include <chrono>
+
+#include <boost/cstdint.hpp>
+
 #include "CMedia.h"
 
 namespace mrv {
@@ -75,6 +79,11 @@ namespace mrv {
   class Timer
   {
   public:
+    // Monotonic, so frames are not paced by wall clock jumps.
+    typedef std::chrono::steady_clock Clock;
+
+    // Microseconds of Clock, as used by FramePacing.
+    static boost::int64_t now();
 
     //------------
     // Constructor
@@ -117,6 +126,13 @@ namespace mrv {
 
     inline void setDesiredSecondsPerFrame( double x ) { _spf = x; }
 
+    //-------------------------------------------------
+    // Time the last frame was due and the time we woke
+    // up for it, in microseconds of Clock.
+    //-------------------------------------------------
+    boost::int64_t targetTime() const;
+    boost::int64_t frameTime() const;
+
     //-------------------
     // Current play state
     //-------------------
@@ -126,18 +142,23 @@ namespace mrv {
 
   private:
 
+    // Sleep until shortly before t and spin the rest, as the OS may wake
+    // us up a millisecond or more late.
+    static void sleepUntil( const Clock::time_point& t );
+
     double	_spf;				// desired frame rate,
                                                 // in seconds per frame
 
     double      _pspf;                       // last frame rate we waited on
 
-    timeval	_lastFrameTime;			// time when we displayed the
+    Clock::time_point _lastFrameTime;		// time when we displayed the
                                                 // last frame
+    Clock::time_point _targetTime;              // time the last frame was due
 
     double	_timingError;			// cumulative timing error
     double      _timeSinceLastFrame;            // time since last frame
 
-    timeval	_lastFpsFrameTime;		// state to keep track of the
+    Clock::time_point _lastFpsFrameTime;	// state to keep track of the
     int		_framesSinceLastFpsFrame;	// actual frame rate, averaged
     double	_actualFrameRate;		// over several frames
   };
@@ -18,8 +18,7 @@ bool Element::thumbnail() const
 
 void Element::make_thumbnail()
 {
-    _elem->create_thumbnail();
-
+    // Thumbnail is made in the background, when the browser draws us.
     Fl_Image* b = NULL;
     if ( _elem->thumbnail() )
     {
@@ -171,6 +170,14 @@ void Element::make_thumbnail()
 	Fl_Image* b = _elem->thumbnail();
 	image->image(b);
 
+	// Thumbnail may have arrived after we were laid out
+	if ( b && ( b->w() != image->w() || b->h() != image->h() ) )
+	{
+	    image->size( b->w(), b->h() );
+	    label->position( image->x() + b->w(), label->y() );
+	    init_sizes();
+	}
+
 	Fl_Group::draw();
 
 	Fl_Color c = fl_color();
@@ -26,12 +26,16 @@
  *
  */
 
+#include <sstream>
+
 #include "core/CMedia.h"
 
 #include "gui/mrvIO.h"
 #include "gui/mrvFLTKHandler.h"
 #include "gui/mrvLogDisplay.h"
 #include "gui/mrvMedia.h"
+#include "gui/mrvPreferences.h"
+#include "gui/mrvThumbnailService.h"
 
 namespace {
 const char* kModule = "icon";
@@ -55,6 +59,23 @@ Fl_Image* fltk_handler( const char* filename, uchar* header,
          ext == "otio" )
         return NULL;
 
+    // Thumbnails of files already seen come from the disk cache, without
+    // opening them.
+    std::ostringstream settings;
+    settings << "chooser " << CMedia::thumbnail_percent << " "
+             << 150 << "x" << gui::media::_thumbnail_height;
+    if ( Preferences::use_ocio )
+        settings << " ocio " << Preferences::OCIO_Display
+                 << " " << Preferences::OCIO_View;
+    std::string key = ThumbnailService::cache_key( filename, settings.str() );
+
+    ThumbnailService::Picture p;
+    if ( ThumbnailService::load( key, p ) )
+    {
+        Fl_RGB_Image rgb( &p.rgb[0], p.w, p.h, 3 );
+        return rgb.copy();
+    }
+
     bool shown = LogDisplay::shown;
     LogDisplay::shown = true;
 
@@ -88,6 +109,15 @@ Fl_Image* fltk_handler( const char* filename, uchar* header,
     mrv::gui::media m( img );
     m.create_thumbnail();
 
-    return (Fl_Image*) m.thumbnail()->copy();
+    Fl_RGB_Image* thumb = m.thumbnail();
+    if ( !thumb ) return NULL;
+
+    p.w = thumb->w();
+    p.h = thumb->h();
+    const uchar* data = (const uchar*) thumb->data()[0];
+    p.rgb.assign( data, data + p.w * p.h * 3 );
+    ThumbnailService::save( key, p );
+
+    return (Fl_Image*) thumb->copy();
 }
 }
@@ -29,6 +29,7 @@
 
 #include <math.h>
 #include <limits>
+#include <vector>
 
 #ifdef _WIN32
 #define isfinite(x) _finite(x)
@@ -62,11 +63,15 @@ Histogram::Histogram( int x, int y, int w, int h, const char* l ) :
 Fl_Gl_Window( x, y, w, h, l ),
 _channel( kRGB ),
 _histtype( kLog ),
-maxLumma( 0 ),
-maxColor( 0 )
+_engine( new ScopeEngine( ScopeEngine::kHistogram, this ) )
 {
 }
 
+Histogram::~Histogram()
+{
+    delete _engine; _engine = NULL;
+}
+
 
 void Histogram::draw_grid(const mrv::Recti& r)
 {
@@ -117,59 +122,24 @@ void Histogram::draw()
 }
 
 
-void Histogram::count_pixel( const uchar* rgb )
-{
-    uchar r = rgb[0];
-    uchar g = rgb[1];
-    uchar b = rgb[2];
-
-    ++red[ r ];
-    if ( red[r] > maxColor ) maxColor = red[r];
-
-    ++green[ g ];
-    if ( green[g] > maxColor ) maxColor = green[g];
-
-    ++blue[ b ];
-    if ( blue[b] > maxColor ) maxColor = blue[b];
-
-    unsigned int lum = unsigned(r * 0.30f + g * 0.59f + b * 0.11f);
-    lumma[ lum ] += 1;
-    if ( lumma[lum] > maxLumma ) maxLumma = lumma[lum];
-}
-
-
-void Histogram::count_pixels()
+ScopeEngine::Result_ptr Histogram::count_pixels()
 {
     media m = uiMain->uiView->foreground();
     if (!m) {
         tooltip( _("Mark an area in the image with the left mouse button") );
-        return;
+        return ScopeEngine::Result_ptr();
     }
 
     CMedia* img = m->image();
     if (!img) {
-        return;
+        return ScopeEngine::Result_ptr();
     }
 
     mrv::image_type_ptr pic = img->left();
-    if (!pic) return;
+    if (!pic) return ScopeEngine::Result_ptr();
 
     tooltip( NULL );
 
-    // @todo: avoid recalculating on stopped image
-    //        commented out as it was preventing histogram update of renders
-    //     if ( img == lastImg && frame == lastFrame )
-    //       return;
-
-
-
-    maxColor = maxLumma = 0;
-    memset( red,   0, sizeof(float) * 256 );
-    memset( green, 0, sizeof(float) * 256 );
-    memset( blue,  0, sizeof(float) * 256 );
-    memset( lumma, 0, sizeof(float) * 256 );
-
-
     int off[2];
     int xmin, ymin, xmax, ymax;
     bool right, bottom;
@@ -186,7 +156,7 @@ void Histogram::count_pixels()
             pic = img->left();
         else if ( stereo_output & CMedia::kStereoSideBySide )
             pic = img->right();
-        if (!pic) return;
+        if (!pic) return ScopeEngine::Result_ptr();
     }
     else if ( bottom )
     {
@@ -195,7 +165,7 @@ void Histogram::count_pixels()
             pic = img->left();
         else if ( stereo_output & CMedia::kStereoTopBottom )
             pic = img->right();
-        if (!pic) return;
+        if (!pic) return ScopeEngine::Result_ptr();
     }
 
     // Check if xmin/ymin is below 0 is done in selection_to_coord
@@ -206,72 +176,10 @@ void Histogram::count_pixels()
     if ( xmax >= (int)pic->width() ) xmax = (int) pic->width()-1;
     if ( ymax >= (int)pic->height() ) ymax =(int)  pic->height()-1;
 
-
-    unsigned int stepY = (ymax - ymin + 1) / w();
-    unsigned int stepX = (xmax - xmin + 1) / h();
-    if ( stepX < 1 ) stepX = 1;
-    if ( stepY < 1 ) stepY = 1;
-
-    ImageView* view = uiMain->uiView;
-    mrv::DrawEngine* engine = view->engine();
-    ImageView::PixelValue v = (ImageView::PixelValue)
-                              uiMain->uiPixelValue->value();
-
-    float gain = view->gain();
-    float gamma = view->gamma();
-    float one_gamma = 1.0f / gamma;
-
-    CMedia::Pixel rp;
-    uchar rgb[3];
-    for ( int y = ymin; y <= ymax; y += stepY )
-    {
-        for ( int x = xmin; x <= xmax; x += stepX )
-        {
-            CMedia::Pixel op = pic->pixel( x, y );
-
-            if ( view->normalize() )
-            {
-                view->normalize( op );
-            }
-
-            op.r *= gain;
-            op.g *= gain;
-            op.b *= gain;
-
-            ColorControlsUI* cc = uiMain->uiColorControls;
-            if ( cc->uiActive->value() )
-            {
-                const Imath::M44f& m = colorMatrix(cc);
-                Imath::V3f* iop = (Imath::V3f*)&op;
-                *iop *= m;
-            }
-
-            if ( view->use_lut() && v == ImageView::kRGBA_Full )
-            {
-                Imath::V3f* iop = (Imath::V3f*)&op;
-                Imath::V3f* irp = (Imath::V3f*)&rp;
-                engine->evaluate( img, (*iop), (*irp) );
-            }
-            else
-            {
-                rp = op;
-            }
-
-            if ( v != ImageView::kRGBA_Original )
-            {
-                if ( rp.r > 0.0f && isfinite(rp.r) )
-                    rp.r = powf(rp.r, one_gamma);
-                if ( rp.g > 0.0f && isfinite(rp.g) )
-                    rp.g = powf(rp.g, one_gamma);
-                if ( rp.b > 0.0f && isfinite(rp.b) )
-                    rp.b = powf(rp.b, one_gamma);
-            }
-            rgb[0] = (uchar)Imath::clamp(rp.r * 255.0f, 0.f, 255.f);
-            rgb[1] = (uchar)Imath::clamp(rp.g * 255.0f, 0.f, 255.f);
-            rgb[2] = (uchar)Imath::clamp(rp.b * 255.0f, 0.f, 255.f);
-            count_pixel( rgb );
-        }
-    }
+    ScopeEngine::Settings s;
+    ScopeEngine::settings( s, uiMain, img, xmin, ymin, xmax, ymax,
+                           h(), w() );
+    return _engine->result( pic, s );
 }
 
 float Histogram::histogram_scale( float val, float maxVal )
@@ -290,7 +198,15 @@ float Histogram::histogram_scale( float val, float maxVal )
 
 void Histogram::draw_pixels( const mrv::Recti& r )
 {
-    count_pixels();
+    ScopeEngine::Result_ptr res = count_pixels();
+    if ( !res ) return;
+
+    const float* lumma = res->lumma;
+    const float* red   = res->red;
+    const float* green = res->green;
+    const float* blue  = res->blue;
+    const float maxLumma = res->maxLumma;
+    const float maxColor = res->maxColor;
 
     // Draw the pixel info
     int W = r.w() - 8;
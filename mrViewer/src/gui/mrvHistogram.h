@@ -30,6 +30,8 @@
 #include <core/mrvRectangle.h>
 #include <FL/Fl_Gl_Window.H>
 
+#include "gui/mrvScopeEngine.h"
+
 class ViewerUI;
 
 namespace mrv
@@ -58,6 +60,7 @@ public:
 
 public:
     Histogram( int x, int y, int w, int h, const char* l = 0 );
+    virtual ~Histogram();
 
     void channel( Channel c ) {
         _channel = c;
@@ -90,27 +93,14 @@ protected:
     void   draw_grid( const mrv::Recti& r );
     void draw_pixels( const mrv::Recti& r );
 
-    void count_pixels();
-
-    void count_pixel( const uchar* rgb );
+    ScopeEngine::Result_ptr count_pixels();
 
     inline float histogram_scale( float val, float maxVal );
 
     Channel      _channel;
     Type         _histtype;
 
-    float maxLumma;
-    float lumma[256];
-
-    float maxColor;
-
-    float red[256];
-    float green[256];
-    float blue[256];
-
-
-    CMedia* lastImg;
-    int64_t    lastFrame;
+    ScopeEngine* _engine;
 
     ViewerUI* uiMain;
 
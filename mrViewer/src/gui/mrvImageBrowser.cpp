@@ -83,6 +83,7 @@ namespace fs = boost::filesystem;
 #include "gui/mrvElement.h"
 #include "gui/mrvEDLGroup.h"
 #include "gui/mrvHotkey.h"
+#include "gui/mrvThumbnailService.h"
 #include "mrvPreferencesUI.h"
 #include "mrvEDLWindowUI.h"
 #include "gui/FLU/Flu_File_Chooser.h"
@@ -287,6 +288,34 @@ void clone_image_cb( Fl_Widget* o, mrv::ImageBrowser* b )
     b->clone_current();
 }
 
+static void cache_priority( mrv::ImageBrowser* b,
+                            const mrv::FrameCache::Priority p )
+{
+    mrv::Reel reel = b->current_reel();
+    if ( !reel ) return;
+    reel->cache_priority( p );
+}
+
+void cache_priority_low_cb( Fl_Widget* o, mrv::ImageBrowser* b )
+{
+    cache_priority( b, mrv::FrameCache::kLowPriority );
+}
+
+void cache_priority_normal_cb( Fl_Widget* o, mrv::ImageBrowser* b )
+{
+    cache_priority( b, mrv::FrameCache::kNormalPriority );
+}
+
+void cache_priority_high_cb( Fl_Widget* o, mrv::ImageBrowser* b )
+{
+    cache_priority( b, mrv::FrameCache::kHighPriority );
+}
+
+void cache_priority_pinned_cb( Fl_Widget* o, mrv::ImageBrowser* b )
+{
+    cache_priority( b, mrv::FrameCache::kPinned );
+}
+
 namespace {
 
     mrv::media black_gap( const mrv::LoadInfo& i, mrv::ImageBrowser* b )
@@ -1515,6 +1544,8 @@ void ImageBrowser::save_session()
         add_to_tree( m );
         match_tree_order();
 
+        if ( reel->priority != FrameCache::kNormalPriority )
+            reel->cache_priority( m->image() );
 
         if ( reel->images.size() == 1 )
         {
@@ -4193,6 +4224,30 @@ void ImageBrowser::previous_image_limited()
                         this, FL_MENU_DIVIDER);
         }
 
+        mrv::Reel reel = current_reel();
+        if ( reel )
+        {
+            static const char* kPriorityNames[] = {
+                N_("Reel/Cache Priority/Low"),
+                N_("Reel/Cache Priority/Normal"),
+                N_("Reel/Cache Priority/High"),
+                N_("Reel/Cache Priority/Pinned"),
+            };
+            static Fl_Callback* kPriorityCbs[] = {
+                (Fl_Callback*)cache_priority_low_cb,
+                (Fl_Callback*)cache_priority_normal_cb,
+                (Fl_Callback*)cache_priority_high_cb,
+                (Fl_Callback*)cache_priority_pinned_cb,
+            };
+            for ( int p = 0; p < FrameCache::kNumPriorities; ++p )
+            {
+                idx = menu->add( _(kPriorityNames[p]), 0, kPriorityCbs[p],
+                                 this, FL_MENU_RADIO );
+                item = (Fl_Menu_Item*) &menu->menu()[idx];
+                if ( reel->priority == p ) item->set();
+                else item->clear();
+            }
+        }
 
         bool has_version = false;
 
@@ -5210,24 +5265,35 @@ bool ImageBrowser::add_to_tree( mrv::media m )
 
 void ImageBrowser::draw()
 {
+    Fl_Tree::selection_color( Fl_Color(0xffff0000) );
+
+    // Let tree draw itself
+    Fl_Tree::draw();
+
+    // Ask for outdated thumbnails of the items in view, top ones first,
+    // and drop the requests of the items that scrolled out of it.
+    bool stopped = ( view()->playback() == CMedia::kStopped );
+    ThumbnailService& service = ThumbnailService::instance();
+    int idx = 0;
     Fl_Tree_Item* i = NULL;
     for ( i = first(); i; i = next(i) )
     {
         if ( ! i->widget() ) continue;
 
-
-        if ( view()->playback() == CMedia::kStopped )
-        {
-            mrv::Element* elem = (mrv::Element*) i->widget();
-            if ( elem->visible_r() ) elem->make_thumbnail();
-        }
+        mrv::Element* elem = (mrv::Element*) i->widget();
+        mrv::media m = elem->media();
+        if ( !m ) continue;
+
+        bool in_view = ( elem->visible_r() &&
+                         i->y() + i->h() > _tiy && i->y() < _tiy + _tih );
+        if ( stopped && in_view && m->image()->stopped() &&
+             m->thumbnail_outdated() )
+            service.request( m, 150, gui::media::_thumbnail_height, idx++,
+                             this );
+        else
+            service.cancel( m.get() );
     }
 
-    Fl_Tree::selection_color( Fl_Color(0xffff0000) );
-
-    // Let tree draw itself
-    Fl_Tree::draw();
-
     // Dragging item that has a widget()?
     //    Assume widget() is a group, draw it where the mouse is..
     //
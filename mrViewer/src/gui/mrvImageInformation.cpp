@@ -65,6 +65,8 @@ using namespace std;
 #include "core/mrvString.h"
 #include "core/aviImage.h"
 #include "core/exrImage.h"
+#include "core/mrvFrameCache.h"
+#include "core/mrvFramePool.h"
 
 #ifdef USE_R3DSDK
 #include "core/R3dImage.h"
@@ -3180,6 +3182,59 @@ void ImageInformation::fill_data()
     }
 
 
+    DBG3;
+
+    ++group;
+    {
+        static const char* kPriorityNames[] = {
+            N_("Low"), N_("Normal"), N_("High"), N_("Pinned")
+        };
+
+        FrameCache& cache = FrameCache::instance();
+        FrameCache::Stats s = cache.stats();
+
+        double cache_space = double( to_memory( (long double)s.bytes,
+                                                space_type ) );
+        sprintf( buf, N_("%.3f %s"), cache_space, space_type );
+        add_text( _("Frame Cache"), _("Memory used by all cached frames"),
+                  buf );
+        sprintf( buf, N_("%" PRIu64), s.frames );
+        add_text( _("Cached Frames"), _("Frames in cache, for all clips"),
+                  buf );
+        sprintf( buf, N_("%" PRIu64), s.hits );
+        add_text( _("Cache Hits"), _("Frames found in cache"), buf );
+        sprintf( buf, N_("%" PRIu64), s.misses );
+        add_text( _("Cache Misses"), _("Frames loaded from disk"), buf );
+        sprintf( buf, N_("%" PRIu64), s.evictions );
+        add_text( _("Cache Evictions"),
+                  _("Frames released to stay within cache memory"), buf );
+        add_text( _("Cache Priority"), _("Eviction priority of this clip"),
+                  _( kPriorityNames[ cache.priority( img ) ] ) );
+    }
+
+    DBG3;
+
+    ++group;
+    {
+        double used = double( to_memory( (long double)CMedia::memory_used,
+                                         space_type ) );
+        sprintf( buf, N_("%.3f %s"), used, space_type );
+        add_text( _("Memory Used"), _("Memory used by all frames"), buf );
+
+        FramePool::Stats s = FramePool::instance().stats();
+        double held = double( to_memory( (long double)s.bytes,
+                                         space_type ) );
+        sprintf( buf, N_("%.3f %s  (%" PRIu64 " buffers)"), held, space_type,
+                 s.buffers );
+        add_text( _("Frame Pool"), _("Idle frame buffers kept for reuse"),
+                  buf );
+        double pct = 0.0;
+        if ( s.acquires ) pct = 100.0 * double(s.reuses) / double(s.acquires);
+        sprintf( buf, N_("%.2f %%"), pct );
+        add_text( _("Pool Reuse"),
+                  _("Frame buffers reused instead of allocated"), buf );
+    }
+
     DBG3;
 
     ++group;
@@ -3569,6 +3624,29 @@ void ImageInformation::fill_data()
 
             add_text( _("FPS"), _("Frames per Second"), buf );
 
+            aviImage* movie = dynamic_cast< aviImage* >( img );
+            if ( movie && i == img->video_stream() )
+            {
+                ++group;
+                sprintf( buf, "%u (%s)", movie->video_threads(),
+                         movie->video_thread_type() );
+                add_text( _("Decoder Threads"),
+                          _("Threads used to decode video and how"), buf );
+                sprintf( buf, "%.2f", movie->decode_fps() );
+                add_text( _("Decode FPS"),
+                          _("Frames decoded per second while playing"), buf );
+
+                uint64_t wrapped = movie->wrapped_frames();
+                uint64_t copied  = movie->copied_frames();
+                uint64_t total   = wrapped + copied;
+                sprintf( buf, "%" PRIu64 " / %" PRIu64 " (%.1f%%)",
+                         wrapped, total,
+                         total ? 100.0 * double(wrapped) / double(total) : 0.0 );
+                add_text( _("Zero Copy Frames"),
+                          _("Decoded frames used without converting or "
+                            "copying them"), buf );
+            }
+
             ++group;
             add_text( _("Language"), _("Language if known"), s.language );
             add_text( _("Disposition"), _("Disposition of Track"),
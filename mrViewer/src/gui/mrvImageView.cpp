@@ -78,6 +78,8 @@
 
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/bind.hpp>
 
 #include <FL/names.h>
 #include <FL/fl_utf8.h>
@@ -110,6 +112,9 @@
 #include "core/mrvLicensing.h"
 #include "core/mrvMath.h"
 #include "core/mrvPlayback.h"
+#include "core/mrvReadAhead.h"
+#include "core/mrvScheduler.h"
+#include "core/mrvSeatSync.h"
 #include "core/mrvString.h"
 #include "core/Sequence.h"
 #include "core/stubImage.h"
@@ -1985,6 +1990,7 @@ _playback( CMedia::kStopped ),
 _orig_playback( CMedia::kForwards ),
 _network_active( true ),
 _interactive( true ),
+_seat_master( false ),
 _frame( 1 ),
 _lastFrame( 0 )
 {
@@ -3377,6 +3383,7 @@ bool ImageView::should_update( mrv::media fg )
              img->image_damage() & CMedia::kDamageThumbnail )
         {
             // Redraw browser to update thumbnail
+            fg->damage_thumbnail();
             mrv::ImageBrowser* b = browser();
             if (b) b->redraw();
             img->image_damage( img->image_damage() & ~CMedia::kDamageThumbnail );
@@ -3476,6 +3483,7 @@ bool ImageView::should_update( mrv::media fg )
              bimg->image_damage() & CMedia::kDamageThumbnail )
         {
             // Redraw browser to update thumbnail
+            bg->damage_thumbnail();
             mrv::ImageBrowser* b = browser();
             if (b) b->redraw();
             bimg->image_damage( bimg->image_damage() & ~CMedia::kDamageThumbnail );
@@ -3671,22 +3679,50 @@ bool ImageView::preload()
     }
 
 
+    ReadAhead& pool = ReadAhead::instance();
+    if ( pool.threads() > 0 && ReadAhead::supports( img ) )
+    {
+        // Loader threads fill the cache.  Here we just keep them
+        // following the playhead.
+        if ( r->edl )
+        {
+            pool.request( img, f, p, img->first_frame(), img->last_frame() );
+            if ( preload_cache_full( img ) )
+            {
+                _preframe = fg->position() + img->duration();
+                if ( _preframe > timeline()->display_maximum() )
+                    _preframe = timeline()->display_minimum();
+            }
+        }
+        else
+        {
+            pool.request( img, img->frame(), p, first, last );
+        }
+
+        timeline()->redraw();
+        redraw();
+        return true;
+    }
 
     if ( img->stopped() )
     {
         typedef CMedia::Mutex Mutex;
         Mutex& vpm = img->video_packets().mutex();
-        SCOPED_LOCK( vpm );
         Mutex& apm = img->audio_packets().mutex();
-        SCOPED_LOCK( apm );
         Mutex& spm = img->subtitle_packets().mutex();
-        SCOPED_LOCK( spm );
         Mutex& mtx = img->video_mutex();
-        SCOPED_LOCK( mtx );
 
-        // Add a frame to image queue
-        while ( ! img->frame( f ) )
+        // Add a frame to image queue.  Locks are not held while waiting,
+        // so other threads can drain the queues meanwhile.
+        for (;;)
         {
+            {
+                SCOPED_LOCK( vpm );
+                SCOPED_LOCK( apm );
+                SCOPED_LOCK( spm );
+                SCOPED_LOCK( mtx );
+                if ( img->frame( f ) ) break;
+            }
             if ( img->stopped() || playback() == CMedia::kStopped ) break;
             sleep_ms( 20 );
         }
@@ -4333,6 +4369,7 @@ void ImageView::timeout()
             img->has_changed();
         }
 
+        if ( ! img->has_video() ) view_region( img );
     }
 
 
@@ -9308,6 +9345,7 @@ void ImageView::preload_cache_stop()
     if ( _idle_callback )
     {
         _idle_callback = false;
+        ReadAhead::instance().cancel();
         if ( Fl::has_timeout( (Fl_Timeout_Handler) static_preload, this ) )
             Fl::remove_timeout( (Fl_Timeout_Handler) static_preload, this );
         //Fl::remove_idle( (Fl_Timeout_Handler) static_preload, this );
@@ -10717,10 +10755,33 @@ bool ImageView::normalize() const
     return (bool) uiMain->uiNormalize->value();
 }
 
+static void cached_frames_stats_cb( mrv::media m )
+{
+    m->image()->cached_frames_stats();
+}
+
 void ImageView::normalize( const bool normalize)
 {
+    // Frames cached while normalize was off get their statistics in the
+    // background, so drawing them needs no pass over their pixels.
+    const bool start = ( normalize && !CMedia::cache_stats );
+
     _normalize = normalize;
     uiMain->uiNormalize->value( normalize );
+    CMedia::cache_stats = normalize;
+
+    if ( start )
+    {
+        Scheduler& s = Scheduler::instance();
+        mrv::media fg = foreground();
+        mrv::media bg = background();
+        if ( fg )
+            s.submit( boost::bind( cached_frames_stats_cb, fg ),
+                      Scheduler::kBackground, "stats" );
+        if ( bg && bg != fg )
+            s.submit( boost::bind( cached_frames_stats_cb, bg ),
+                      Scheduler::kBackground, "stats" );
+    }
 
     char buf[128];
     sprintf( buf, N_("Normalize %d"), (int) _normalize );
@@ -11243,20 +11304,24 @@ void ImageView::play_forwards()
 void ImageView::play( const CMedia::Playback dir )
 {
     assert( dir != CMedia::kStopped );
-    if ( dir == CMedia::kForwards )
-    {
-        send_network(N_("playfwd"));
-    }
-    else if ( dir == CMedia::kBackwards )
-    {
-        send_network(N_("playback"));
-    }
-    else
+    if ( dir != CMedia::kForwards && dir != CMedia::kBackwards )
     {
         LOG_ERROR( "Not a valid playback mode" );
         return;
     }
 
+    // Other seats start where we start, catching up by the time it took
+    // the message to reach them.
+    char buf[128];
+    sprintf( buf, "%s %" PRId64 " %" PRId64,
+             dir == CMedia::kForwards ? N_("playfwd") : N_("playback"),
+             mrv::Timer::now(), frame() );
+    send_network( buf );
+
+    // Playback started by a peer is led by it.
+    _seat_master = _interactive;
+    if ( _seat_master ) SeatSync::instance().clear();
+
 
     mrv::media fg = foreground();
     if (!fg) return;
@@ -11323,18 +11388,80 @@ void ImageView::thumbnails()
     if ( playback() != CMedia::kStopped ) return;
 
 
+    // Browser asks for the new thumbnails when redrawn
     mrv::media fg = foreground();
-    if ( fg ) fg->create_thumbnail();
+    if ( fg ) fg->damage_thumbnail();
 
 
     mrv::media bg = background();
-    if ( bg ) bg->create_thumbnail();
+    if ( bg ) bg->damage_thumbnail();
 
     mrv::ImageBrowser* b = browser();
     if ( b ) b->redraw();
 }
 
 
+/**
+ * Tell an image which part of its picture is in view, so its reader may
+ * decode only that part while it is magnified.  If stopped, the frame
+ * shown is fetched again when it lacks part of the view.
+ *
+ * @param img image to tell
+ */
+void ImageView::view_region( CMedia* img )
+{
+    mrv::Recti r;  // all of picture
+
+    mrv::image_type_ptr pic = img->left();
+    if ( pic && _real_zoom > 1.0f && img->rot_z() == 0.0 &&
+         img->stereo_input() == CMedia::kNoStereoInput &&
+         img->stereo_output() == CMedia::kNoStereo )
+    {
+        const int W = int( pic->width() );
+        const int H = int( pic->height() );
+        int xmin = std::numeric_limits<int>::max();
+        int ymin = xmin;
+        int xmax = std::numeric_limits<int>::min();
+        int ymax = xmax;
+
+        const int X[2] = { 0, w() - 1 };
+        const int Y[2] = { 0, h() - 1 };
+        for ( int i = 0; i < 2; ++i )
+        {
+            for ( int j = 0; j < 2; ++j )
+            {
+                bool outside;
+                mrv::image_type_ptr p;
+                int xp, yp, pw, ph, off[2];
+                picture_coordinates( img, X[i], Y[j], outside, p,
+                                     xp, yp, pw, ph, off );
+                xmin = std::min( xmin, xp );
+                ymin = std::min( ymin, yp );
+                xmax = std::max( xmax, xp + 1 );
+                ymax = std::max( ymax, yp + 1 );
+            }
+        }
+
+        // Some margin, so panning a little does not fetch again
+        const int mx = ( xmax - xmin ) / 4;
+        const int my = ( ymax - ymin ) / 4;
+        xmin = std::max( xmin - mx, 0 );
+        ymin = std::max( ymin - my, 0 );
+        xmax = std::min( xmax + mx, W );
+        ymax = std::min( ymax + my, H );
+
+        if ( xmin < xmax && ymin < ymax &&
+             ( xmin > 0 || ymin > 0 || xmax < W || ymax < H ) )
+            r = mrv::Recti( xmin, ymin, xmax - xmin, ymax - ymin );
+    }
+
+    img->view_region( r );
+
+    if ( playback() == CMedia::kStopped && img->update_view_region() )
+        redraw();
+}
+
+
 bool ImageView::preload_cache_full( CMedia* img )
 {
     if ( img->is_cache_full() ) return true;
@@ -11380,6 +11507,14 @@ void ImageView::stop()
         }
     }
 
+    // Where the time of background tasks went while playing.
+    Scheduler& s = Scheduler::instance();
+    s.log_stats();
+    s.reset_stats();
+
+    _seat_master = false;
+    SeatSync::instance().clear();
+
     char buf[256];
     sprintf( buf, N_("stop %" PRId64), frame() );
     send_network( buf );
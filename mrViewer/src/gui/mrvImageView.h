@@ -733,6 +733,11 @@ public:
         _network_active = b;
     }
 
+    // Whether playback was started here, so other seats follow us.
+    bool seat_master() const {
+        return _seat_master;
+    }
+
     void send_network( std::string msg ) const;
     void send_selection() const;
 
@@ -896,6 +901,9 @@ protected:
     /// Create thumbnails for images
     void thumbnails();
 
+    /// Tell an image which part of its picture is in view
+    void view_region( CMedia* img );
+
     /// Initializes the draw engine (opengl, for example)
     void init_draw_engine();
 
@@ -1057,6 +1065,7 @@ protected:
 
     bool _network_active;  //<- whether to send commands across the network
     bool _interactive;     //<- whether fltk should update (Fl::check)
+    bool _seat_master;     //<- whether playback was started here
 
     ///////////////////
     // FPS calculation
@@ -30,24 +30,18 @@
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 
-#include <math.h>
+#include <string.h>
 
 #include <FL/Fl_Shared_Image.H>
-#include <ImathMath.h>   // for Imath::clamp
-// #include <ImathFun.h>   // for Imath::pow
 
 #include "core/mrvThread.h"
 #include "core/CMedia.h"
-#include "core/mrvColorOps.h"
+#include "core/mrvReadAhead.h"
 #include "gui/mrvIO.h"
 #include "gui/mrvFLTKHandler.h"
-#include "gui/mrvPreferences.h"
+#include "gui/mrvThumbnailService.h"
 #include "gui/mrvMedia.h"
 
-#ifdef _WIN32
-#define isfinite(x) _finite(x)
-#endif
-
 #undef IMG_ERROR
 #define IMG_ERROR(x) LOG_ERROR( name() << " - " << x )
 
@@ -67,13 +61,16 @@ media::media( CMedia* const img ) :
     _image( img ),
     _thumbnail( NULL ),
     _thumbnail_frozen( false ),
-    _own_image( true )
+    _own_image( true ),
+    _thumbnail_damage( 1 ),
+    _thumbnail_made( 0 )
 {
 }
 
 media::~media()
 {
     if ( _own_image ) {
+        ReadAhead::instance().forget( _image );
 	delete _image;
     }
     _image = NULL;
@@ -89,126 +86,33 @@ int64_t media::position() const {
     return _image->position();
 }
 
-void media::thumbnail_pixel( uchar*& ptr, uchar r, uchar g, uchar b )
-{
-    *ptr++ = r;
-    *ptr++ = g;
-    *ptr++ = b;
-}
-
-void media::create_thumbnail( unsigned W, unsigned H )
+void media::thumbnail( unsigned w, unsigned h, const uchar* rgb,
+                       unsigned damage )
 {
-    if ( (!_image->stopped()) || thumbnail_frozen() ) return;
-
-
-    // Make sure frame memory is not deleted
-    Mutex& mutex = _image->video_mutex();
-    SCOPED_LOCK( mutex );
-
-
-    // Audio only clip?  Return
-    mrv::image_type_ptr pic = _image->left();
-
-    if ( !pic ) {
-	LOG_ERROR( _("Empty pic file for media ") << _image->name() );
-	return;
-    }
-
-    unsigned dw = pic->width();
-    unsigned dh = pic->height();
-    if ( dw == 0 || dh == 0 ) {
-	LOG_ERROR( _("Media file has zero size in width or height") );
-	return;
-    }
-
-    unsigned int h = H;
-
-    float yScale = (float)(h+0.5) / (float)dh;
-    unsigned int w = unsigned( (float)(dw+0.5) * (float)yScale );
-    if ( w > W ) w = W;
-
-    // Resize image to thumbnail size
-    pic.reset( pic->quick_resize( w, h ) );
-
-    if ( mrv::Preferences::use_ocio )
-    {
-	mrv::image_type_ptr ptr;
-	if ( pic->pixel_type() == mrv::image_type::kFloat )
-	{
-	    ptr = pic;
-	}
-	else if ( pic->pixel_type() == mrv::image_type::kHalf )
-	{
-	    ptr = image_type_ptr( new image_type(
-				  pic->frame(),
-				  w, h, 3,
-				  image_type::kRGB,
-				  image_type::kFloat ) );
-	    SwsContext* save_ctx = NULL;
-	    copy_image( ptr, pic, &save_ctx );
-	    if ( save_ctx )
-	    {
-		sws_freeContext( save_ctx );
-	    }
-	}
-	if ( pic->pixel_type() == mrv::image_type::kFloat ||
-	     pic->pixel_type() == mrv::image_type::kHalf )
-	{
-	    bake_ocio( ptr, _image );
-	    pic = ptr;
-	}
-    }
-
-    w = pic->width();
-    h = pic->height();
-
     delete _thumbnail;
 
     uchar* data = new uchar[ w * h * 3 ];
+    memcpy( data, rgb, w * h * 3 );
     _thumbnail = new Fl_RGB_Image( data, w, h, 3 );
     _thumbnail->alloc_array = 1;
 
-    if ( !_thumbnail )
-    {
-	IMG_ERROR( _("Could not create thumbnail picture for '")
-		   << _image->fileroot() << "'" );
-	return;
-    }
+    _thumbnail_made = damage;
+    _image->image_damage( _image->image_damage() &
+                          ~CMedia::kDamageThumbnail );
+}
 
-    uchar* ptr = data;
+void media::create_thumbnail( unsigned W, unsigned H )
+{
+    if ( (!_image->stopped()) || thumbnail_frozen() ) return;
 
-    // Copy to thumbnail and gamma it
-    float gamma = 1.0f / _image->gamma();
-    unsigned ymin = 0;
-    unsigned ymax = h;
-    unsigned xmin = 0;
-    unsigned xmax = w;
-    for (unsigned y = ymin; y < ymax; ++y )
+    ThumbnailService::Picture p;
+    if ( !ThumbnailService::render( _image, W, H, p ) )
     {
-	for (unsigned x = xmin; x < xmax; ++x )
-	{
-	    CMedia::Pixel fp = pic->pixel( x, y );
-	    if ( gamma != 1.0f )
-	    {
-		using namespace std;
-		if ( isfinite( fp.r ) )
-		    fp.r = Imath::Math<float>::pow( fp.r, gamma );
-		if ( isfinite( fp.g ) )
-		    fp.g = Imath::Math<float>::pow( fp.g, gamma );
-		if ( isfinite( fp.b ) )
-		    fp.b = Imath::Math<float>::pow( fp.b, gamma );
-	    }
-
-	    uchar r = (uchar)(Imath::clamp(fp.r, 0.f, 1.f) * 255.0f);
-	    uchar g = (uchar)(Imath::clamp(fp.g, 0.f, 1.f) * 255.0f);
-	    uchar b = (uchar)(Imath::clamp(fp.b, 0.f, 1.f) * 255.0f);
-	    thumbnail_pixel( ptr, r, g, b );
-	}
+        _thumbnail_made = _thumbnail_damage;
+        return;
     }
 
-
-    _image->image_damage( _image->image_damage() &
-			  ~CMedia::kDamageThumbnail );
+    thumbnail( p.w, p.h, &p.rgb[0], _thumbnail_damage );
 }
 
 void media::create_thumbnail()
@@ -91,17 +91,37 @@ public:
         _thumbnail_frozen = t;
     }
 
+    // Thumbnail needs to be made again.  Each damage bumps a counter,
+    // so a thumbnail made for an older damage is known to be outdated.
+    inline void damage_thumbnail()  {
+        ++_thumbnail_damage;
+    }
+    inline unsigned thumbnail_damage() const {
+        return _thumbnail_damage;
+    }
+    inline bool thumbnail_outdated() const {
+        return _thumbnail_made != _thumbnail_damage;
+    }
+    inline void thumbnail_made( unsigned damage ) {
+        _thumbnail_made = damage;
+    }
+
+    // Set thumbnail from 8-bit rgb pixels made for damage.
+    void thumbnail( unsigned w, unsigned h, const uchar* rgb,
+                    unsigned damage );
+
+    // Make thumbnail now, in this thread.
     void create_thumbnail( unsigned W, unsigned H );
 
     void create_thumbnail();
 
 protected:
-    void thumbnail_pixel( uchar*& ptr, uchar r, uchar g, uchar b );
-
     CMedia*   _image;
     Fl_RGB_Image* _thumbnail;
     bool         _thumbnail_frozen;
     bool         _own_image;
+    unsigned     _thumbnail_damage;
+    unsigned     _thumbnail_made;
 
 public:
     static       int _thumbnail_width;
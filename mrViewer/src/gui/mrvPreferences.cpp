@@ -64,6 +64,9 @@ namespace fs = boost::filesystem;
 #include "core/mrvOS.h"
 #include "core/mrvMath.h"
 #include "core/CMedia.h"
+#include "core/mrvFramePool.h"
+#include "core/mrvDiskCache.h"
+#include "core/mrvReadAhead.h"
 
 // GUI  classes
 #include "gui/mrvColorOps.h"
@@ -875,6 +878,11 @@ Preferences::Preferences( PreferencesUI* uiPrefs )
     uiPrefs->uiPrefs8BitCaches->value( (bool) tmp );
     CMedia::eight_bit_caches( (bool) tmp );
 
+    DBG3;
+    caches.get( "packed_caches", tmp, 0 );
+    uiPrefs->uiPrefsPackedCaches->value( (bool) tmp );
+    CMedia::packed_caches( (bool) tmp );
+
     DBG3;
 
     caches.get( "fps", tmp, 1 );
@@ -909,6 +917,19 @@ Preferences::Preferences( PreferencesUI* uiPrefs )
     DBG3;
     uiPrefs->uiPrefsCacheMemory->value( tmpF );
 
+    caches.get( "preload_threads", tmp, 0 );
+    uiPrefs->uiPrefsPreloadThreads->value( tmp );
+
+    caches.get( "disk_cache", tmp, 0 );
+    uiPrefs->uiPrefsDiskCache->value( (bool) tmp );
+
+    caches.get( "disk_cache_dir", tmpS,
+                DiskCache::default_directory().c_str(), 2048 );
+    uiPrefs->uiPrefsDiskCacheDir->value( tmpS );
+
+    caches.get( "disk_cache_size", tmpF, 20.0 );
+    uiPrefs->uiPrefsDiskCacheSize->value( tmpF );
+
     //
     // audio
     //
@@ -2036,10 +2057,26 @@ void Preferences::run( ViewerUI* main )
     Preferences::max_memory = (int64_t)( uiPrefs->uiPrefsCacheMemory->value() *
                                          1000000000.0 );
     if ( max_memory <= 0 ) max_memory = 1000000000;
+
+    // Let the frame pool keep up to a few frames' worth of idle buffers.
+    FramePool::instance().max_bytes( size_t( max_memory / 16 ) );
+
+    // Frames evicted from memory are spilled to disk, if asked to.
+    DiskCache& spill = DiskCache::instance();
+    spill.max_bytes( boost::uint64_t( uiPrefs->uiPrefsDiskCacheSize->value() *
+                                      1000000000.0 ) );
+    spill.directory( uiPrefs->uiPrefsDiskCache->value() ?
+                     uiPrefs->uiPrefsDiskCacheDir->value() : "" );
+
+    ReadAhead::instance().threads( (unsigned)
+                                   uiPrefs->uiPrefsPreloadThreads->value() );
         DBG3;
     bool old = CMedia::eight_bit_caches();
     CMedia::eight_bit_caches( (bool) uiPrefs->uiPrefs8BitCaches->value() );
+    bool old_packed = CMedia::packed_caches();
+    CMedia::packed_caches( (bool) uiPrefs->uiPrefsPackedCaches->value() );
     if ( !CMedia::cache_active() || CMedia::eight_bit_caches() != old ||
+            CMedia::packed_caches() != old_packed ||
             CMedia::cache_scale() != scale )
     {
         view->clear_caches();
@@ -2502,10 +2539,17 @@ void Preferences::save()
     caches.set( "preload", (int) uiPrefs->uiPrefsPreloadCache->value() );
     caches.set( "scale", (int) uiPrefs->uiPrefsCacheScale->value() );
     caches.set( "8bit_caches", (int) uiPrefs->uiPrefs8BitCaches->value() );
+    caches.set( "packed_caches", (int) uiPrefs->uiPrefsPackedCaches->value() );
     caches.set( "fps", (int) uiPrefs->uiPrefsCacheFPS->value() );
     caches.set( "size", (int) uiPrefs->uiPrefsCacheSize->value() );
 
     caches.set( "cache_memory", (float)uiPrefs->uiPrefsCacheMemory->value() );
+    caches.set( "preload_threads",
+                (int) uiPrefs->uiPrefsPreloadThreads->value() );
+    caches.set( "disk_cache", (int) uiPrefs->uiPrefsDiskCache->value() );
+    caches.set( "disk_cache_dir", uiPrefs->uiPrefsDiskCacheDir->value() );
+    caches.set( "disk_cache_size",
+                (float) uiPrefs->uiPrefsDiskCacheSize->value() );
 
     Fl_Preferences loading( base, "loading" );
     loading.set( "load_library", uiPrefs->uiPrefsLoadLibrary->value() );
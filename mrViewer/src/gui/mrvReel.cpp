@@ -53,6 +53,25 @@ uint64_t Reel_t::duration() const
     return maximum() - minimum() + 1;
 }
 
+void Reel_t::cache_priority( const CMedia* img ) const
+{
+    FrameCache& cache = FrameCache::instance();
+    cache.priority( img, priority );
+    if ( img->right_eye() ) cache.priority( img->right_eye(), priority );
+}
+
+void Reel_t::cache_priority( const FrameCache::Priority p )
+{
+    priority = p;
+
+    mrv::MediaList::const_iterator i = images.begin();
+    mrv::MediaList::const_iterator e = images.end();
+    for ( ; i != e; ++i )
+    {
+        cache_priority( (*i)->image() );
+    }
+}
+
 size_t Reel_t::index( const CMedia* const img ) const
 {
     if ( images.empty() ) return std::numeric_limits<size_t>::max();
@@ -33,6 +33,7 @@
 using namespace std;
 
 #include "core/mrvTransition.h"
+#include "core/mrvFrameCache.h"
 #include "mrvMediaList.h"
 
 namespace mrv
@@ -40,7 +41,8 @@ namespace mrv
 
 struct Reel_t
 {
-    Reel_t( const char* n ) : edl(false), name( n ) {}
+    Reel_t( const char* n ) : edl(false), name( n ),
+                              priority( FrameCache::kNormalPriority ) {}
     ~Reel_t() {}
 
     mrv::media media_at( const int64_t f ) const;
@@ -73,10 +75,17 @@ struct Reel_t
     int64_t minimum() const;
     int64_t maximum() const;
 
+    // Set the frame cache eviction priority of all images in the reel
+    void cache_priority( const FrameCache::Priority p );
+
+    // Apply the reel's frame cache priority to an image (and its right eye)
+    void cache_priority( const CMedia* img ) const;
+
     std::atomic<bool> edl;
     std::string       name;
     MediaList         images;
     TransitionList    transitions;
+    FrameCache::Priority priority;   //!< eviction priority in frame cache
 };
 
 typedef boost::shared_ptr< Reel_t > Reel;
@@ -0,0 +1,578 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvScopeEngine.cpp
+ * @author gga
+ * @date   Sun Oct 18 14:20:51 2026
+ *
+ * @brief  Computes histogram, vectorscope and waveform data off the
+ *         drawing thread.
+ *
+ *
+ */
+
+#include <math.h>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#define isfinite(x) _finite(x)
+#endif
+
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/bind.hpp>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Widget.H>
+
+#include "core/mrvThread.h"
+#include "core/mrvColorOps.h"
+#include "core/mrvColorSpaces.h"
+#include "core/mrvScheduler.h"
+#include "core/stubImage.h"
+
+#include "gui/mrvIO.h"
+#include "gui/mrvImageView.h"
+#include "gui/mrvScopeEngine.h"
+#include "mrViewer.h"
+
+
+namespace {
+
+const char* kModule = "scope";
+
+// Results kept per engine, so scrubbing back to a frame is free.
+const size_t kCacheSize = 16;
+
+// Fewest rows (or waveform columns) worth a thread of their own.
+const unsigned kMinRowsPerThread = 64;
+
+typedef mrv::ScopeEngine::Settings Settings;
+
+// Apply the viewer's color pipeline to a pixel, like the scopes always
+// did: normalize, gain, color controls, LUT and gamma.
+inline void display_color( const Settings& s, mrv::ImagePixel& p )
+{
+    if ( s.normalize )
+    {
+        const float span = s.norm_max - s.norm_min;
+        p.r = ( p.r - s.norm_min ) / span;
+        p.g = ( p.g - s.norm_min ) / span;
+        p.b = ( p.b - s.norm_min ) / span;
+    }
+
+    p.r *= s.gain;
+    p.g *= s.gain;
+    p.b *= s.gain;
+
+    Imath::V3f* iop = (Imath::V3f*) &p;
+    if ( s.color_matrix )
+        *iop *= s.matrix;
+
+    if ( s.lut )
+    {
+        Imath::V3f out;
+        s.lut->evaluate( *iop, out );
+        *iop = out;
+    }
+
+    if ( s.gamma )
+    {
+        if ( p.r > 0.0f && isfinite(p.r) )
+            p.r = powf( p.r, s.one_gamma );
+        if ( p.g > 0.0f && isfinite(p.g) )
+            p.g = powf( p.g, s.one_gamma );
+        if ( p.b > 0.0f && isfinite(p.b) )
+            p.b = powf( p.b, s.one_gamma );
+    }
+}
+
+inline unsigned to_byte( const float v )
+{
+    return unsigned( Imath::clamp( v * 255.0f, 0.f, 255.f ) );
+}
+
+// Number of bands to split n rows in.
+unsigned bands( const unsigned n )
+{
+    unsigned threads = mrv::Scheduler::instance().threads();
+    threads = std::min( threads, n / kMinRowsPerThread );
+    if ( threads < 1 ) threads = 1;
+    return threads;
+}
+
+// Run job( band ) for bands [0, n), the first one in this thread.
+template< typename Job >
+void run_bands( Job& job, const unsigned n )
+{
+    mrv::Scheduler::instance().parallel_for( n, boost::bind( &Job::band,
+                                                             &job, _1 ),
+                                             "scope bands" );
+}
+
+// Rows of the selection sampled by each band.
+struct RowBands
+{
+    const mrv::VideoFrame* pic;
+    const Settings&        s;
+    unsigned               rows;   // rows sampled
+    unsigned               count;  // bands
+    unsigned               n;      // pixels sampled per row
+
+    RowBands( const mrv::VideoFrame* p, const Settings& st ) :
+        pic( p ),
+        s( st )
+    {
+        rows  = unsigned( s.ymax - s.ymin ) / s.stepY + 1;
+        n     = unsigned( s.xmax - s.xmin ) / s.stepX + 1;
+        count = bands( rows );
+    }
+
+    unsigned first( const unsigned b ) const {
+        return unsigned( s.ymin ) + ( rows * b / count ) * s.stepY;
+    }
+    unsigned last( const unsigned b ) const {
+        return unsigned( s.ymin ) + ( rows * ( b + 1 ) / count ) * s.stepY;
+    }
+};
+
+struct HistogramJob : public RowBands
+{
+    struct Partial
+    {
+        float red[256];
+        float green[256];
+        float blue[256];
+        float lumma[256];
+    };
+
+    std::vector< Partial > partials;
+
+    HistogramJob( const mrv::VideoFrame* p, const Settings& st ) :
+        RowBands( p, st )
+    {
+        partials.resize( count );
+        memset( &partials[0], 0, sizeof(Partial) * count );
+    }
+
+    void band( const unsigned b )
+    {
+        Partial& h = partials[b];
+        mrv::RowReader read( pic );
+        std::vector< mrv::ImagePixel > row( n );
+        const unsigned y1 = last( b );
+        for ( unsigned y = first( b ); y < y1; y += s.stepY )
+        {
+            read( y, s.xmin, n, &row[0], s.stepX );
+            for ( unsigned i = 0; i < n; ++i )
+            {
+                mrv::ImagePixel& p = row[i];
+                display_color( s, p );
+
+                unsigned r = to_byte( p.r );
+                unsigned g = to_byte( p.g );
+                unsigned bl = to_byte( p.b );
+                ++h.red[r];
+                ++h.green[g];
+                ++h.blue[bl];
+                ++h.lumma[ unsigned( r * 0.30f + g * 0.59f + bl * 0.11f ) ];
+            }
+        }
+    }
+};
+
+struct VectorscopeJob : public RowBands
+{
+    std::vector< std::vector< mrv::ScopeEngine::Point > > points;
+
+    VectorscopeJob( const mrv::VideoFrame* p, const Settings& st ) :
+        RowBands( p, st )
+    {
+        points.resize( count );
+    }
+
+    void band( const unsigned b )
+    {
+        std::vector< mrv::ScopeEngine::Point >& out = points[b];
+        mrv::RowReader read( pic );
+        std::vector< mrv::ImagePixel > row( n );
+        const unsigned y0 = first( b );
+        const unsigned y1 = last( b );
+        out.reserve( size_t( ( y1 - y0 ) / s.stepY + 1 ) * n );
+        for ( unsigned y = y0; y < y1; y += s.stepY )
+        {
+            read( y, s.xmin, n, &row[0], s.stepX );
+            for ( unsigned i = 0; i < n; ++i )
+            {
+                mrv::ImagePixel& p = row[i];
+                display_color( s, p );
+
+                mrv::ImagePixel hsv = mrv::color::rgb::to_hsv( p );
+                float angle = float( ( 15.0 + hsv.r * 360.0 ) * M_PI / 180.0 );
+                float radius = hsv.g * 0.375f;
+
+                mrv::ScopeEngine::Point pt;
+                pt.x = -sinf( angle ) * radius;
+                pt.y =  cosf( angle ) * radius;
+                pt.r = p.r;
+                pt.g = p.g;
+                pt.b = p.b;
+                out.push_back( pt );
+            }
+        }
+    }
+};
+
+// The waveform is split in bands of columns, so each band writes its own
+// pixels and no merge is needed.
+struct WaveformJob
+{
+    const mrv::VideoFrame* pic;
+    const Settings&        s;
+    mrv::VideoFrame*       out;
+    unsigned               count;
+    unsigned               intensity;
+
+    WaveformJob( const mrv::VideoFrame* p, const Settings& st,
+                 mrv::VideoFrame* o ) :
+        pic( p ),
+        s( st ),
+        out( o )
+    {
+        count = bands( unsigned( pic->width() ) );
+        // Skipped rows would make the waveform dimmer.
+        intensity = unsigned( s.intensity * 255 ) * s.stepY;
+    }
+
+    void band( const unsigned b )
+    {
+        const unsigned W  = unsigned( pic->width() );
+        const unsigned H  = unsigned( pic->height() );
+        const unsigned x0 = W * b / count;
+        const unsigned n  = W * ( b + 1 ) / count - x0;
+        if ( n == 0 ) return;
+
+        boost::uint8_t* dst = (boost::uint8_t*) out->data().get();
+        mrv::RowReader read( pic );
+        std::vector< mrv::ImagePixel > row( n );
+        for ( unsigned y = 0; y < H; y += s.stepY )
+        {
+            read( y, x0, n, &row[0] );
+            for ( unsigned i = 0; i < n; ++i )
+            {
+                mrv::ImagePixel p = mrv::color::rgb::to_yuv( row[i] );
+                boost::uint8_t* target = dst + ( 255 - to_byte( p.r ) ) * W +
+                                         x0 + i;
+                *target = boost::uint8_t( std::min( 255U,
+                                                    *target + intensity ) );
+            }
+        }
+    }
+};
+
+} // namespace
+
+
+namespace mrv {
+
+bool ScopeEngine::Settings::operator==( const Settings& b ) const
+{
+    return ( xmin == b.xmin && ymin == b.ymin &&
+             xmax == b.xmax && ymax == b.ymax &&
+             stepX == b.stepX && stepY == b.stepY &&
+             gain == b.gain && one_gamma == b.one_gamma &&
+             gamma == b.gamma && normalize == b.normalize &&
+             norm_min == b.norm_min && norm_max == b.norm_max &&
+             color_matrix == b.color_matrix && matrix == b.matrix &&
+             lut == b.lut && intensity == b.intensity &&
+             live == b.live );
+}
+
+ScopeEngine::ScopeEngine( const Kind kind, Fl_Widget* widget ) :
+    _kind( kind ),
+    _widget( new Fl_Widget*( widget ) ),
+    _stop( false ),
+    _running( false )
+{
+}
+
+ScopeEngine::~ScopeEngine()
+{
+    *_widget = NULL;
+
+    SCOPED_LOCK( _mutex );
+    _stop = true;
+    while ( _running )
+        CONDITION_WAIT( _cond, _mutex );
+}
+
+void ScopeEngine::settings( Settings& s, ViewerUI* ui, const CMedia* img,
+                            int xmin, int ymin, int xmax, int ymax,
+                            const int w, const int h )
+{
+    ImageView* view = ui->uiView;
+    DrawEngine* engine = view->engine();
+    ImageView::PixelValue v = (ImageView::PixelValue)
+                              ui->uiPixelValue->value();
+
+    s.xmin = xmin;
+    s.ymin = ymin;
+    s.xmax = xmax;
+    s.ymax = ymax;
+
+    s.stepX = std::max( ( xmax - xmin + 1 ) / std::max( w, 1 ), 1 );
+    s.stepY = std::max( ( ymax - ymin + 1 ) / std::max( h, 1 ), 1 );
+
+    // Sample a quarter of the pixels while playing, to keep up.
+    if ( view->playback() != CMedia::kStopped )
+    {
+        s.stepX *= 2;
+        s.stepY *= 2;
+    }
+
+    s.gain = view->gain();
+    s.one_gamma = 1.0f / view->gamma();
+    s.gamma = ( v != ImageView::kRGBA_Original &&
+                s.one_gamma != 1.0f );
+
+    s.normalize = false;
+    s.norm_min = 0.0f;
+    s.norm_max = 1.0f;
+    if ( view->normalize() && engine )
+    {
+        s.norm_min = engine->norm_min();
+        s.norm_max = engine->norm_max();
+        s.normalize = ( s.norm_min != 0.0f || s.norm_max != 1.0f );
+    }
+
+    ColorControlsUI* cc = ui->uiColorControls;
+    s.color_matrix = ( cc->uiActive->value() != 0 );
+    if ( s.color_matrix )
+        s.matrix = colorMatrix( cc );
+    else
+        s.matrix.makeIdentity();
+
+    s.lut.reset();
+    if ( engine && view->use_lut() && v == ImageView::kRGBA_Full )
+        s.lut = engine->transform( img );
+
+    s.intensity = 0.0f;
+
+    // Renders write into the same picture as buckets arrive.
+    s.live = ( dynamic_cast< const stubImage* >( img ) != NULL );
+}
+
+ScopeEngine::Result_ptr
+ScopeEngine::result( const mrv::image_type_ptr& pic, const Settings& s )
+{
+    SCOPED_LOCK( _mutex );
+
+    Cache::iterator i = _cache.begin();
+    for ( ; i != _cache.end() && !s.live; )
+    {
+        mrv::image_type_ptr p = i->pic.lock();
+        if ( !p )
+        {
+            i = _cache.erase( i );
+            continue;
+        }
+
+        if ( p == pic && i->settings == s )
+        {
+            _cache.splice( _cache.begin(), _cache, i );
+            return _cache.front().result;
+        }
+        ++i;
+    }
+
+    // Only the latest request matters, older ones are dropped.
+    _pic = pic;
+    _settings = s;
+    if ( !_running )
+    {
+        _running = true;
+        Scheduler::instance().submit( boost::bind( &ScopeEngine::run, this ),
+                                      Scheduler::kInteractive, "scope" );
+    }
+    return _last;
+}
+
+void ScopeEngine::redraw_cb( void* data )
+{
+    WidgetToken* w = (WidgetToken*) data;
+    if ( **w ) (**w)->redraw();
+    delete w;
+}
+
+/**
+ * Task computing pending requests until there are none left.
+ */
+void ScopeEngine::run()
+{
+    while ( true )
+    {
+        mrv::image_type_ptr pic;
+        Settings s;
+        {
+            SCOPED_LOCK( _mutex );
+            if ( _stop || !_pic )
+            {
+                _pic.reset();
+                _running = false;
+                _cond.notify_all();
+                return;
+            }
+
+            pic = _pic;
+            s = _settings;
+            _pic.reset();
+            _settings.lut.reset();
+
+            // Asked again while we were computing it.
+            bool cached = false;
+            Cache::const_iterator i = _cache.begin();
+            for ( ; i != _cache.end() && !s.live; ++i )
+            {
+                if ( i->pic.lock() == pic && i->settings == s )
+                {
+                    cached = true;
+                    break;
+                }
+            }
+            if ( cached ) continue;
+        }
+
+        Result* r = new Result;
+        try
+        {
+            compute( pic, s, *r );
+        }
+        catch( const std::exception& e )
+        {
+            LOG_ERROR( e.what() );
+            delete r;
+            continue;
+        }
+
+        Result_ptr res( r );
+        {
+            SCOPED_LOCK( _mutex );
+            if ( !s.live )
+            {
+                Entry e;
+                e.pic = pic;
+                e.settings = s;
+                e.result = res;
+                _cache.push_front( e );
+                if ( _cache.size() > kCacheSize ) _cache.pop_back();
+            }
+            _last = res;
+        }
+
+        WidgetToken* w = new WidgetToken( _widget );
+        if ( Fl::awake( redraw_cb, w ) != 0 ) delete w;
+    }
+}
+
+void ScopeEngine::compute( const mrv::image_type_ptr& pic,
+                           const Settings& s, Result& r ) const
+{
+    r.maxColor = r.maxLumma = 0;
+    memset( r.red,   0, sizeof(float) * 256 );
+    memset( r.green, 0, sizeof(float) * 256 );
+    memset( r.blue,  0, sizeof(float) * 256 );
+    memset( r.lumma, 0, sizeof(float) * 256 );
+
+    if ( !pic || !pic->data() ) return;
+
+    switch( _kind )
+    {
+    case kHistogram:
+        if ( s.xmax >= s.xmin && s.ymax >= s.ymin )
+            histogram( pic, s, r );
+        break;
+    case kVectorscope:
+        if ( s.xmax >= s.xmin && s.ymax >= s.ymin )
+            vectorscope( pic, s, r );
+        break;
+    case kWaveform:
+        waveform( pic, s, r );
+        break;
+    }
+}
+
+void ScopeEngine::histogram( const mrv::image_type_ptr& pic,
+                             const Settings& s, Result& r ) const
+{
+    HistogramJob job( pic.get(), s );
+    run_bands( job, job.count );
+
+    for ( unsigned b = 0; b < job.count; ++b )
+    {
+        const HistogramJob::Partial& h = job.partials[b];
+        for ( unsigned i = 0; i < 256; ++i )
+        {
+            r.red[i]   += h.red[i];
+            r.green[i] += h.green[i];
+            r.blue[i]  += h.blue[i];
+            r.lumma[i] += h.lumma[i];
+        }
+    }
+
+    for ( unsigned i = 0; i < 256; ++i )
+    {
+        r.maxColor = std::max( r.maxColor, r.red[i] );
+        r.maxColor = std::max( r.maxColor, r.green[i] );
+        r.maxColor = std::max( r.maxColor, r.blue[i] );
+        r.maxLumma = std::max( r.maxLumma, r.lumma[i] );
+    }
+}
+
+void ScopeEngine::vectorscope( const mrv::image_type_ptr& pic,
+                               const Settings& s, Result& r ) const
+{
+    VectorscopeJob job( pic.get(), s );
+    run_bands( job, job.count );
+
+    size_t total = 0;
+    for ( unsigned b = 0; b < job.count; ++b )
+        total += job.points[b].size();
+
+    r.points.reserve( total );
+    for ( unsigned b = 0; b < job.count; ++b )
+        r.points.insert( r.points.end(), job.points[b].begin(),
+                         job.points[b].end() );
+}
+
+//
+// Waveform of the whole picture, with a column per picture column.
+// Only rows are skipped when decimating.
+//
+void ScopeEngine::waveform( const mrv::image_type_ptr& pic,
+                            const Settings& s, Result& r ) const
+{
+    r.waveform.reset( new VideoFrame( pic->frame(), pic->width(), 256, 1,
+                                      VideoFrame::kLumma,
+                                      VideoFrame::kByte ) );
+    memset( r.waveform->data().get(), 0, r.waveform->data_size() );
+
+    WaveformJob job( pic.get(), s, r.waveform.get() );
+    run_bands( job, job.count );
+}
+
+} // namespace mrv
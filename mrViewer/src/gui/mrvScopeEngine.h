@@ -0,0 +1,175 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvScopeEngine.h
+ * @author gga
+ * @date   Sun Oct 18 14:20:51 2026
+ *
+ * @brief  Computes histogram, vectorscope and waveform data off the
+ *         drawing thread.
+ *
+ *
+ */
+
+#ifndef mrvScopeEngine_h
+#define mrvScopeEngine_h
+
+#include <list>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <ImathMatrix.h>
+
+#include "core/mrvFrame.h"
+#include "video/mrvDrawEngine.h"
+
+class Fl_Widget;
+class ViewerUI;
+
+namespace mrv {
+
+class CMedia;
+
+//
+// Each scope widget owns an engine.  When drawing, the widget asks for
+// the scope of the picture shown.  If it was already computed for the
+// same picture and settings, it is returned from the engine's cache.
+// Otherwise the last result is returned, the picture is handed to a
+// task of the Scheduler and the widget is redrawn once its scope is ready.
+//
+class ScopeEngine
+{
+public:
+    typedef boost::mutex              Mutex;
+    typedef boost::condition_variable Condition;
+
+    enum Kind
+    {
+        kHistogram,
+        kVectorscope,
+        kWaveform
+    };
+
+    // How to compute a scope, snapshot of the viewer's state.
+    struct Settings
+    {
+        int      xmin, ymin, xmax, ymax;  //!< area of picture
+        unsigned stepX, stepY;            //!< sample every step'th pixel
+        float    gain;
+        float    one_gamma;
+        bool     gamma;                   //!< apply one_gamma
+        bool     normalize;
+        float    norm_min, norm_max;
+        bool     color_matrix;
+        Imath::M44f matrix;
+        ColorTransform_ptr lut;           //!< LUT to apply or NULL
+        float    intensity;               //!< waveform intensity
+        bool     live;                    //!< picture is rendered in place,
+                                          //!< so results are not reused
+
+        bool operator==( const Settings& b ) const;
+    };
+
+    struct Point
+    {
+        float x, y;      //!< vectorscope position, with radius 1
+        float r, g, b;   //!< color of point
+    };
+
+    struct Result
+    {
+        // Histogram
+        float red[256];
+        float green[256];
+        float blue[256];
+        float lumma[256];
+        float maxColor;
+        float maxLumma;
+
+        // Vectorscope
+        std::vector< Point > points;
+
+        // Waveform, a width x 256 lumma picture
+        mrv::image_type_ptr waveform;
+    };
+
+    typedef boost::shared_ptr< const Result > Result_ptr;
+
+public:
+    ScopeEngine( const Kind kind, Fl_Widget* widget );
+    ~ScopeEngine();
+
+    // Fill settings from the viewer for an area of the picture.  The
+    // steps sample about w x h pixels, and fewer while playing.
+    static void settings( Settings& s, ViewerUI* ui, const CMedia* img,
+                          int xmin, int ymin, int xmax, int ymax,
+                          const int w, const int h );
+
+    // Scope of pic with settings s.  Returns NULL if there is none yet.
+    Result_ptr result( const mrv::image_type_ptr& pic, const Settings& s );
+
+protected:
+    struct Entry
+    {
+        boost::weak_ptr< VideoFrame > pic;
+        Settings                      settings;
+        Result_ptr                    result;
+    };
+
+    typedef std::list< Entry > Cache;
+
+    void run();
+    void compute( const mrv::image_type_ptr& pic, const Settings& s,
+                  Result& r ) const;
+
+    void histogram( const mrv::image_type_ptr& pic, const Settings& s,
+                    Result& r ) const;
+    void vectorscope( const mrv::image_type_ptr& pic, const Settings& s,
+                      Result& r ) const;
+    void waveform( const mrv::image_type_ptr& pic, const Settings& s,
+                   Result& r ) const;
+
+    // Widget to redraw, or NULL once the engine is gone.  Pending awake
+    // callbacks hold a copy, so they never redraw a deleted widget.
+    typedef boost::shared_ptr< Fl_Widget* > WidgetToken;
+
+    static void redraw_cb( void* data );
+
+protected:
+    Kind           _kind;
+    WidgetToken    _widget;
+    Mutex          _mutex;
+    Condition      _cond;     //!< task finished
+    Cache          _cache;    //!< most recently used first
+    Result_ptr     _last;     //!< last result computed
+
+    // Pending request
+    mrv::image_type_ptr _pic;
+    Settings            _settings;
+
+    bool           _stop;
+    bool           _running;  //!< a task is queued or running
+};
+
+} // namespace mrv
+
+#endif // mrvScopeEngine_h
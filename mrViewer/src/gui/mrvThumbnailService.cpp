@@ -0,0 +1,545 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvThumbnailService.cpp
+ * @author gga
+ * @date   Sun Oct 18 16:05:37 2026
+ *
+ * @brief  Creates thumbnails of media in background tasks.
+ *
+ *
+ */
+
+#include <math.h>
+#include <ctime>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#ifdef _WIN32
+#define isfinite(x) _finite(x)
+#endif
+
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/bind.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/filesystem.hpp>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Widget.H>
+#include <ImathMath.h>   // for Imath::clamp
+
+#include "core/mrvThread.h"
+#include "core/mrvHome.h"
+#include "core/mrvColorOps.h"
+#include "core/mrvScheduler.h"
+#include "core/CMedia.h"
+#include "gui/mrvIO.h"
+#include "gui/mrvPreferences.h"
+#include "gui/mrvThumbnailService.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const char* kModule = "thumb";
+
+// Bump when thumbnails are made differently or the file layout changes.
+const unsigned kThumbCacheVersion = 1;
+const char     kThumbCacheMagic[8] = { 'm', 'r', 'v', 'T', 'H', 'U', 'M', 'B' };
+
+}
+
+
+namespace mrv {
+
+ThumbnailService& ThumbnailService::instance()
+{
+    // Never destroyed, as its tasks may hold media still in use at exit.
+    static ThumbnailService* service = new ThumbnailService;
+    return *service;
+}
+
+ThumbnailService::ThumbnailService() :
+    _serial( 0 ),
+    _running( 0 ),
+    _stop( false )
+{
+    // Thumbnails are small; a few at once keep up with scrolling and
+    // leave the cores to decoding.
+    _max = Scheduler::instance().threads() / 2;
+    _max = std::max( 1U, std::min( _max, 4U ) );
+}
+
+ThumbnailService::~ThumbnailService()
+{
+    SCOPED_LOCK( _mutex );
+    _stop = true;
+    _requests.clear();
+    while ( _running > 0 )
+        CONDITION_WAIT( _cond, _mutex );
+}
+
+void ThumbnailService::request( const mrv::media& m,
+                                const unsigned W, const unsigned H,
+                                const int priority, Fl_Widget* widget )
+{
+    if ( !m ) return;
+
+    SCOPED_LOCK( _mutex );
+
+    const gui::media* key = m.get();
+    const unsigned damage = m->thumbnail_damage();
+
+    // Already being made
+    WorkingMap::const_iterator w = _working.find( key );
+    if ( w != _working.end() && w->second == damage ) return;
+
+    RequestMap::iterator i = _requests.find( key );
+    if ( i != _requests.end() )
+    {
+        Request& r = i->second;
+        r.W = W;
+        r.H = H;
+        r.priority = priority;
+        r.damage = damage;
+        r.widget = widget;
+        return;
+    }
+
+    Request r;
+    r.id = key;
+    r.m = m;
+    r.W = W;
+    r.H = H;
+    r.priority = priority;
+    r.serial = _serial++;
+    r.damage = damage;
+    r.widget = widget;
+    _requests.insert( std::make_pair( key, r ) );
+    pump();
+}
+
+void ThumbnailService::cancel( const gui::media* m )
+{
+    SCOPED_LOCK( _mutex );
+    _requests.erase( m );
+}
+
+/**
+ * Pick the pending request to make next.  Called with _mutex locked.
+ */
+bool ThumbnailService::next_request( Request& r )
+{
+    if ( _stop || _requests.empty() ) return false;
+
+    RequestMap::iterator best = _requests.begin();
+    RequestMap::iterator i = best;
+    for ( ++i; i != _requests.end(); ++i )
+    {
+        const Request& a = i->second;
+        const Request& b = best->second;
+        if ( a.priority < b.priority ||
+             ( a.priority == b.priority && a.serial < b.serial ) )
+            best = i;
+    }
+
+    r = best->second;
+    _working[ best->first ] = r.damage;
+    _requests.erase( best );
+    return true;
+}
+
+/**
+ * Queue pending requests as background tasks, a few at a time, so
+ * later requests can still change which ones are made first.  Called
+ * with _mutex locked.
+ */
+void ThumbnailService::pump()
+{
+    Request r;
+    while ( _running < _max && next_request( r ) )
+    {
+        ++_running;
+        Scheduler::instance().submit( boost::bind( &ThumbnailService::run,
+                                                   this, r ),
+                                      Scheduler::kBackground, "thumbnail" );
+    }
+}
+
+void ThumbnailService::run( const Request& r )
+{
+    work( r );
+
+    SCOPED_LOCK( _mutex );
+    --_running;
+    _cond.notify_all();
+    pump();
+}
+
+void ThumbnailService::work( const Request& r )
+{
+    Result res;
+    res.id = r.id;
+    res.m = r.m.lock();
+    res.damage = r.damage;
+    res.widget = r.widget;
+    res.ok = false;
+    res.finished = false;
+
+    if ( res.m && !res.m->thumbnail_frozen() )
+    {
+        CMedia* img = res.m->image();
+        if ( img->stopped() )
+        {
+            {
+                typedef CMedia::Mutex Mutex;
+                Mutex& mtx = img->video_mutex();
+                SCOPED_LOCK( mtx );
+                res.key = cache_key( img, r.W, r.H );
+            }
+
+            if ( load( res.key, res.p ) )
+            {
+                res.ok = res.finished = true;
+                res.key.clear();
+            }
+            else
+            {
+                res.pic = grab( img, r.W, r.H );
+                res.ok = ( res.pic && res.pic->width() > 0 );
+
+                // OCIO baking changes the locale, so it is left to the
+                // main thread.
+                if ( res.ok && !Preferences::use_ocio )
+                {
+                    finish( img, res.pic, res.p );
+                    res.pic.reset();
+                    res.finished = true;
+                    save( res.key, res.p );
+                    res.key.clear();
+                }
+            }
+        }
+    }
+
+    {
+        SCOPED_LOCK( _mutex );
+        _working.erase( res.id );
+        // The media is released in the main thread, by deliver().
+        _results.push_back( res );
+        res.m.reset();
+    }
+
+    Fl::awake( deliver_cb, this );
+}
+
+void ThumbnailService::deliver_cb( void* data )
+{
+    ThumbnailService* t = (ThumbnailService*) data;
+    t->deliver();
+}
+
+void ThumbnailService::deliver()
+{
+    ResultList results;
+    {
+        SCOPED_LOCK( _mutex );
+        results.swap( _results );
+    }
+
+    std::vector< Fl_Widget* > widgets;
+
+    ResultList::iterator i = results.begin();
+    for ( ; i != results.end(); ++i )
+    {
+        Result& r = *i;
+        if ( !r.m ) continue;
+
+        if ( r.ok && !r.finished )
+        {
+            finish( r.m->image(), r.pic, r.p );
+            save( r.key, r.p );
+        }
+        r.pic.reset();
+
+        if ( r.ok && !r.m->thumbnail_frozen() )
+            r.m->thumbnail( r.p.w, r.p.h, &r.p.rgb[0], r.damage );
+        else
+            r.m->thumbnail_made( r.damage );
+
+        if ( r.widget &&
+             std::find( widgets.begin(), widgets.end(), r.widget ) ==
+             widgets.end() )
+            widgets.push_back( r.widget );
+    }
+
+    std::vector< Fl_Widget* >::iterator w = widgets.begin();
+    for ( ; w != widgets.end(); ++w )
+        (*w)->redraw();
+}
+
+bool ThumbnailService::render( CMedia* img, const unsigned W,
+                               const unsigned H, Picture& p )
+{
+    std::string key;
+    {
+        typedef CMedia::Mutex Mutex;
+        Mutex& mtx = img->video_mutex();
+        SCOPED_LOCK( mtx );
+        key = cache_key( img, W, H );
+    }
+
+    if ( load( key, p ) ) return true;
+
+    mrv::image_type_ptr pic = grab( img, W, H );
+    if ( !pic || pic->width() == 0 ) return false;
+
+    finish( img, pic, p );
+    save( key, p );
+    return true;
+}
+
+/**
+ * Get the picture of an image, resized to fit in a thumbnail.
+ *
+ * @param img image
+ * @param W   maximum width of thumbnail
+ * @param H   height of thumbnail
+ *
+ * @return resized picture, or NULL if image has none
+ */
+mrv::image_type_ptr ThumbnailService::grab( CMedia* img, const unsigned W,
+                                            const unsigned H )
+{
+    // Make sure frame memory is not deleted
+    typedef CMedia::Mutex Mutex;
+    Mutex& mtx = img->video_mutex();
+    SCOPED_LOCK( mtx );
+
+    // Audio only clip?  Return
+    mrv::image_type_ptr pic = img->left();
+
+    if ( !pic ) {
+        LOG_ERROR( _("Empty pic file for media ") << img->name() );
+        return mrv::image_type_ptr();
+    }
+
+    // Frames decoded for a magnified view are black outside of it.
+    if ( !pic->region().empty() ) return mrv::image_type_ptr();
+
+    unsigned dw = pic->width();
+    unsigned dh = pic->height();
+    if ( dw == 0 || dh == 0 ) {
+        LOG_ERROR( _("Media file has zero size in width or height") );
+        return mrv::image_type_ptr();
+    }
+
+    unsigned int h = H;
+
+    float yScale = (float)(h+0.5) / (float)dh;
+    unsigned int w = unsigned( (float)(dw+0.5) * (float)yScale );
+    if ( w > W ) w = W;
+
+    // Resize image to thumbnail size
+    pic.reset( pic->quick_resize( w, h ) );
+    return pic;
+}
+
+/**
+ * Turn a resized picture into 8-bit thumbnail pixels, baking OCIO and
+ * the image's gamma.
+ *
+ * @param img image of picture
+ * @param pic picture returned by grab()
+ * @param p   thumbnail pixels returned
+ */
+void ThumbnailService::finish( const CMedia* img,
+                               const mrv::image_type_ptr& pic,
+                               Picture& p )
+{
+    // quick_resize() returns float pixels for half and float pictures.
+    if ( mrv::Preferences::use_ocio &&
+         pic->pixel_type() == mrv::image_type::kFloat )
+    {
+        bake_ocio( pic, img );
+    }
+
+    const unsigned w = pic->width();
+    const unsigned h = pic->height();
+    p.w = w;
+    p.h = h;
+    p.rgb.resize( size_t(w) * h * 3 );
+
+    boost::uint8_t* ptr = &p.rgb[0];
+
+    // Copy to thumbnail and gamma it
+    float gamma = 1.0f / img->gamma();
+    mrv::RowReader read( pic.get() );
+    std::vector< CMedia::Pixel > row( w );
+    for (unsigned y = 0; y < h; ++y )
+    {
+        read( y, 0, w, &row[0] );
+        for (unsigned x = 0; x < w; ++x )
+        {
+            CMedia::Pixel& fp = row[x];
+            if ( gamma != 1.0f )
+            {
+                using namespace std;
+                if ( isfinite( fp.r ) )
+                    fp.r = Imath::Math<float>::pow( fp.r, gamma );
+                if ( isfinite( fp.g ) )
+                    fp.g = Imath::Math<float>::pow( fp.g, gamma );
+                if ( isfinite( fp.b ) )
+                    fp.b = Imath::Math<float>::pow( fp.b, gamma );
+            }
+
+            *ptr++ = (uchar)(Imath::clamp(fp.r, 0.f, 1.f) * 255.0f);
+            *ptr++ = (uchar)(Imath::clamp(fp.g, 0.f, 1.f) * 255.0f);
+            *ptr++ = (uchar)(Imath::clamp(fp.b, 0.f, 1.f) * 255.0f);
+        }
+    }
+}
+
+std::string ThumbnailService::cache_key( const CMedia* img,
+                                         const unsigned W, const unsigned H )
+{
+    std::ostringstream s;
+    s << img->frame() << " " << W << "x" << H
+      << " gamma " << img->gamma();
+    if ( img->channel() ) s << " channel " << img->channel();
+    if ( Preferences::use_ocio )
+        s << " ocio " << img->ocio_input_color_space()
+          << " " << Preferences::OCIO_Display
+          << " " << Preferences::OCIO_View;
+
+    return cache_key( img->sequence_filename( img->frame() ), s.str() );
+}
+
+/**
+ * Key of a thumbnail in the disk cache.
+ *
+ * @param file     file thumbnail is made from
+ * @param settings anything else the thumbnail depends on
+ *
+ * @return key, or an empty string if file does not exist
+ */
+std::string ThumbnailService::cache_key( const std::string& file,
+                                         const std::string& settings )
+{
+    boost::system::error_code ec;
+    std::time_t t = fs::last_write_time( fs::path( file ), ec );
+    if ( ec ) return std::string();
+
+    std::ostringstream s;
+    s << "v" << kThumbCacheVersion << " " << file << " " << t
+      << " " << settings;
+    return s.str();
+}
+
+namespace {
+
+std::string cache_file( const std::string& key )
+{
+    char name[32];
+    sprintf( name, "%016llx.thumb",
+             (unsigned long long) boost::hash_value( key ) );
+
+    std::string file = mrv::homepath();
+    file += "/.filmaura/thumbnails/";
+    file += name;
+    return file;
+}
+
+}
+
+bool ThumbnailService::load( const std::string& key, Picture& p )
+{
+    if ( key.empty() ) return false;
+
+    std::ifstream f( cache_file( key ).c_str(), std::ios::binary );
+    if ( !f.is_open() ) return false;
+
+    char magic[8];
+    boost::uint32_t version, len, w, h;
+    f.read( magic, 8 );
+    f.read( (char*) &version, sizeof(version) );
+    f.read( (char*) &len, sizeof(len) );
+    if ( !f || memcmp( magic, kThumbCacheMagic, 8 ) != 0 ||
+         version != kThumbCacheVersion || len != key.size() )
+        return false;
+
+    // Hashes may collide, so the key is stored too.
+    std::string k( len, '\0' );
+    f.read( &k[0], len );
+    f.read( (char*) &w, sizeof(w) );
+    f.read( (char*) &h, sizeof(h) );
+    if ( !f || k != key || w == 0 || h == 0 || w > 4096 || h > 4096 )
+        return false;
+
+    p.w = w;
+    p.h = h;
+    p.rgb.resize( size_t(w) * h * 3 );
+    f.read( (char*) &p.rgb[0], p.rgb.size() );
+    return bool(f);
+}
+
+void ThumbnailService::save( const std::string& key, const Picture& p )
+{
+    if ( key.empty() || p.rgb.empty() ) return;
+
+    const std::string file = cache_file( key );
+
+    boost::system::error_code ec;
+    fs::create_directories( fs::path( file ).parent_path(), ec );
+    if ( ec ) return;
+
+    // Written under a temporary name and renamed, so other viewers never
+    // read half a thumbnail.
+    const fs::path tmp = fs::unique_path( file + ".%%%%-%%%%.tmp", ec );
+    if ( ec ) return;
+
+    {
+        std::ofstream f( tmp.string().c_str(), std::ios::binary );
+        if ( !f.is_open() ) return;
+
+        boost::uint32_t version = kThumbCacheVersion;
+        boost::uint32_t len = (boost::uint32_t) key.size();
+        boost::uint32_t w = p.w;
+        boost::uint32_t h = p.h;
+        f.write( kThumbCacheMagic, 8 );
+        f.write( (const char*) &version, sizeof(version) );
+        f.write( (const char*) &len, sizeof(len) );
+        f.write( key.c_str(), len );
+        f.write( (const char*) &w, sizeof(w) );
+        f.write( (const char*) &h, sizeof(h) );
+        f.write( (const char*) &p.rgb[0], p.rgb.size() );
+        if ( !f )
+        {
+            f.close();
+            fs::remove( tmp, ec );
+            return;
+        }
+    }
+
+    fs::rename( tmp, file, ec );
+    if ( ec ) fs::remove( tmp, ec );
+}
+
+} // namespace mrv
@@ -0,0 +1,157 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2022  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvThumbnailService.h
+ * @author gga
+ * @date   Sun Oct 18 16:05:37 2026
+ *
+ * @brief  Creates thumbnails of media in background tasks.
+ *
+ *
+ */
+
+#ifndef mrvThumbnailService_h
+#define mrvThumbnailService_h
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "core/mrvFrame.h"
+#include "gui/mrvMedia.h"
+
+class Fl_Widget;
+
+namespace mrv {
+
+class CMedia;
+
+//
+// Thumbnails are made by background tasks of the Scheduler, a few at a
+// time.  Pending requests are served lowest priority first, so the
+// browser numbers its visible items from the top and cancels the ones
+// that scroll out of view.  Finished
+// thumbnails are handed to their media in the main thread, which then
+// redraws the widget that asked for them.
+//
+// Thumbnails of files are also kept on disk, keyed by path, modification
+// time, frame and display settings, so a reel opens without decoding its
+// clips again.
+//
+class ThumbnailService
+{
+public:
+    typedef boost::mutex              Mutex;
+    typedef boost::condition_variable Condition;
+
+    // Thumbnail pixels, 8-bit RGB.
+    struct Picture
+    {
+        unsigned w, h;
+        std::vector< boost::uint8_t > rgb;
+    };
+
+public:
+    static ThumbnailService& instance();
+
+    // Make a thumbnail of m, at most W x H, and redraw widget when done.
+    // A new request for the same media replaces the pending one.
+    void request( const mrv::media& m, const unsigned W, const unsigned H,
+                  const int priority, Fl_Widget* widget );
+
+    // Drop the pending request of m, if any.
+    void cancel( const gui::media* m );
+
+    // Make a thumbnail in this thread.  Returns false if img has no
+    // picture.
+    static bool render( CMedia* img, const unsigned W, const unsigned H,
+                        Picture& p );
+
+    // Disk cache.  An empty key means the picture is not from a file.
+    static std::string cache_key( const CMedia* img,
+                                  const unsigned W, const unsigned H );
+    static std::string cache_key( const std::string& file,
+                                  const std::string& settings );
+    static bool load( const std::string& key, Picture& p );
+    static void save( const std::string& key, const Picture& p );
+
+protected:
+    ThumbnailService();
+    ~ThumbnailService();
+
+    struct Request
+    {
+        const gui::media*             id;
+        boost::weak_ptr< gui::media > m;
+        unsigned   W, H;
+        int        priority;
+        unsigned   serial;
+        unsigned   damage;   //!< media's thumbnail damage when asked
+        Fl_Widget* widget;
+    };
+
+    struct Result
+    {
+        const gui::media*   id;
+        mrv::media          m;
+        unsigned            damage;
+        Fl_Widget*          widget;
+        bool                ok;
+        bool                finished;  //!< picture is ready
+        mrv::image_type_ptr pic;       //!< resized, to finish in main thread
+        std::string         key;
+        Picture             p;
+    };
+
+    typedef std::map< const gui::media*, Request >  RequestMap;
+    typedef std::map< const gui::media*, unsigned > WorkingMap;
+    typedef std::vector< Result >                   ResultList;
+
+    void pump();
+    void run( const Request& r );
+    bool next_request( Request& r );
+    void work( const Request& r );
+
+    static mrv::image_type_ptr grab( CMedia* img,
+                                     const unsigned W, const unsigned H );
+    static void finish( const CMedia* img, const mrv::image_type_ptr& pic,
+                        Picture& p );
+
+    static void deliver_cb( void* data );
+    void deliver();
+
+protected:
+    Mutex      _mutex;
+    Condition  _cond;      //!< a task finished
+    RequestMap _requests;
+    WorkingMap _working;   //!< media being worked on, and its damage
+    ResultList _results;
+    unsigned   _serial;
+    unsigned   _max;       //!< tasks at once
+    unsigned   _running;   //!< tasks queued or running
+    bool       _stop;
+};
+
+} // namespace mrv
+
+#endif // mrvThumbnailService_h
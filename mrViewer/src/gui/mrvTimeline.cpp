@@ -402,29 +402,52 @@ void Timeline::draw_cacheline( CMedia* img, int64_t pos, int64_t size,
     int64_t max = frame + size;
     if ( mx < max ) max = mx;
 
-
-    // If too many frames, playback suffers, so we exit here
-    if ( max - j > uiMain->uiPrefs->uiPrefsMaxCachelineFrames->value() ) return;
-
     int rx = r.x() + int(slider_size()-1)/2;
     int ry = r.y() + r.h()/2;
     int ww = r.w();
     int hh = r.h() - 8;
 
-    fl_push_clip( rx, ry, ww, hh );
-
     CMedia::Cache c = CMedia::kLeftCache;
-    fl_color( FL_DARK_GREEN );
-    fl_line_style( FL_SOLID, 1 );
+    Fl_Color color = FL_DARK_GREEN;
 
     if ( ( img->stereo_output() != CMedia::kNoStereo &&
             img->stereo_output() != CMedia::kStereoLeft ) ||
             img->stereo_input() > CMedia::kSeparateLayersInput )
     {
         c = CMedia::kStereoCache;
-        fl_color( FL_GREEN );
+        color = FL_GREEN;
+    }
+
+    // Images that keep their cached frames as runs draw them in time
+    // proportional to the runs, however long the clip is.
+    CacheRuns::RunList runs;
+    if ( img->cached_runs( j - pos + 1, max - pos + 1, c, runs ) )
+    {
+        fl_push_clip( rx, ry, ww, hh );
+        fl_color( color );
+        fl_line_style( FL_SOLID, 1 );
+
+        CacheRuns::RunList::const_iterator i = runs.begin();
+        for ( ; i != runs.end(); ++i )
+        {
+            int64_t j2 = i->second + pos;  // first frame not cached
+            if ( j2 > max ) j2 = max;
+            int dx  = rx + slider_position( double(i->first + pos - 1), ww );
+            int dx2 = rx + slider_position( double(j2), ww );
+            fl_rectf( dx, ry, dx2-dx, hh );
+        }
+
+        fl_pop_clip();
+        return;
     }
 
+    // If too many frames, playback suffers, so we exit here
+    if ( max - j > uiMain->uiPrefs->uiPrefsMaxCachelineFrames->value() ) return;
+
+    fl_push_clip( rx, ry, ww, hh );
+    fl_color( color );
+    fl_line_style( FL_SOLID, 1 );
+
 
 
 #define NO_FRAME_VALUE std::numeric_limits<int>::min()
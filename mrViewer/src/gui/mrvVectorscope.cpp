@@ -57,7 +57,8 @@ namespace mrv
 {
 
 Vectorscope::Vectorscope( int x, int y, int w, int h, const char* l ) :
-Fl_Gl_Window( x, y, w, h, l )
+Fl_Gl_Window( x, y, w, h, l ),
+_engine( new ScopeEngine( ScopeEngine::kVectorscope, this ) )
 {
     box( FL_NO_BOX );
     // color( FL_BLACK );
@@ -65,6 +66,11 @@ Fl_Gl_Window( x, y, w, h, l )
     tooltip( _("Mark an area in the image with the left mouse button") );
 }
 
+Vectorscope::~Vectorscope()
+{
+    delete _engine; _engine = NULL;
+}
+
 
 void Vectorscope::draw_grid(const mrv::Recti& r)
 {
@@ -215,28 +221,6 @@ void Vectorscope::draw()
 
 
 
-void Vectorscope::draw_pixel( const mrv::Recti& r,
-                              const CMedia::Pixel& rgb,
-                              const CMedia::Pixel& hsv )
-{
-    glColor4f( rgb.r, rgb.g, rgb.b, 1.0f );
-
-    int W2 = (r.w() + diameter_) / 2;
-    int H2 = (r.h() + diameter_ )/ 2;
-
-    glDisable( GL_TEXTURE_2D );
-    glDisable( GL_TEXTURE_3D );
-
-    glPushMatrix();
-    glTranslatef( W2, H2, 0 );
-    glRotatef( 15.0 + hsv.r * 360.0f, 0, 0, 1 );
-    glScalef( hsv.g * 0.375f, hsv.g * 0.375, 1 );
-    glBegin( GL_POINTS );
-    glVertex2i( 0, diameter_ );
-    glEnd();
-    glPopMatrix();
-}
-
 void Vectorscope::draw_pixels( const mrv::Recti& r )
 {
     mrv::media m = uiMain->uiView->foreground();
@@ -284,80 +268,30 @@ void Vectorscope::draw_pixels( const mrv::Recti& r )
 
 
 
-    unsigned stepX = (xmax - xmin + 1) / w();
-    unsigned stepY = (ymax - ymin + 1) / h();
-    if ( stepX < 1 ) stepX = 1;
-    if ( stepY < 1 ) stepY = 1;
-
     assert( xmax < (int) pic->width() );
     assert( ymax < (int) pic->height() );
 
-    ImageView* view = uiMain->uiView;
-    mrv::DrawEngine* engine = view->engine();
+    ScopeEngine::Settings s;
+    ScopeEngine::settings( s, uiMain, img, xmin, ymin, xmax, ymax,
+                           w(), h() );
+    ScopeEngine::Result_ptr res = _engine->result( pic, s );
+    if ( !res ) return;
 
-    ImageView::PixelValue v = (ImageView::PixelValue)
-                              uiMain->uiPixelValue->value();
-
-    float gain = view->gain();
-    float gamma = view->gamma();
-    float one_gamma = 1.0f / gamma;
-
-    bool do_gamma = true;
-    if ( mrv::is_equal( one_gamma, 1.0f ) ) do_gamma = false;
+    int W2 = (r.w() + diameter_) / 2;
+    int H2 = (r.h() + diameter_ )/ 2;
 
+    glDisable( GL_TEXTURE_2D );
+    glDisable( GL_TEXTURE_3D );
 
-    CMedia::Pixel rp;
-    for ( unsigned y = ymin; y <= (unsigned)ymax; y += stepY )
+    glBegin( GL_POINTS );
+    std::vector< ScopeEngine::Point >::const_iterator i = res->points.begin();
+    std::vector< ScopeEngine::Point >::const_iterator e = res->points.end();
+    for ( ; i != e; ++i )
     {
-        for ( unsigned x = xmin; x <= (unsigned)xmax; x += stepX )
-        {
-            CMedia::Pixel op = pic->pixel( x, y );
-
-            if ( view->normalize() )
-            {
-                view->normalize( op );
-            }
-
-            op.r *= gain;
-            op.g *= gain;
-            op.b *= gain;
-
-            ColorControlsUI* cc = uiMain->uiColorControls;
-            if ( cc->uiActive->value() )
-            {
-                const Imath::M44f& m = colorMatrix(cc);
-                Imath::V3f* iop = (Imath::V3f*)&op;
-                *iop *= m;
-            }
-
-
-
-            if ( view->use_lut() && v == ImageView::kRGBA_Full )
-            {
-                Imath::V3f* ov = (Imath::V3f*) &op;
-                Imath::V3f* rv = (Imath::V3f*) &rp;
-                engine->evaluate( img, *ov, *rv );
-            }
-            else
-            {
-                rp = op;
-            }
-
-            if ( do_gamma && v != ImageView::kRGBA_Original )
-            {
-                if ( rp.r > 0.0f && isfinite(rp.r) )
-                    rp.r = powf(rp.r, one_gamma);
-                if ( rp.g > 0.0f && isfinite(rp.g) )
-                    rp.g = powf(rp.g, one_gamma);
-                if ( rp.b > 0.0f && isfinite(rp.b) )
-                    rp.b = powf(rp.b, one_gamma);
-            }
-
-            CMedia::Pixel hsv = color::rgb::to_hsv( rp );
-            draw_pixel( r, rp, hsv );
-        }
+        glColor4f( i->r, i->g, i->b, 1.0f );
+        glVertex2f( W2 + i->x * diameter_, H2 + i->y * diameter_ );
     }
-
+    glEnd();
 }
 
 }
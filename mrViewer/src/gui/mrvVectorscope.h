@@ -31,6 +31,7 @@
 
 #include "core/CMedia.h"
 #include "core/mrvRectangle.h"
+#include "gui/mrvScopeEngine.h"
 
 class ViewerUI;
 
@@ -40,6 +41,7 @@ class Vectorscope : public Fl_Gl_Window
 {
 public:
     Vectorscope( int x, int y, int w, int h, const char* l = 0 );
+    virtual ~Vectorscope();
 
     virtual void draw();
 
@@ -50,12 +52,11 @@ public:
 protected:
     void draw_grid( const mrv::Recti& r );
     void draw_pixels( const mrv::Recti& r );
-    void draw_pixel( const mrv::Recti& r,
-                     const CMedia::Pixel& rgb,
-                     const CMedia::Pixel& hsv );
 
     int diameter_;
 
+    ScopeEngine* _engine;
+
     ViewerUI* uiMain;
 };
 
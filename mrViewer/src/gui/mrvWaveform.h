@@ -32,6 +32,7 @@
 
 #include "core/CMedia.h"
 #include "core/mrvRectangle.h"
+#include "gui/mrvScopeEngine.h"
 
 class ViewerUI;
 
@@ -55,15 +56,11 @@ public:
     }
 
 protected:
-    void create_image( const mrv::image_type_ptr pic );
     void draw_grid( const mrv::Recti& r );
     void draw_pixels( const mrv::Recti& r );
-    void draw_pixel( const mrv::Recti& r,
-                     const float x,
-                     const CMedia::Pixel& hsv );
 
     float _intensity;
-    mrv::image_type_ptr in;  // input picture (used when format is not 8 bits)
+    ScopeEngine* _engine;
     mrv::image_type_ptr out; // waveform image data
     Fl_RGB_Image* fli; // waveform b&w image
     ViewerUI* uiMain;
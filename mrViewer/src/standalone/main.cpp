@@ -59,6 +59,7 @@ namespace fs = boost::filesystem;
 #include "core/mrvI8N.h"
 #include "core/mrvException.h"
 #include "core/mrvCPU.h"
+#include "core/mrvFramePacing.h"
 
 #include "gui/mrvLanguages.h"
 #include "gui/mrvImageBrowser.h"
@@ -589,6 +590,11 @@ int main( int argc, const char** argv )
               ui->uiView->fps( opts.fps );
           }
 
+          if ( !opts.pacing_csv.empty() )
+          {
+              mrv::FramePacing::instance().csv( opts.pacing_csv );
+          }
+
           if ( single_instance )
               Fl::add_timeout( 1.0, load_new_files );
 
@@ -34,6 +34,7 @@
 #include <tclap/CmdLine.h>
 
 #include "core/mrvI8N.h"
+#include "core/mrvDirectoryIndex.h"
 #include "core/mrvString.h"
 #include "core/mrvServer.h"
 #include "gui/mrvIO.h"
@@ -185,20 +186,9 @@ void parse_directory( const std::string& fileroot,
    stringArray files;
 
 
-   {
-      // default constructor yields path iter. end
-      fs::directory_iterator e;
-      for ( fs::directory_iterator i( fileroot ) ; i != e; ++i )
-      {
-         if ( !fs::exists( *i ) || fs::is_directory( *i ) )
-            continue;
-
-         std::string file = (*i).path().string();
-         files.push_back( file );
-      }
-   }
-
-   std::sort( files.begin(), files.end() );
+   // Sorted already.  Also indexes the sequences for
+   // get_sequence_limits() below.
+   DirectoryIndex::instance().files( fileroot, files );
 
    {
       stringArray::iterator i = files.begin();
@@ -479,6 +469,11 @@ void parse_command_line( const int argc, const char** argv,
     aoffset( N_("o"), N_("audio_offset"),
              _("Set added audio offset."), false, "offset");
 
+    ValueArg< std::string >
+    apacing( N_(""), N_("pacing_csv"),
+             _("Append frame timing of each playback to a CSV file."),
+             false, "", "file" );
+
 #ifdef USE_STEREO
     MultiArg< std::string >
     astereo( N_("s"), N_("stereo"),
@@ -512,6 +507,7 @@ void parse_command_line( const int argc, const char** argv,
     cmd.add(aattrs);
     cmd.add(acolorspace);
     cmd.add(aoffset);
+    cmd.add(apacing);
 #ifdef USE_STEREO
     cmd.add(astereo);
     cmd.add(astereo_input);
@@ -541,6 +537,7 @@ void parse_command_line( const int argc, const char** argv,
     opts.fps  = afps.getValue();
     opts.bgfile = abg.getValue();
     opts.run    = arun.getValue();
+    opts.pacing_csv = apacing.getValue();
     opts.stereo_output = astereo_output.getValue();
     opts.stereo_input = astereo_input.getValue();
 
@@ -52,6 +52,7 @@ typedef std::vector< std::string > stringArray;
       std::string stereo_output;
 
       std::string host;
+      std::string pacing_csv;
       stringArray audios;
       unsigned short port;
       float fps;
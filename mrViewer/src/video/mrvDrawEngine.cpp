@@ -28,6 +28,7 @@
 
 #include "sys/stat.h"
 
+#include <algorithm>
 #include <cassert>
 #include <limits>
 
@@ -43,9 +44,12 @@
 #  include <math.h>
 #endif
 
+#ifdef MR_SSE
+#include <xmmintrin.h>
+#endif
+
 #define BOOST_BIND_GLOBAL_PLACEHOLDERS
 #include <boost/bind.hpp>
-#include <boost/thread/thread.hpp>
 
 #include <Iex.h>
 #include <ImathMath.h> // for Math:: functions
@@ -63,6 +67,7 @@
 #include "mrvDrawEngine.h"
 #include "mrvThread.h"
 #include "core/mrvSSE.h"
+#include "core/mrvScheduler.h"
 
 using namespace Imath;
 using namespace std;
@@ -75,89 +80,6 @@ namespace {
 const char* kModule = "draw";
 
 
-#pragma pack(push,16) /* Must ensure class & union 16-B aligned */
-
-struct RgbaGainGamma
-{
-    F32vec4 m, g, ff;
-
-    RgbaGainGamma (float gain, float gamma, float scale = 1.0f);
-    float operator ()(const float x);
-
-    F32vec4 operator()(const F32vec4& h );
-
-    static F32vec4 oo;
-};
-
-#pragma pack(pop)
-
-
-F32vec4 RgbaGainGamma::oo = F32vec4( 0.0f, 0.0f, 0.0f, 0.0f );
-
-
-RgbaGainGamma::RgbaGainGamma (float gain, float gamma, float scale ):
-    m( F32vec4( 1.0f, gain, gain, gain ) ),
-    g( F32vec4( 1.0f / gamma, 1.0f / gamma, 1.0f / gamma, 1.0f / gamma ) ),
-    ff( F32vec4( scale, scale, scale, scale ) )
-{}
-
-
-float
-RgbaGainGamma::operator ()(float x)
-{
-    //
-    // Exposure
-    //
-    x *= *((float*)&m+1);
-
-    //
-    // RgbaGainGamma
-    //
-    if ( x > 0.f )
-        x = Imath::Math<float>::pow(x, *((float*)&g+1));
-
-    //
-    // Scale and clamp
-    //
-    return clamp (x, 0.f, 1.0f);
-}
-
-
-F32vec4
-RgbaGainGamma::operator()( const F32vec4& h )
-{
-    F32vec4 x = h;
-    float* f = (float*)&x;
-
-    //
-    // Exposure
-    //
-    x *= m;
-
-    // From apple's vfp.h, this should really be:
-    //
-    // *x = vpowf( *x, g );
-    //
-    // not sure what to do on windows/linux yet
-
-    if ( f[0] > 0.f )
-        f[0] = Imath::Math<float>::pow(f[0], *((float*)&g+1));
-    if ( f[1] > 0.f )
-        f[1] = Imath::Math<float>::pow(f[1], *((float*)&g+1));
-    if ( f[2] > 0.f )
-        f[2] = Imath::Math<float>::pow(f[2], *((float*)&g+1));
-    if ( f[3] > 0.f )
-        f[3] = Imath::Math<float>::pow(f[3], *((float*)&g+1));
-
-    // Clamp
-    x = select_lt( x, oo, oo, x );
-    x = select_gt( x, ff, ff, x );
-
-    return x;
-}
-
-
-
 //
 //  Dithering: Reducing the raw 16-bit pixel data to 8 bits for the
 //  OpenGL frame buffer can sometimes lead to contouring in smooth
@@ -181,251 +103,179 @@ dither (float v, int x, int y)
 
 
 
-unsigned widthPerThread  = 1024;
-unsigned heightPerThread = 32;
-unsigned numPixelsPerThread = widthPerThread * heightPerThread;
-
-
-/**
- * Prepare an image (or portion of it) for display on an 8-bit device.
- *
- * @param img   image to display
- * @param data  pre-allocated buffer to store 8-bit data
- * @param alpha create buffer with an alpha channel
- */
-void display_cb( mrv::DrawEngine::DisplayData* d )
-{
-    using namespace mrv;
-
-    int step = 3;
-    if ( d->alpha ) step = 4;
-
-
-    const mrv::Recti& rect = d->rect;
-    int x, y;
-    int xl = rect.x();
-    int yl = rect.y();
+// Rows of the picture converted by each task.
+const unsigned kRowsPerBand = 32;
 
-    int xh = rect.r();
-    int yh = rect.b();
+// Pictures with less pixels than this are converted in the calling
+// thread.
+const unsigned kMinParallelPixels = 1024 * 32;
 
-    mrv::image_type_ptr orig = d->orig;
-    if (!orig) return;
+// Segments of the gamma table, which is interpolated.  Fine enough for
+// the 8 bits displayed.
+const unsigned kGammaSize = 16384;
 
-    mrv::image_type_ptr result = d->result;
-    if (!result) return;
 
-#if 0
-    CMedia* img = d->image;
-    int dw = img->width();
-    int oxl = xl;
-    int oyl =  0;
-    int odw = dw;
+inline float apply_gamma( const float* table, const float x )
+{
+    const float s = x * kGammaSize;
+    const unsigned i = unsigned( s );
+    if ( i >= kGammaSize ) return table[kGammaSize];
+    return table[i] + ( table[i+1] - table[i] ) * ( s - float(i) );
+}
 
-    // Convert image using monitor profile
-    if ( d->view->use_lut() )
+/**
+ * Normalize and apply gain to the rgb of n pixels.  Alpha is left as is,
+ * as in the shaders.
+ */
+inline void gain_pixels( mrv::ImagePixel* p, const unsigned n,
+                         const float offset, const float gain )
+{
+#ifdef MR_SSE
+    const __m128 o = _mm_setr_ps( offset, offset, offset, 0.0f );
+    const __m128 m = _mm_setr_ps( gain, gain, gain, 1.0f );
+    float* f = (float*) p;
+    for ( unsigned i = 0; i < n; ++i, f += 4 )
+        _mm_storeu_ps( f, _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( f ), o ), m ) );
+#else
+    for ( unsigned i = 0; i < n; ++i )
     {
-        MagickBooleanType status;
-        MagickWandGenesis();
-        MagickWand* wand = NewMagickWand();
-
-        char* fmt = "RGBA";
-
-        int bw = xh - xl;
-        int bh = yh - yl;
-        CMedia::Pixel* icc = new CMedia::Pixel[ bw * bh ];
-        CMedia::Pixel* p   = icc;
-        for ( y = yl; y < yh; ++y )
-        {
-            for ( x = xl; x < xh; ++x, ++p )
-            {
-                *p = frame->pixel(x,y);
-            }
-        }
-
-        status = MagickConstituteImage( wand, bw, bh, fmt, FloatPixel, icc );
-        if ( status != MagickTrue )
-            LOG_ERROR( "Could not create image" );
-
-
-        MagickGetImagePixels(wand, 0, 0, bw, bh, fmt, FloatPixel, icc );
-
-        DestroyMagickWand( wand );
-        MagickWandTerminus();
-
-        fp = icc;
-        oxl = 0;
-        oyl = yl;
-        odw = bw;
+        p[i].r = ( p[i].r - offset ) * gain;
+        p[i].g = ( p[i].g - offset ) * gain;
+        p[i].b = ( p[i].b - offset ) * gain;
     }
 #endif
+}
 
+/**
+ * Clamp n pixels to [0, 1], with NANs as 0, and apply the gamma table,
+ * if any, to their rgb.
+ */
+inline void gamma_pixels( mrv::ImagePixel* p, const unsigned n,
+                          const float* table )
+{
+#ifdef MR_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one  = _mm_set1_ps( 1.0f );
+    float* f = (float*) p;
+    // max() returns its second operand when the first is a NAN.
+    for ( unsigned i = 0; i < n; ++i, f += 4 )
+        _mm_storeu_ps( f, _mm_min_ps( _mm_max_ps( _mm_loadu_ps( f ), zero ),
+                                      one ) );
+#else
+    float* f = (float*) p;
+    for ( unsigned i = 0; i < n * 4; ++i )
+    {
+        if ( !( f[i] > 0.0f ) ) f[i] = 0.0f;
+        else if ( f[i] > 1.0f ) f[i] = 1.0f;
+    }
+#endif
 
-    // Change float image to uchar based on gain and gamma.
-    RgbaGainGamma RGBAfunc( d->view->gain(), d->view->gamma() );
-    RgbaGainGamma    Afunc( 1.0f, d->view->gamma() );
+    if ( !table ) return;
 
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        p[i].r = apply_gamma( table, p[i].r );
+        p[i].g = apply_gamma( table, p[i].g );
+        p[i].b = apply_gamma( table, p[i].b );
+    }
+}
 
+/**
+ * Show only a channel of n pixels, or the lumma, as picked in the view.
+ */
+void select_channel( mrv::ImagePixel* p, const unsigned n,
+                     const int channel, const bool background )
+{
+    using namespace mrv;
 
-    switch( d->view->channel_type() )
+    unsigned i;
+    switch( channel )
     {
     case kRed:
-        for ( y = yl; y < yh; ++y )
-        {
-            for ( x = xl; x < xh; ++x )
-            {
-                CMedia::Pixel p = orig->pixel(x,y);
-                p.r = p.g = p.b = RGBAfunc( p.r );
-                result->pixel( x, y, p );
-            }
-        }
+        for ( i = 0; i < n; ++i ) p[i].g = p[i].b = p[i].r;
         break;
     case kGreen:
-        for ( y = yl; y < yh; ++y )
-        {
-            for ( x = xl; x < xh; ++x )
-            {
-                CMedia::Pixel p = orig->pixel(x,y);
-                p.r = p.g = p.b = RGBAfunc( p.g );
-                result->pixel( x, y, p );
-            }
-        }
+        for ( i = 0; i < n; ++i ) p[i].r = p[i].b = p[i].g;
         break;
     case kBlue:
-        for ( y = yl; y < yh; ++y )
-        {
-            for ( x = xl; x < xh; ++x )
-            {
-                CMedia::Pixel p = orig->pixel(x,y);
-                p.r = p.g = p.b = RGBAfunc( p.b );
-                result->pixel( x, y, p );
-            }
-        }
+        for ( i = 0; i < n; ++i ) p[i].r = p[i].g = p[i].b;
         break;
     case kAlpha:
-    {
-        mrv::media m = d->view->background();
-
-        for ( y = yl; y < yh; ++y )
-        {
-            for ( x = xl; x < xh; ++x )
-            {
-                CMedia::Pixel p = orig->pixel(x,y);
-                p = RGBAfunc( p );
-                if ( d->view->show_background() )
-                {
-                    p.r = p.g = p.b = 1.0f;
-                }
-                else
-                {
-                    p.r = p.g = p.b = p.a;
-                }
-                result->pixel( x, y, p );
-            }
-        }
-    }
-    break;
+        for ( i = 0; i < n; ++i )
+            p[i].r = p[i].g = p[i].b = background ? 1.0f : p[i].a;
+        break;
     case kAlphaOverlay:
-        for ( y = yl; y < yh; ++y )
-        {
-            for ( x = xl; x < xh; ++x )
-            {
-                CMedia::Pixel p = orig->pixel(x,y);
-                p = RGBAfunc( p );
-                p.r = p.a * 0.5f + p.r * 0.5f;
-                result->pixel( x, y, p );
-            }
-        }
+        for ( i = 0; i < n; ++i ) p[i].r = p[i].a * 0.5f + p[i].r * 0.5f;
         break;
     case kLumma:
-        for ( y = yl; y < yh; ++y )
-        {
-            for ( x = xl; x < xh; ++x )
-            {
-                CMedia::Pixel p = orig->pixel(x,y);
-                p = RGBAfunc( p );
-                p.r = p.g = p.b = (p.r + p.g + p.b)/3.0f;
-                result->pixel( x, y, p );
-            }
-        }
+        for ( i = 0; i < n; ++i )
+            p[i].r = p[i].g = p[i].b = ( p[i].r + p[i].g + p[i].b ) / 3.0f;
         break;
     case kRGB:
     default:
-        for ( y = yl; y < yh; ++y )
-        {
-            for ( x = xl; x < xh; ++x )
-            {
-                CMedia::Pixel p = orig->pixel(x,y);
-                p = RGBAfunc( p );
-                result->pixel( x, y, p );
-            }
-        }
         break;
     }
-
-    // delete temporary icc image/tile
-#if 0
-    if ( d->view->use_lut() )
-    {
-        delete [] fp;
-    }
-#endif
-
 }
 
-void minmax_cb( mrv::DrawEngine::MinMaxData* d )
-{
-    using mrv::CMedia;
 
-    unsigned int xl = d->rect.x();
-    unsigned int yl = d->rect.y();
+/**
+ * Prepare a band of rows of an image for display on an 8-bit device.
+ *
+ * @param d     conversion to do
+ * @param band  band of kRowsPerBand rows of d->rect to convert
+ */
+void display_cb( const mrv::DrawEngine::DisplayData* d, const unsigned band )
+{
+    using namespace mrv;
 
-    unsigned int xh = xl + d->rect.w();
-    unsigned int yh = yl + d->rect.h();
+    const Recti& rect = d->rect;
+    const unsigned yl = rect.y() + band * kRowsPerBand;
+    unsigned yh = yl + kRowsPerBand;
+    if ( yh > unsigned( rect.b() ) ) yh = rect.b();
 
-    const mrv::image_type_ptr pic = d->pic;
-    const CMedia* img = d->image;
-    if ( !pic ) return;
+    const unsigned x = rect.x();
+    const unsigned n = rect.w();
 
-    if ( xh >= pic->height() ) xh = pic->width();
-    if ( yh >= pic->height() ) yh = pic->height();
+    // Packed pictures, in half and float too, are read and written a
+    // row at a time without going through pixel().
+    RowReader read( d->orig.get() );
+    RowWriter write( d->result.get() );
 
-    d->pMin = std::numeric_limits< float >::max();
-    d->pMax = std::numeric_limits< float >::min();
+    std::vector< ImagePixel > row( n );
+    ImagePixel* p = &row[0];
 
-    for ( unsigned int y = yl ; y < yh; ++y )
+    for ( unsigned y = yl; y < yh; ++y )
     {
-        for ( unsigned int x = xl; x < xh; ++x )
-        {
-            const CMedia::Pixel& p = pic->pixel( x, y );
+        read( y, x, n, p );
 
-            if ( half(p.r).isFinite() )
-            {
-                if ( p.r > d->pMax ) d->pMax = p.r;
-                if ( p.r < d->pMin ) d->pMin = p.r;
-            }
-
-            if ( half(p.g).isFinite()  )
-            {
-                if ( p.g < d->pMin ) d->pMin = p.g;
-                if ( p.g > d->pMax ) d->pMax = p.g;
-            }
+        gain_pixels( p, n, d->offset, d->gain );
 
-            if ( half(p.b).isFinite()  )
+        if ( d->lut )
+        {
+            Imath::V3f in, out;
+            for ( unsigned i = 0; i < n; ++i )
             {
-                if ( p.b < d->pMin ) d->pMin = p.b;
-                if ( p.b > d->pMax ) d->pMax = p.b;
+                in.x = p[i].r; in.y = p[i].g; in.z = p[i].b;
+                d->lut->evaluate( in, out );
+                p[i].r = out.x; p[i].g = out.y; p[i].b = out.z;
             }
-
         }
-    }
 
-    if ( d->pMin == std::numeric_limits<float>::max() )
-        d->pMin = 0.0f;
+        gamma_pixels( p, n, d->gamma );
+        select_channel( p, n, d->channel, d->background );
 
-    if (d->pMax <= d->pMin)
-        d->pMax = d->pMin + 1;
+        write( y, x, n, p );
+    }
+}
 
+/**
+ * Range of the finite rgb values of pic, from its statistics.
+ */
+void rgb_range( const mrv::VideoFrame* pic, float& lo, float& hi )
+{
+    const mrv::VideoFrame::Stats& s = pic->stats();
+    lo = std::min( s.min.r, std::min( s.min.g, s.min.b ) );
+    hi = std::max( s.max.r, std::max( s.max.g, s.max.b ) );
 }
 
 
@@ -458,7 +308,8 @@ DrawEngine::DrawEngine(mrv::ImageView* v) :
     _view(v),
     _normMin( 0 ),
     _normMax( 1.0f ),
-    _background_resized( 0 )
+    _background_resized( 0 ),
+    _gammaTableFor( 1.0f )
 {
 }
 
@@ -482,6 +333,26 @@ CMedia* const DrawEngine::background()
 }
 
 
+/**
+ * Table of pow( x, 1/gamma ) for x in [0, 1], or NULL if gamma is 1.
+ */
+const float* DrawEngine::gamma_table( const float gamma )
+{
+    if ( gamma == 1.0f ) return NULL;
+
+    if ( _gammaTable.empty() || gamma != _gammaTableFor )
+    {
+        _gammaTable.resize( kGammaSize + 1 );
+        const float g = 1.0f / gamma;
+        for ( unsigned i = 0; i <= kGammaSize; ++i )
+            _gammaTable[i] = Imath::Math<float>::pow( float(i) / kGammaSize,
+                                                      g );
+        _gammaTableFor = gamma;
+    }
+
+    return &_gammaTable[0];
+}
+
 void DrawEngine::display( image_type_ptr& result,
                           const image_type_ptr& src,
                           CMedia* img )
@@ -489,162 +360,43 @@ void DrawEngine::display( image_type_ptr& result,
     Mutex& m = img->video_mutex();
     SCOPED_LOCK( m );
 
-    image_type_ptr pic      = src;
-    int64_t frame           = pic->frame();
-    unsigned int dw         = pic->width();
-    unsigned int dh         = pic->height();
-    unsigned short channels = pic->channels();
-    image_type::Format    format = pic->format();
-
-    unsigned int x, y;
+    // Same steps as the shaders: normalization, gain, lut, gamma and
+    // then channel selection.
+    DisplayData d;
+    d.orig       = src;
+    d.result     = result;
+    d.rect       = img->damage_rectangle();
+    d.offset     = 0.0f;
+    d.gain       = _view->gain();
+    d.gamma      = gamma_table( _view->gamma() );
+    d.channel    = _view->channel_type();
+    d.background = _view->show_background();
+    if ( _view->use_lut() ) d.lut = transform( img );
+
+    if ( d.rect.w() <= 0 || d.rect.h() <= 0 ) return;
 
     if ( _view->normalize() )
     {
-        float vMin[2];
-        float vMax[2];
-        for ( x = 0; x < 2; ++x )
-        {
-            vMin[x] = std::numeric_limits<float>::max();
-            vMax[x] = std::numeric_limits<float>::min();
-        }
-
-        for ( y = 0; y < dh; ++y )
-        {
-            for ( x = 0; x < dw; ++x )
-            {
-                const CMedia::Pixel& rp = pic->pixel(x,y);
-
-                if ( isnan( rp.a ) )
-                    continue;
-
-                if ( rp.a < vMin[1] ) vMin[1] = rp.a;
-                if ( rp.a > vMax[1] ) vMax[1] = rp.a;
-
-                if ( isfinite( rp.r ) && !isnan(rp.r) )
-                {
-                    if ( rp.r < vMin[0] ) vMin[0] = rp.r;
-                    if ( rp.r > vMax[0] ) vMax[0] = rp.r;
-                }
-                if ( isfinite( rp.g ) && !isnan(rp.g) )
-                {
-                    if ( rp.g < vMin[0] ) vMin[0] = rp.g;
-                    if ( rp.g > vMax[0] ) vMax[0] = rp.g;
-                }
-
-                if ( isfinite( rp.b ) && !isnan(rp.b) )
-                {
-                    if ( rp.b < vMin[0] ) vMin[0] = rp.b;
-                    if ( rp.b > vMax[0] ) vMax[0] = rp.b;
-                }
-            }
-        }
-
-        for ( x = 0; x < 2; ++x )
-        {
-            vMax[x] -= vMin[x];
-            if ( vMax[x] == 0.0f ) vMax[x] = 1.0f;
-        }
-
-        mrv::image_type_ptr p( new image_type( frame,
-                                               dw,
-                                               dh,
-                                               channels,
-                                               format,
-                                               src->pixel_type() ) );
-
-        for ( y = 0; y < dh; ++y )
-        {
-            for ( x = 0; x < dw; ++x )
-            {
-                CMedia::Pixel rp = pic->pixel(x, y);
-
-                if ( isfinite( rp.r ) )
-                    rp.r = (rp.r - vMin[0]) / vMax[0];
-                if ( isfinite( rp.g ) )
-                    rp.g = (rp.g - vMin[0]) / vMax[0];
-                if ( isfinite( rp.b ) )
-                    rp.b = (rp.b - vMin[0]) / vMax[0];
-                rp.a = (rp.a - vMin[1]) / vMax[1];
-
-                p->pixel( x, y, rp );
-            }
-        }
-
-        pic = p;
+        float lo, hi;
+        rgb_range( src.get(), lo, hi );
+        float span = hi - lo;
+        if ( span == 0.0f ) span = 1.0f;
+        d.offset = lo;
+        d.gain  /= span;
     }
 
-    // Based on window size, spawn several threads or just jump to
-    // process tile.
-    const mrv::Recti& rect = img->damage_rectangle();
-    unsigned int xl = rect.x();
-    unsigned int yl = rect.y();
-
-    unsigned int xh = rect.r();
-    unsigned int yh = rect.b();
+    const unsigned bands = ( d.rect.h() + kRowsPerBand - 1 ) / kRowsPerBand;
 
-    unsigned int xw = xh - xl;
-    unsigned int yw = yh - yl;
-
-    unsigned int num = xw * yw;
-
-    if ( num < numPixelsPerThread )
+    if ( unsigned( d.rect.w() * d.rect.h() ) < kMinParallelPixels )
     {
-        DisplayData display_data;
-        display_data.view   = _view;
-        display_data.orig   = pic;
-        display_data.result = result;
-        display_data.image  = img;
-        display_data.rect   = rect;
-        display_data.alpha  = result->has_alpha();
-        display_cb( &display_data );
-    }
-    else
-    {
-        unsigned int x, y;
-
-
-        unsigned int ny, nx;
-        for ( y = yl; y < yh; y = ny )
-        {
-            ny   = y + heightPerThread;
-            unsigned int byh  = yh < ny? yh : ny;
-
-            boost::thread* thread_id;
-            for ( x = xl; x < xh; x = nx )
-            {
-                nx  = x + widthPerThread;
-                int bxh = xh < nx? xh : nx;
-
-                DisplayData* display_data = new DisplayData;
-                display_data->view   = _view;
-                display_data->orig   = pic;
-                display_data->result = result;
-                display_data->image  = img;
-                display_data->rect   = mrv::Recti( x, y, bxh-x, byh-y );
-                display_data->alpha  = result->has_alpha();
-
-                thread_id = new boost::thread( boost::bind( display_cb,
-                                               display_data ) );
-
-                buckets.insert( std::make_pair( thread_id, display_data ) );
-            }
-        }
-
-
-        BucketList::iterator i = buckets.begin();
-        BucketList::iterator e = buckets.end();
-
-        // Make sure all threads finish before proceeding
-        for ( ; i != e; ++i )
-        {
-            i->first->join();
-
-            DisplayData*  opaque = (DisplayData*) i->second;
-            delete opaque;
-        }
-        buckets.clear();
+        for ( unsigned i = 0; i < bands; ++i )
+            display_cb( &d, i );
+        return;
     }
 
+    Scheduler::instance().parallel_for( bands,
+                                        boost::bind( display_cb, &d, _1 ),
+                                        "display" );
 }
 
 /**
@@ -698,38 +450,37 @@ image_type_ptr DrawEngine::display( const image_type_ptr& src,
 }
 
 
-/// Find min/max values for an image, using multithreading if possible
+/// Widen pMin and pMax to the range of the rgb values of an image, taken
+/// from the statistics kept with its frames.
 void DrawEngine::minmax( float& pMin, float& pMax,
                          const CMedia* img )
 {
+    float lo, hi;
 
-    MinMaxData data;
-    data.image  = img;
-    data.pic   = img->left();
-    data.rect   = mrv::Recti( 0, 0, data.pic->width(), data.pic->height() );
-
-    minmax_cb( &data );
-
-    pMin = data.pMin;
-    pMax = data.pMax;
+    mrv::image_type_ptr pic = img->left();
+    if ( pic )
+    {
+        rgb_range( pic.get(), lo, hi );
+        if ( lo < pMin ) pMin = lo;
+        if ( hi > pMax ) pMax = hi;
+    }
 
     if ( img->stereo_output() )
     {
-        data.pic = img->right();
-        data.rect = mrv::Recti( 0, 0, data.pic->width(), data.pic->height() );
-        minmax_cb( &data );
-
-        if ( data.pMin < pMin ) pMin = data.pMin;
-        if ( data.pMax > pMax ) pMax = data.pMax;
+        pic = img->right();
+        if ( pic )
+        {
+            rgb_range( pic.get(), lo, hi );
+            if ( lo < pMin ) pMin = lo;
+            if ( hi > pMax ) pMax = hi;
+        }
     }
-
-
 }
 
 
 void DrawEngine::minmax() {
     _normMin = std::numeric_limits< float >::max();
-    _normMax = std::numeric_limits< float >::min();
+    _normMax = -std::numeric_limits< float >::max();
     {
         const mrv::media& m = _view->foreground();
         if ( m )
@@ -740,6 +491,12 @@ void DrawEngine::minmax() {
         if ( m )
             minmax( _normMin, _normMax, m->image() );
     }
+
+    if ( _normMin == std::numeric_limits<float>::max() )
+        _normMin = 0.0f;
+
+    if ( _normMax <= _normMin )
+        _normMax = _normMin + 1;
 }
 
 } // namespace mrv
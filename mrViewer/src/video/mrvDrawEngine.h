@@ -32,16 +32,13 @@
 #include <limits>
 
 #include <boost/shared_array.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "core/CMedia.h"
 #include "core/mrvRectangle.h"
 
 #include "video/mrvGLShape.h"
 
-namespace boost {
-class thread;
-}
-
 namespace mrv {
 class uvCoords;
 class ImageView;
@@ -49,6 +46,17 @@ class ImageView;
 
 namespace mrv {
 
+// Color transform (a LUT) that can be evaluated from any thread.
+class ColorTransform
+{
+public:
+    virtual ~ColorTransform() {}
+
+    virtual void evaluate( const Imath::V3f& rgb, Imath::V3f& out ) const = 0;
+};
+
+typedef boost::shared_ptr< const ColorTransform > ColorTransform_ptr;
+
 
 class DrawEngine
 {
@@ -63,26 +71,15 @@ public:
     {
         DisplayData() {};
 
-        const ImageView*    view;
-        const CMedia*   image;
         mrv::Recti          rect;
         mrv::image_type_ptr orig;
         mrv::image_type_ptr result;
-        bool                alpha;
-    };
-
-    struct MinMaxData
-    {
-        MinMaxData() :
-            pMin( std::numeric_limits< float >::max() ),
-            pMax( std::numeric_limits< float >::min() )
-        {};
-
-        mrv::image_type_ptr pic;
-        const CMedia*     image;
-        mrv::Recti      rect;
-        float pMin;
-        float pMax;
+        float               offset;     //!< subtracted from rgb
+        float               gain;       //!< rgb multiplier after offset
+        ColorTransform_ptr  lut;        //!< applied after gain, or NULL
+        const float*        gamma;      //!< gamma table, or NULL
+        int                 channel;    //!< ChannelType shown
+        bool                background; //!< view shows background
     };
 
 public:
@@ -141,6 +138,11 @@ public:
     virtual void evaluate( const CMedia* img,
                            const Imath::V3f& rgb, Imath::V3f& out ) = 0;
 
+    // LUT of image, for evaluating pixels outside of the drawing thread.
+    virtual ColorTransform_ptr transform( const CMedia* img ) const {
+        return ColorTransform_ptr();
+    }
+
     /// Refresh the luts
     virtual void refresh_luts() = 0;
 
@@ -229,14 +231,14 @@ public:
 
     /// Convert a float image to uchar for display, taking into
     /// account gamma, gain, pixel ratio, lut, etc.
-    /// This function may spawn multiple threads to do the conversions
+    /// Bands of rows are converted in parallel by the Scheduler.
     image_type_ptr display( const image_type_ptr& src, CMedia* img );
 
     void display( image_type_ptr& result,
                   const image_type_ptr& src, CMedia* img );
 
 public:
-    /// Find min/max values for an image, using multithreading if possible
+    /// Find min/max rgb values of the images, from their frame statistics
     void minmax();
 
     // Retrieve min and max float values of image.  To be used after
@@ -255,9 +257,11 @@ public:
 protected:
 
 
-    /// Find min/max values for an image, using multithreading if possible
+    /// Widen pMin and pMax to the min/max rgb values of an image
     void minmax( float& pMin, float& pMax, const CMedia* img );
 
+    const float* gamma_table( const float gamma );
+
 
 
 protected:
@@ -269,9 +273,9 @@ protected:
     //! Copy of background image resized to fit foreground
     CMedia* _background_resized;
 
-    //! Buckets of threads for color correction
-    typedef std::map< boost::thread*, void* > BucketList;
-    BucketList buckets;
+    //! Gamma curve of display(), for _gammaTableFor
+    std::vector< float > _gammaTable;
+    float _gammaTableFor;
 
     static bool _has_hdr;
     static bool _has_yuv, _has_yuva;
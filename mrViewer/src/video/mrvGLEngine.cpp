@@ -709,6 +709,16 @@ void GLEngine::evaluate( const CMedia* img,
 
 }
 
+ColorTransform_ptr GLEngine::transform( const CMedia* img ) const
+{
+    for ( const auto& q : _quads )
+    {
+        if ( q->image() == img )
+            return q->lut();
+    }
+    return ColorTransform_ptr();
+}
+
 void GLEngine::rotate( const double z )
 {
     glRotated( z, 0, 0, 1 );
@@ -2262,7 +2272,7 @@ void GLEngine::draw_images( ImageList& images )
             stereo = CMedia::kNoStereo;
             pic = img->left();
 
-            if ( shader_type() == kNone && img->stopped() &&
+            if ( shader_type() == kNone &&
                  pic->pixel_type() != image_type::kByte )
             {
                 CHECK_GL;
@@ -74,6 +74,7 @@ public:
 
     virtual void evaluate( const CMedia* img,
                            const Imath::V3f& rgb, Imath::V3f& out );
+    virtual ColorTransform_ptr transform( const CMedia* img ) const;
 
     virtual void refresh_luts();
     virtual void clear_canvas( float r, float g, float b, float a );
@@ -25,8 +25,17 @@
  *
  */
 
+#include <ctime>
 #include <fstream>
+#include <sstream>
 #include <limits>
+#include <algorithm>
+
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <Iex.h>
 #include <half.h>
@@ -40,6 +49,7 @@
 #include <CtlExc.h>
 
 #include <FL/Enumerations.H>
+#include <FL/fl_utf8.h>
 
 
 #include "IccProfile.h"
@@ -49,6 +59,8 @@
 #include "core/ctlToLut.h"
 #include "core/CMedia.h"
 #include "core/mrvColorProfile.h"
+#include "core/mrvHome.h"
+#include "core/mrvScheduler.h"
 #include "gui/mrvIO.h"
 #include "gui/mrvLogDisplay.h"
 #include "gui/mrvPreferences.h"
@@ -65,6 +77,8 @@ namespace
 const char* kModule = N_("cmm");
 }
 
+namespace fs = boost::filesystem;
+
 #define OCIO_ERROR(x) do { \
     LOG_ERROR( "[ocio] " << x ); \
     ViewerUI::uiLog->uiMain->show(); \
@@ -231,6 +245,175 @@ lookup3D
     return V3f( out4.x, out4.y, out4.z );
 }
 
+namespace {
+
+// Bump when the lut math or the file layout changes.
+const unsigned kLutCacheVersion = 1;
+const char     kLutCacheMagic[8] = { 'm', 'r', 'v', 'L', 'U', 'T', '3', 'D' };
+
+// Fewest lattice points worth a thread of their own.
+const size_t kMinPointsPerThread = 4096;
+
+// Last modification time of a file, or 0 if it cannot be found.
+std::time_t file_time( const fs::path& p )
+{
+    boost::system::error_code ec;
+    std::time_t t = fs::last_write_time( p, ec );
+    if ( ec ) return 0;
+    return t;
+}
+
+// Last modification time of a CTL module, looked up in CTL_MODULE_PATH.
+std::time_t ctl_time( const std::string& name )
+{
+    const char* env = fl_getenv( "CTL_MODULE_PATH" );
+    if ( !env ) return 0;
+
+#if defined(WIN32) || defined(WIN64)
+    const char sep = ';';
+#else
+    const char sep = ':';
+#endif
+
+    std::string paths = env;
+    size_t start = 0;
+    while ( start <= paths.size() )
+    {
+        size_t end = paths.find( sep, start );
+        if ( end == std::string::npos ) end = paths.size();
+        std::string dir = paths.substr( start, end - start );
+        if ( !dir.empty() )
+        {
+            std::time_t t = file_time( fs::path( dir ) / ( name + ".ctl" ) );
+            if ( t ) return t;
+        }
+        start = end + 1;
+    }
+    return 0;
+}
+
+// 64-bit FNV-1a hash, used to name lut cache files.
+boost::uint64_t hash_key( const std::string& key )
+{
+    boost::uint64_t h = 14695981039346656037ULL;
+    for ( size_t i = 0; i < key.size(); ++i )
+    {
+        h ^= (unsigned char) key[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// One chunk of points of a lattice job.
+template< typename Job >
+struct LatticeChunks
+{
+    Job*   job;
+    size_t chunk;
+    size_t points;
+
+    void run( const unsigned i )
+    {
+        const size_t first = i * chunk;
+        job->run( first, std::min( chunk, points - first ) );
+    }
+};
+
+//
+// Run job.run( first, count ) over the points of a lattice, split in
+// chunks across cores.  The first chunk runs in this thread.
+//
+template< typename Job >
+void parallel_lattice( Job& job, const size_t points )
+{
+    if ( points == 0 ) return;
+
+    mrv::Scheduler& s = mrv::Scheduler::instance();
+    size_t threads = s.threads();
+    threads = std::min( threads, points / kMinPointsPerThread );
+    if ( threads < 1 ) threads = 1;
+
+    const size_t chunk = ( points + threads - 1 ) / threads;
+
+    LatticeChunks< Job > c = { &job, chunk, points };
+    s.parallel_for( unsigned( ( points + chunk - 1 ) / chunk ),
+                    boost::bind( &LatticeChunks< Job >::run, &c, _1 ),
+                    "lut bake" );
+}
+
+// Errors of lattice jobs, reported once all threads are done.
+struct LatticeJob
+{
+    boost::mutex mtx;
+    std::string  error;
+
+    void fail( const std::string& msg )
+    {
+        boost::mutex::scoped_lock lk( mtx );
+        if ( error.empty() ) error = msg;
+    }
+};
+
+struct OCIOJob : public LatticeJob
+{
+#if OCIO_VERSION_HEX >= 0x02000000
+    OCIO::ConstCPUProcessorRcPtr processor;
+#else
+    OCIO::ConstProcessorRcPtr    processor;
+#endif
+    float*                       data;
+    unsigned                     channels;
+
+    void run( const size_t first, const size_t count )
+    {
+        try
+        {
+            OCIO::PackedImageDesc img( data + first * channels,
+                                       /* width */ long(count),
+                                       /*height*/ 1,
+                                       /*channels*/ channels );
+            processor->apply( img );
+        }
+        catch( const std::exception& e )
+        {
+            fail( e.what() );
+        }
+        catch( ... )
+        {
+            fail( _("Unknown error returned from OCIO processor") );
+        }
+    }
+};
+
+// Each chunk gets its own CTL interpreter, as ctlToLut creates one.
+struct CTLJob : public LatticeJob
+{
+    std::vector< std::string > names;
+    const Imf::Header*         header;
+    const float*               in;
+    float*                     out;
+    const char**               channels;
+
+    void run( const size_t first, const size_t count )
+    {
+        try
+        {
+            ctlToLut( names, *header, count * 4, in + first * 4,
+                      out + first * 4, channels );
+        }
+        catch( const std::exception& e )
+        {
+            fail( std::string( "ctlToLut: " ) + e.what() );
+        }
+        catch( ... )
+        {
+            fail( _("Unknown error returned from ctlToLut") );
+        }
+    }
+};
+
+} // namespace
+
 unsigned GLLut3d::NUM_STOPS = 8;
 GLLut3d::LutsMap GLLut3d::_luts;
 
@@ -578,23 +761,25 @@ bool GLLut3d::calculate_ocio( const CMedia* img )
             config->getProcessor( transform );
 
 
+        // Processors can be applied from several threads at once.
+        OCIOJob job;
 #if OCIO_VERSION_HEX >= 0x02000000
-        OCIO::ConstCPUProcessorRcPtr cpu =
+        job.processor =
             processor->getOptimizedCPUProcessor(OCIO::BIT_DEPTH_F32,
                                                 OCIO::BIT_DEPTH_F32,
                                                 OCIO::OPTIMIZATION_DEFAULT);
-#endif
-
-        OCIO::PackedImageDesc img(&lut[0],
-                                  /* width */ lut_size()/_channels,
-                                  /*height*/ 1,
-                                  /*channels*/ _channels);
-
-#if OCIO_VERSION_HEX >= 0x02000000
-        cpu->apply( img );
 #else
-        processor->apply( img );
+        job.processor = processor;
 #endif
+        job.data = &lut[0];
+        job.channels = _channels;
+
+        parallel_lattice( job, lut_size()/_channels );
+        if ( !job.error.empty() )
+        {
+            OCIO_ERROR( job.error );
+            return false;
+        }
         DBG;
 
         // std::ostringstream os;
@@ -699,22 +884,20 @@ bool GLLut3d::calculate_ctl(
 
         prepare_ACES( img, (*i).name, header );
 
-        try
-        {
-            ctlToLut( transformNames, header, lut_size(), pixelValues, lut,
-                      channelNames );
-            _inited = true;
-        }
-        catch( const std::exception& e )
-        {
-            LOG_ERROR( "ctlToLut: " << e.what() );
-            return false;
-        }
-        catch( ... )
+        CTLJob job;
+        job.names = transformNames;
+        job.header = &header;
+        job.in = pixelValues;
+        job.out = lut;
+        job.channels = channelNames;
+
+        parallel_lattice( job, lut_size() / 4 );
+        if ( !job.error.empty() )
         {
-            LOG_ERROR( _("Unknown error returned from ctlToLut") );
+            LOG_ERROR( job.error );
             return false;
         }
+        _inited = true;
     }
 
 
@@ -1173,6 +1356,181 @@ void GLLut3d::transform_names( GLLut3d::Transforms& t, const CMedia* img )
     ODT_ctl_transforms( path, t, img );
 }
 
+/**
+ * Build the key of a lut in the disk cache.  Besides the transform
+ * chain, it holds everything the baked lut depends on, like the
+ * modification times of the CTL scripts and ICC profiles, the OCIO
+ * config and the lut size, so a change in any of them bakes a new lut.
+ *
+ * @param view       main viewer ui
+ * @param img        image the lut is for
+ * @param fullpath   key of the lut in the memory cache
+ * @param transforms transforms of lut (empty for OCIO)
+ * @param size       size of lut (one axis)
+ *
+ * @return key of lut
+ */
+std::string GLLut3d::cache_key( const ViewerUI* view, const CMedia* img,
+                                const std::string& fullpath,
+                                const Transforms& transforms,
+                                const unsigned size )
+{
+    std::ostringstream key;
+    key.precision( 9 );
+    key << "v" << kLutCacheVersion << " " << fullpath
+        << " size " << size << " stops " << NUM_STOPS;
+
+    if ( Preferences::use_ocio )
+    {
+        const char* var = view->uiPrefs->uiPrefsOCIOConfig->value();
+        if ( var )
+            key << " config " << var << " " << file_time( fs::path( var ) );
+        return key.str();
+    }
+
+    Transforms::const_iterator i = transforms.begin();
+    Transforms::const_iterator e = transforms.end();
+    for ( ; i != e; ++i )
+    {
+        key << " [" << (char) i->type << " " << i->name << " "
+            << i->intent << " ";
+        if ( i->type == Transform::kCTL )
+            key << ctl_time( i->name );
+        else
+            key << file_time( fs::path( i->name ) );
+        key << "]";
+    }
+
+    // Inputs of the CTL scripts
+    const ACES::ASC_CDL& c = img->asc_cdl();
+    key << " cdl";
+    for ( int j = 0; j < 3; ++j )
+        key << " " << c.slope(j) << " " << c.offset(j) << " " << c.power(j);
+    key << " " << c.saturation();
+
+    const Imf::Chromaticities& ch = img->chromaticities();
+    key << " chroma " << ch.red << ch.green << ch.blue << ch.white;
+
+    const Imf::Chromaticities& d = Preferences::ODT_CTL_chromaticities;
+    key << " display " << d.red << d.green << d.blue << d.white
+        << " " << Preferences::ODT_CTL_white_luminance
+        << " " << Preferences::ODT_CTL_surround_luminance;
+
+    return key.str();
+}
+
+std::string GLLut3d::cache_file( const std::string& key )
+{
+    char name[32];
+    sprintf( name, "%016llx.lut", (unsigned long long) hash_key( key ) );
+
+    std::string file = mrv::homepath();
+    file += "/.filmaura/luts/";
+    file += name;
+    return file;
+}
+
+/**
+ * Load a baked lut from the disk cache.
+ *
+ * @param key key of lut, from cache_key()
+ *
+ * @return true if lut was found and loaded
+ */
+bool GLLut3d::load( const std::string& key )
+{
+    std::ifstream f( cache_file( key ).c_str(), std::ios::binary );
+    if ( !f.is_open() ) return false;
+
+    char magic[8];
+    boost::uint32_t version, len, N, channels;
+    f.read( magic, 8 );
+    f.read( (char*) &version, sizeof(version) );
+    f.read( (char*) &len, sizeof(len) );
+    if ( !f || memcmp( magic, kLutCacheMagic, 8 ) != 0 ||
+         version != kLutCacheVersion || len != key.size() )
+        return false;
+
+    // Hashes may collide, so the key is stored too.
+    std::string k( len, '\0' );
+    f.read( &k[0], len );
+    f.read( (char*) &N, sizeof(N) );
+    f.read( (char*) &channels, sizeof(channels) );
+    if ( !f || k != key || N != _lutN || ( channels != 3 && channels != 4 ) )
+        return false;
+
+    float range[4];
+    f.read( (char*) range, sizeof(range) );
+
+    _channels = (unsigned short) channels;
+    clear_lut();
+    f.read( (char*) &lut[0], lut_size() * sizeof(float) );
+    if ( !f )
+    {
+        clear_lut();
+        return false;
+    }
+
+    lutMin = range[0];
+    lutMax = range[1];
+    lutM   = range[2];
+    lutT   = range[3];
+    _inited = true;
+    return true;
+}
+
+/**
+ * Save a baked lut to the disk cache.  The file is written under a
+ * temporary name and renamed, so other viewers never read half a lut.
+ *
+ * @param key key of lut, from cache_key()
+ */
+void GLLut3d::save( const std::string& key ) const
+{
+    const std::string file = cache_file( key );
+
+    boost::system::error_code ec;
+    fs::create_directories( fs::path( file ).parent_path(), ec );
+    if ( ec )
+    {
+        LOG_WARNING( _("Could not create lut cache directory: ")
+                     << ec.message() );
+        return;
+    }
+
+    const fs::path tmp = fs::unique_path( file + ".%%%%-%%%%.tmp", ec );
+    if ( ec ) return;
+
+    {
+        std::ofstream f( tmp.string().c_str(), std::ios::binary );
+        if ( !f.is_open() ) return;
+
+        boost::uint32_t version = kLutCacheVersion;
+        boost::uint32_t len = (boost::uint32_t) key.size();
+        boost::uint32_t N = _lutN;
+        boost::uint32_t channels = _channels;
+        float range[4] = { lutMin, lutMax, lutM, lutT };
+        f.write( kLutCacheMagic, 8 );
+        f.write( (const char*) &version, sizeof(version) );
+        f.write( (const char*) &len, sizeof(len) );
+        f.write( key.c_str(), len );
+        f.write( (const char*) &N, sizeof(N) );
+        f.write( (const char*) &channels, sizeof(channels) );
+        f.write( (const char*) range, sizeof(range) );
+        f.write( (const char*) &lut[0], lut_size() * sizeof(float) );
+        if ( !f )
+        {
+            f.close();
+            fs::remove( tmp, ec );
+            return;
+        }
+    }
+
+    fs::rename( tmp, file, ec );
+    if ( ec ) fs::remove( tmp, ec );
+}
+
+
 GLLut3d::GLLut3d_ptr GLLut3d::factory( const ViewerUI* view,
                                        const CMedia* img )
 {
@@ -1412,7 +1770,13 @@ GLLut3d::GLLut3d_ptr GLLut3d::factory( const ViewerUI* view,
 
     //lut->calculate_range( img->hires() );
 
-    if ( Preferences::use_ocio )
+    const std::string key = cache_key( view, img, fullpath, transforms, size );
+    const bool cached = lut->load( key );
+    if ( cached )
+    {
+        LOG_INFO( _("Loaded 3D Lut from disk cache.") );
+    }
+    else if ( Preferences::use_ocio )
     {
         char* oldloc = av_strdup( setlocale(LC_NUMERIC, NULL ) );
         setlocale(LC_NUMERIC, "C" );
@@ -1458,6 +1822,9 @@ GLLut3d::GLLut3d_ptr GLLut3d::factory( const ViewerUI* view,
         }
     }
 
+    if ( !cached && lut->inited() )
+        lut->save( key );
+
     lut->create_gl_texture();
 
     if ( _luts.find( fullpath ) != _luts.end() ) _luts.erase( path );
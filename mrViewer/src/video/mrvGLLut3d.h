@@ -46,6 +46,7 @@ namespace OCIO = OCIO_NAMESPACE;
 
 #include <boost/shared_ptr.hpp>
 #include "core/mrvFrame.h"
+#include "video/mrvDrawEngine.h"
 
 class CIccProfile;
 class ViewerUI;
@@ -59,7 +60,7 @@ class CMedia;
 void prepare_ACES( const CMedia* img, const std::string& name,
                    Imf::Header& h );
 
-class GLLut3d
+class GLLut3d : public ColorTransform
 {
 public:
 
@@ -161,6 +162,15 @@ protected:
 
     void init_pixel_values( Imf::Array< float >& pixelValues );
 
+    // Disk cache of baked luts
+    static std::string cache_key( const ViewerUI* view, const CMedia* img,
+                                  const std::string& fullpath,
+                                  const Transforms& transforms,
+                                  const unsigned size );
+    static std::string cache_file( const std::string& key );
+    bool load( const std::string& key );
+    void save( const std::string& key ) const;
+
 public:
     static std::string update_ICS( const ViewerUI* view,
                                    const CMedia* img,